@@ -0,0 +1,256 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Micro-benchmarks for the intersection routines of the geometry primitives,
+ * the bounding box and the KdTree. Every benchmark runs over four ray sets:
+ * random or coherent rays which either all hit or all miss the target.
+ * Author: Dino Wernli
+ */
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "proto/config/scene_config.pb.h"
+#include "renderer/intersection_data.h"
+#include "scene/element.h"
+#include "scene/geometry/plane.h"
+#include "scene/geometry/sphere.h"
+#include "scene/geometry/triangle.h"
+#include "scene/material.h"
+#include "util/bounding_box.h"
+#include "util/kd_tree.h"
+#include "util/point3.h"
+#include "util/ray.h"
+#include "util/vector3.h"
+
+namespace {
+
+// Number of rays in each ray set. Coherent sets form a square grid.
+const size_t kGridSize = 64;
+const size_t kNumRays = kGridSize * kGridSize;
+
+// Random rays start at this distance from the origin and point at a uniformly
+// chosen point in the cube of half side kSpread around the origin.
+const Scalar kEyeDistance = 10;
+const Scalar kSpread = 3;
+
+// Seed used for all random ray sets so that runs are comparable.
+const unsigned int kSeed = 42;
+
+// Resolution of the tessellated sphere which the KdTree is built for.
+const size_t kMeshRings = 64;
+const size_t kMeshSegments = 128;
+
+// Coherent rays cover a square window of half side kHalfExtent around their
+// target. All targets are placed around the origin and cover that window.
+const Scalar kHalfExtent = 0.3;
+
+// Describes where the grid of coherent rays is aimed.
+struct View {
+  View() : eye(0, 0, -kEyeDistance), hit_target(0, 0, 0),
+           miss_target(3, 0, 0) {}
+  Point3 eye;
+  Point3 hit_target;
+  Point3 miss_target;
+};
+
+const Material& DummyMaterial() {
+  static const Material material(NULL, NULL, NULL, NULL, 0, 0, 0, 0);
+  return material;
+}
+
+// Returns whether ray hits the target. Elements and the KdTree search for the
+// closest hit, just like the renderer does for primary rays.
+template<class Target>
+bool Hits(const Target& target, const Ray& ray) {
+  IntersectionData data(ray);
+  return target.Intersect(ray, &data);
+}
+
+bool Hits(const BoundingBox& box, const Ray& ray) {
+  Scalar t_near, t_far;
+  return box.Intersect(ray, &t_near, &t_far);
+}
+
+// Generates random rays and keeps those whose outcome against target is hit.
+template<class Target>
+std::vector<Ray> RandomRays(const Target& target, bool hit) {
+  std::mt19937 engine(kSeed);
+  std::uniform_real_distribution<Scalar> uniform(-1, 1);
+  std::vector<Ray> rays;
+  rays.reserve(kNumRays);
+  while (rays.size() < kNumRays) {
+    Vector3 direction(uniform(engine), uniform(engine), uniform(engine));
+    if (direction.SquaredLength() > 1 || direction.SquaredLength() < 1e-3) {
+      continue;
+    }
+    Point3 origin = Point3(0, 0, 0) + kEyeDistance * direction.Normalized();
+    Point3 aim(kSpread * uniform(engine), kSpread * uniform(engine),
+               kSpread * uniform(engine));
+    Ray ray(origin, origin.VectorTo(aim));
+    if (Hits(target, ray) == hit) {
+      rays.push_back(ray);
+    }
+  }
+  return rays;
+}
+
+// Generates a square grid of rays from the eye through a window around the
+// hit or miss target of the view. Neighbouring rays are nearly parallel.
+std::vector<Ray> CoherentRays(const View& view, bool hit) {
+  const Point3& target = hit ? view.hit_target : view.miss_target;
+  Vector3 forward = view.eye.VectorTo(target).Normalized();
+  Vector3 up(0, 1, 0);
+  if (std::abs(forward.Dot(up)) > 0.9) {
+    up = Vector3(1, 0, 0);
+  }
+  Vector3 right = forward.Cross(up).Normalized();
+  up = right.Cross(forward);
+
+  std::vector<Ray> rays;
+  rays.reserve(kNumRays);
+  const Scalar step = 2 * kHalfExtent / (kGridSize - 1);
+  for (size_t y = 0; y < kGridSize; ++y) {
+    for (size_t x = 0; x < kGridSize; ++x) {
+      Point3 aim = target
+          + (x * step - kHalfExtent) * right
+          + (y * step - kHalfExtent) * up;
+      rays.push_back(Ray(view.eye, view.eye.VectorTo(aim)));
+    }
+  }
+  return rays;
+}
+
+// Runs the benchmark for target over the ray set selected by the arguments.
+// Reports throughput in rays per second and the average time per ray.
+template<class Target>
+void RunIntersect(benchmark::State& state, const Target& target,
+                  const View& view = View()) {
+  const bool coherent = state.range(0);
+  const bool hit = state.range(1);
+  const std::vector<Ray> rays =
+      coherent ? CoherentRays(view, hit) : RandomRays(target, hit);
+  for (size_t i = 0; i < rays.size(); ++i) {
+    if (Hits(target, rays[i]) != hit) {
+      state.SkipWithError("Ray set does not match the requested outcome");
+      return;
+    }
+  }
+
+  size_t hits = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      hits += Hits(target, rays[i]);
+    }
+    benchmark::DoNotOptimize(hits);
+  }
+
+  const double processed = double(state.iterations()) * rays.size();
+  state.SetItemsProcessed(int64_t(processed));
+  state.counters["time/ray"] = benchmark::Counter(
+      processed, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+// Registers the cross product of random/coherent and hit/miss ray sets.
+void RaySets(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgsProduct({{0, 1}, {1, 0}})->ArgNames({"coherent", "hit"});
+}
+
+void BM_TriangleIntersect(benchmark::State& state) {
+  // Equilateral triangle around the origin with an inscribed radius of 0.6.
+  Triangle triangle(Point3(0, 1.2, 0), Point3(-1.04, -0.6, 0),
+                    Point3(1.04, -0.6, 0), DummyMaterial());
+  RunIntersect(state, triangle);
+}
+BENCHMARK(BM_TriangleIntersect)->Apply(RaySets);
+
+void BM_SphereIntersect(benchmark::State& state) {
+  Sphere sphere(Point3(0, 0, 0), 1, DummyMaterial());
+  RunIntersect(state, sphere);
+}
+BENCHMARK(BM_SphereIntersect)->Apply(RaySets);
+
+void BM_PlaneIntersect(benchmark::State& state) {
+  // Every ray heading towards an infinite plane hits it, so coherent misses
+  // look away from the plane instead of past it.
+  Plane plane(Point3(0, 0, 0), Vector3(0, 0, -1), DummyMaterial());
+  View view;
+  view.miss_target = Point3(0, 0, -2 * kEyeDistance);
+  RunIntersect(state, plane, view);
+}
+BENCHMARK(BM_PlaneIntersect)->Apply(RaySets);
+
+void BM_BoundingBoxIntersect(benchmark::State& state) {
+  BoundingBox box(Point3(-1, -1, -1), Point3(1, 1, 1));
+  RunIntersect(state, box);
+}
+BENCHMARK(BM_BoundingBoxIntersect)->Apply(RaySets);
+
+// Holds a tessellated unit sphere and a KdTree built over its triangles.
+class MeshScene {
+ public:
+  MeshScene() : tree_(KdTree::FromConfig(raytracer::KdTreeConfig())) {
+    const Scalar pi = std::acos(Scalar(-1));
+    for (size_t ring = 0; ring < kMeshRings; ++ring) {
+      for (size_t segment = 0; segment < kMeshSegments; ++segment) {
+        Point3 p00 = Vertex(pi, ring, segment);
+        Point3 p01 = Vertex(pi, ring, segment + 1);
+        Point3 p10 = Vertex(pi, ring + 1, segment);
+        Point3 p11 = Vertex(pi, ring + 1, segment + 1);
+        elements_.push_back(std::unique_ptr<Element>(
+            new Triangle(p00, p10, p11, DummyMaterial())));
+        elements_.push_back(std::unique_ptr<Element>(
+            new Triangle(p00, p11, p01, DummyMaterial())));
+      }
+    }
+    std::vector<const Element*> elements;
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      elements.push_back(elements_[i].get());
+    }
+    tree_->Init(elements);
+  }
+
+  const KdTree& tree() const { return *tree_; }
+
+ private:
+  static Point3 Vertex(Scalar pi, size_t ring, size_t segment) {
+    Scalar theta = pi * ring / kMeshRings;
+    Scalar phi = 2 * pi * segment / kMeshSegments;
+    return Point3(std::sin(theta) * std::cos(phi), std::cos(theta),
+                  std::sin(theta) * std::sin(phi));
+  }
+
+  std::vector<std::unique_ptr<Element>> elements_;
+  std::unique_ptr<KdTree> tree_;
+};
+
+void BM_KdTreeIntersect(benchmark::State& state) {
+  static const MeshScene scene;
+  RunIntersect(state, scene.tree());
+}
+BENCHMARK(BM_KdTreeIntersect)->Apply(RaySets);
+
+}  // namespace
@@ -21,4 +21,4 @@
 # SOFTWARE.
 
 # A script used to start collecting build dependencies.
-sudo apt-get install libgtest-dev freeglut3 freeglut3-dev protobuf-compiler libprotobuf-dev libgoogle-glog-dev scons
+sudo apt-get install libgtest-dev freeglut3 freeglut3-dev protobuf-compiler libprotobuf-dev libgoogle-glog-dev zlib1g-dev libbenchmark-dev scons
@@ -26,10 +26,15 @@
 
 #include "listener/bmp_exporter.h"
 
+#include <algorithm>
 #include <fstream>
+#include <ostream>
+#include <vector>
 
+#include "renderer/image_kernels.h"
 #include "renderer/sampler/sampler.h"
 #include "util/color3.h"
+#include "util/trace.h"
 
 BmpExporter::BmpExporter(const std::string& file_name) : file_name_(file_name) {
 }
@@ -37,7 +42,8 @@ BmpExporter::BmpExporter(const std::string& file_name) : file_name_(file_name) {
 BmpExporter::~BmpExporter() {
 }
 
-static void WriteHeader(size_t width, size_t height, std::ofstream* stream) {
+// static
+std::string BmpExporter::Header(size_t width, size_t height) {
   const size_t filesize = 54 + 3 * width * height;
   char file_header[14] = {'B','M',0,0,0,0,0,0,0,0,54,0,0,0};
   char info_header[40] = {40,0,0,0,0,0,0,0,0,0,0,0,1,0,24,0};
@@ -56,7 +62,26 @@ static void WriteHeader(size_t width, size_t height, std::ofstream* stream) {
   info_header[10] = (char)(height>>16);
   info_header[11] = (char)(height>>24);
 
-  stream->write(file_header, 14).write(info_header, 40);
+  return std::string(file_header, 14) + std::string(info_header, 40);
+}
+
+// static
+size_t BmpExporter::RowSize(size_t width) {
+  // Due to alignment, rows are padded to a multiple of 4 bytes.
+  return (3 * width + 3) / 4 * 4;
+}
+
+// static
+void BmpExporter::EncodeRow(const Image& image, size_t y, char* out) {
+  const size_t width = image.SizeX();
+  unsigned char* bytes = reinterpret_cast<unsigned char*>(out);
+  ImageKernels::Quantize(image.RawData() + 3 * y * width, 3 * width, bytes);
+
+  // BMP stores the channels in the order blue, green, red.
+  for (size_t x = 0; x < width; ++x) {
+    std::swap(bytes[3 * x], bytes[3 * x + 2]);
+  }
+  std::fill(out + 3 * width, out + RowSize(width), 0);
 }
 
 void BmpExporter::Ended(const Sampler& sampler) {
@@ -68,26 +93,34 @@ void BmpExporter::Ended(const Sampler& sampler) {
 }
 
 void BmpExporter::Export(const Image& image) {
-  const size_t width = image.SizeX();
-  const size_t height = image.SizeY();
-
   LOG(INFO) << "Exporting image " << file_name_;
   std::ofstream file_stream(file_name_, std::ofstream::binary);
-  WriteHeader(width, height, &file_stream);
-
-  // Due to alignment, we must append the following number of bytes as padding.
-  const size_t extra_bytes = (4 - (width * 3) % 4) % 4;
-  char padding[3] = {0, 0, 0};
-
-  for (size_t y = 0; y < height; ++y) {
-    for (size_t x = 0; x < width; ++x) {
-      const Color3& pixel = image.PixelAt(x, y);
-      char buffer[3] = { (char)(pixel.b() * 255),
-                         (char)(pixel.g() * 255),
-                         (char)(pixel.r() * 255) };
-      file_stream.write(buffer, 3);
-    }
-    file_stream.write(padding, extra_bytes);
-  }
+  Write(image, &file_stream);
   file_stream.close();
 }
+
+// static
+void BmpExporter::Write(const Image& image, std::ostream* stream) {
+  ScopedSpan span("BmpExporter::Write");
+  const std::string header = Header(image.SizeX(), image.SizeY());
+  stream->write(header.data(), header.size());
+
+  // Encode the rows in batches so that the stream sees few large writes. The
+  // rows of a batch are encoded in parallel.
+  const size_t row_size = RowSize(image.SizeX());
+  const size_t batch_rows = std::max<size_t>(1, kWriteBufferSize / row_size);
+  std::vector<char> buffer(batch_rows * row_size);
+  for (size_t y = 0; y < image.SizeY(); y += batch_rows) {
+    const size_t rows = std::min(batch_rows, image.SizeY() - y);
+    ImageKernels::ParallelFor(rows, row_size,
+                              [&](size_t chunk, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        EncodeRow(image, y + i, &buffer[i * row_size]);
+      }
+    });
+    stream->write(&buffer[0], rows * row_size);
+  }
+}
+
+// static
+const size_t BmpExporter::kWriteBufferSize = 1 << 22;
@@ -28,6 +28,7 @@
 #ifndef BMPEXPORTER_H_
 #define BMPEXPORTER_H_
 
+#include <ostream>
 #include <string>
 
 #include "renderer/updatable.h"
@@ -47,9 +48,25 @@ class BmpExporter : public Updatable {
   // Writes the image to the file.
   void Export(const Image& image);
 
+  // Writes the image to the stream in BMP format.
+  static void Write(const Image& image, std::ostream* stream);
+
+  // Returns the BMP header of an image of the passed size.
+  static std::string Header(size_t width, size_t height);
+
+  // Returns the number of bytes of an encoded row, including padding.
+  static size_t RowSize(size_t width);
+
+  // Encodes the row y of the image into the RowSize(image.SizeX()) bytes
+  // starting at out. As in the file, rows are stored bottom to top.
+  static void EncodeRow(const Image& image, size_t y, char* out);
+
  private:
   // Full path to the resulting file.
   const std::string file_name_;
+
+  // The approximate number of bytes handed to the stream at once.
+  static const size_t kWriteBufferSize;
 };
 
 #endif  /* BMPEXPORTER_H_ */
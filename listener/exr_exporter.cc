@@ -0,0 +1,211 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "listener/exr_exporter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <glog/logging.h>
+#include <vector>
+#include <zlib.h>
+
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
+#include "renderer/sampler/sampler.h"
+#include "util/trace.h"
+
+// Values of the attributes of the OpenEXR header.
+static const int32_t kHalfPixelType = 1;
+static const char kZipCompression = 3;
+static const char kIncreasingY = 0;
+
+// OpenEXR stores all numbers in little endian byte order.
+template<typename T>
+static void AppendLittleEndian(T value, std::string* out) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(value));
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    out->push_back(char(bits >> (8 * i)));
+  }
+}
+
+// Appends an attribute of the header, consisting of name, type, size and value.
+static void AppendAttribute(const char* name, const char* type,
+                            const std::string& value, std::string* out) {
+  out->append(name, strlen(name) + 1);
+  out->append(type, strlen(type) + 1);
+  AppendLittleEndian(int32_t(value.size()), out);
+  out->append(value);
+}
+
+// Returns a box2i attribute value covering an image of the passed size.
+static std::string Box(size_t width, size_t height) {
+  std::string box;
+  AppendLittleEndian(int32_t(0), &box);
+  AppendLittleEndian(int32_t(0), &box);
+  AppendLittleEndian(int32_t(width - 1), &box);
+  AppendLittleEndian(int32_t(height - 1), &box);
+  return box;
+}
+
+// Encodes the lines [begin, end) of the image into a block. OpenEXR lines go
+// from top to bottom, and within a line, all values of the first channel (in
+// alphabetical order) come first.
+static void EncodeBlock(const Image& image, size_t begin, size_t end,
+                        std::string* out) {
+  const size_t width = image.SizeX();
+  const size_t height = image.SizeY();
+  std::vector<uint16_t> halves(3 * width);
+  std::vector<unsigned char> raw;
+  raw.reserve((end - begin) * 3 * width * sizeof(uint16_t));
+  for (size_t line = begin; line < end; ++line) {
+    ImageKernels::ToHalf(image.RawData() + 3 * width * (height - line - 1),
+                         3 * width, halves.data());
+    // The image stores R, G, B per pixel, the file B, G and R per line.
+    for (int channel = 2; channel >= 0; --channel) {
+      for (size_t x = 0; x < width; ++x) {
+        const uint16_t value = halves[3 * x + channel];
+        raw.push_back(value & 0xff);
+        raw.push_back(value >> 8);
+      }
+    }
+  }
+
+  // Separate the low and high bytes and store differences between neighbors,
+  // which makes the data much more compressible.
+  std::vector<unsigned char> predicted(raw.size());
+  const size_t half = (raw.size() + 1) / 2;
+  for (size_t i = 0; i < raw.size(); ++i) {
+    predicted[i % 2 == 0 ? i / 2 : half + i / 2] = raw[i];
+  }
+  for (size_t i = predicted.size(); i-- > 1;) {
+    predicted[i] = predicted[i] - predicted[i - 1] + 128;
+  }
+
+  uLongf size = compressBound(predicted.size());
+  out->resize(size);
+  if (compress2(reinterpret_cast<Bytef*>(&(*out)[0]), &size,
+                predicted.data(), predicted.size(), Z_DEFAULT_COMPRESSION)
+      != Z_OK || size >= raw.size()) {
+    // Blocks which do not shrink are stored uncompressed.
+    out->assign(raw.begin(), raw.end());
+  } else {
+    out->resize(size);
+  }
+}
+
+ExrExporter::ExrExporter(const std::string& file_name)
+    : file_name_(file_name) {
+}
+
+ExrExporter::~ExrExporter() {
+}
+
+void ExrExporter::Ended(const Sampler& sampler) {
+  if (sampler.image().SizeX() == 0 || sampler.image().SizeY() == 0) {
+    LOG(INFO) << "Empty image, not exporting to file: " << file_name_;
+    return;
+  }
+  Export(sampler.image());
+}
+
+void ExrExporter::Export(const Image& image) {
+  LOG(INFO) << "Exporting image " << file_name_;
+  std::ofstream file_stream(file_name_, std::ofstream::binary);
+  Write(image, &file_stream);
+  file_stream.close();
+}
+
+// static
+void ExrExporter::Write(const Image& image, std::ostream* stream) {
+  ScopedSpan span("ExrExporter::Write");
+  const size_t width = image.SizeX();
+  const size_t height = image.SizeY();
+
+  std::string header("\x76\x2f\x31\x01", 4);
+  AppendLittleEndian(int32_t(2), &header);
+
+  std::string channels;
+  for (const char* name : { "B", "G", "R" }) {
+    channels.append(name, 2);
+    AppendLittleEndian(kHalfPixelType, &channels);
+    // Not linear, three reserved bytes, and no subsampling.
+    channels.append(4, '\0');
+    AppendLittleEndian(int32_t(1), &channels);
+    AppendLittleEndian(int32_t(1), &channels);
+  }
+  channels.push_back('\0');
+  AppendAttribute("channels", "chlist", channels, &header);
+  AppendAttribute("compression", "compression",
+                  std::string(1, kZipCompression), &header);
+  AppendAttribute("dataWindow", "box2i", Box(width, height), &header);
+  AppendAttribute("displayWindow", "box2i", Box(width, height), &header);
+  AppendAttribute("lineOrder", "lineOrder", std::string(1, kIncreasingY),
+                  &header);
+  std::string one;
+  AppendLittleEndian(1.0f, &one);
+  AppendAttribute("pixelAspectRatio", "float", one, &header);
+  std::string center;
+  AppendLittleEndian(0.0f, &center);
+  AppendLittleEndian(0.0f, &center);
+  AppendAttribute("screenWindowCenter", "v2f", center, &header);
+  AppendAttribute("screenWindowWidth", "float", one, &header);
+  header.push_back('\0');
+
+  // Compress the blocks in parallel.
+  const size_t blocks = (height + kLinesPerBlock - 1) / kLinesPerBlock;
+  std::vector<std::string> data(blocks);
+  ImageKernels::ParallelFor(blocks, 3 * width * kLinesPerBlock,
+                            [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      EncodeBlock(image, i * kLinesPerBlock,
+                  std::min(height, (i + 1) * kLinesPerBlock), &data[i]);
+    }
+  });
+
+  // The header is followed by the file offset of every block. Each block
+  // starts with its first line and its size.
+  std::string offsets;
+  uint64_t offset = header.size() + blocks * sizeof(uint64_t);
+  for (size_t i = 0; i < blocks; ++i) {
+    AppendLittleEndian(offset, &offsets);
+    offset += 2 * sizeof(int32_t) + data[i].size();
+  }
+  stream->write(header.data(), header.size());
+  stream->write(offsets.data(), offsets.size());
+  for (size_t i = 0; i < blocks; ++i) {
+    std::string prefix;
+    AppendLittleEndian(int32_t(i * kLinesPerBlock), &prefix);
+    AppendLittleEndian(int32_t(data[i].size()), &prefix);
+    stream->write(prefix.data(), prefix.size());
+    stream->write(data[i].data(), data[i].size());
+  }
+}
+
+// static
+const size_t ExrExporter::kLinesPerBlock = 16;
@@ -0,0 +1,65 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Can dump an image to disk as an OpenEXR file, which preserves the unclamped
+ * intensities. The channels are stored as half precision floats in blocks of
+ * scanlines, which are compressed with zlib on parallel threads.
+ * Author: Dino Wernli
+ */
+
+#ifndef EXR_EXPORTER_H_
+#define EXR_EXPORTER_H_
+
+#include <ostream>
+#include <string>
+
+#include "renderer/updatable.h"
+#include "util/no_copy_assign.h"
+
+class Image;
+class Sampler;
+
+class ExrExporter : public Updatable {
+ public:
+  ExrExporter(const std::string& file_name);
+  virtual ~ExrExporter();
+  NO_COPY_ASSIGN(ExrExporter);
+
+  virtual void Ended(const Sampler& sampler);
+
+  // Writes the image to the file.
+  void Export(const Image& image);
+
+  // Writes the image to the stream as a scanline OpenEXR file with half
+  // precision R, G and B channels and ZIP compression.
+  static void Write(const Image& image, std::ostream* stream);
+
+  // The number of scanlines compressed together, as mandated by the format.
+  static const size_t kLinesPerBlock;
+
+ private:
+  // Full path to the resulting file.
+  const std::string file_name_;
+};
+
+#endif  /* EXR_EXPORTER_H_ */
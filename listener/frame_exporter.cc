@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Author: Dino Wernli
+ */
+
+#include "listener/frame_exporter.h"
+
+#include <cstdio>
+#include <glog/logging.h>
+
+#include "listener/bmp_exporter.h"
+#include "listener/ppm_exporter.h"
+#include "renderer/image.h"
+#include "renderer/sampler/sampler.h"
+
+FrameExporter::FrameExporter(const std::string& bmp_prefix,
+                             const std::string& ppm_prefix,
+                             size_t max_pending)
+    : bmp_prefix_(bmp_prefix), ppm_prefix_(ppm_prefix),
+      max_pending_(max_pending > 0 ? max_pending : 1), next_frame_(0),
+      done_(false), thread_(&FrameExporter::ExportMain, this) {
+}
+
+FrameExporter::~FrameExporter() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    done_ = true;
+  }
+  changed_.notify_all();
+  thread_.join();
+}
+
+void FrameExporter::Ended(const Sampler& sampler) {
+  const size_t frame = next_frame_++;
+  if (sampler.image().SizeX() == 0 || sampler.image().SizeY() == 0) {
+    LOG(INFO) << "Empty image, not exporting frame " << frame;
+    return;
+  }
+
+  // Copying the image is cheap compared to writing it and lets the sampler
+  // start on the next frame right away.
+  std::unique_ptr<Image> image(new Image(sampler.image()));
+  std::unique_lock<std::mutex> guard(lock_);
+  changed_.wait(guard, [this]() { return pending_.size() < max_pending_; });
+  pending_.push_back(std::make_pair(frame, std::move(image)));
+  guard.unlock();
+  changed_.notify_all();
+}
+
+// static
+std::string FrameExporter::FileName(const std::string& prefix, size_t frame,
+                                    const std::string& extension) {
+  char number[32];
+  snprintf(number, sizeof(number), "_%04zu.", frame);
+  return prefix + number + extension;
+}
+
+void FrameExporter::ExportMain() {
+  std::unique_lock<std::mutex> guard(lock_);
+  while (true) {
+    changed_.wait(guard, [this]() { return done_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+
+    // Keep the frame in the queue while it is written so that it counts
+    // towards the pending frames.
+    const size_t frame = pending_.front().first;
+    const Image& image = *pending_.front().second;
+    guard.unlock();
+    if (!bmp_prefix_.empty()) {
+      BmpExporter(FileName(bmp_prefix_, frame, "bmp")).Export(image);
+    }
+    if (!ppm_prefix_.empty()) {
+      PpmExporter(FileName(ppm_prefix_, frame, "ppm")).Export(image);
+    }
+    guard.lock();
+    pending_.pop_front();
+    changed_.notify_all();
+  }
+}
@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Exports every frame rendered by a renderer to numbered files. The files are
+ * written on a background thread, which allows the renderer to start tracing
+ * the next frame while the previous one is still being exported.
+ * Author: Dino Wernli
+ */
+
+#ifndef FRAME_EXPORTER_H_
+#define FRAME_EXPORTER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "renderer/updatable.h"
+#include "util/no_copy_assign.h"
+
+class Image;
+class Sampler;
+
+class FrameExporter : public Updatable {
+ public:
+  // Frame i is exported to "<bmp_prefix>_<i>.bmp" and "<ppm_prefix>_<i>.ppm".
+  // An empty prefix disables the respective format. Once "max_pending" frames
+  // are waiting to be written, Ended() blocks until one of them is done.
+  FrameExporter(const std::string& bmp_prefix, const std::string& ppm_prefix,
+                size_t max_pending = 2);
+
+  // Waits until all frames have been written.
+  virtual ~FrameExporter();
+  NO_COPY_ASSIGN(FrameExporter);
+
+  virtual void Ended(const Sampler& sampler);
+
+  // Returns the name of the file to which a frame is exported.
+  static std::string FileName(const std::string& prefix, size_t frame,
+                              const std::string& extension);
+
+ private:
+  // Serves as the method passed to the export thread.
+  void ExportMain();
+
+  const std::string bmp_prefix_;
+  const std::string ppm_prefix_;
+  const size_t max_pending_;
+
+  // The index of the next frame to be handed in.
+  size_t next_frame_;
+
+  // Copies of the frames which still need to be written, oldest first.
+  std::deque<std::pair<size_t, std::unique_ptr<Image>>> pending_;
+  bool done_;
+  std::mutex lock_;
+  std::condition_variable changed_;
+  std::thread thread_;
+};
+
+#endif  /* FRAME_EXPORTER_H_ */
@@ -0,0 +1,249 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "listener/png_exporter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <glog/logging.h>
+#include <limits>
+#include <vector>
+#include <zlib.h>
+
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
+#include "renderer/sampler/sampler.h"
+#include "util/trace.h"
+
+// The number of bytes per pixel.
+static const size_t kPixelSize = 3;
+
+// The uncompressed bytes deflated by a single thread at once.
+static const size_t kChunkSize = 1 << 18;
+
+// The size of the deflate window, i.e., the largest useful dictionary.
+static const size_t kWindowSize = 1 << 15;
+
+// The maximum size of an IDAT chunk.
+static const size_t kMaxIdatSize = 1 << 20;
+
+static void AppendUint32(uint32_t value, std::string* out) {
+  out->push_back(char(value >> 24));
+  out->push_back(char(value >> 16));
+  out->push_back(char(value >> 8));
+  out->push_back(char(value));
+}
+
+// Writes a PNG chunk consisting of length, type, data and checksum.
+static void WriteChunk(const char* type, const char* data, size_t size,
+                       std::ostream* stream) {
+  std::string header;
+  AppendUint32(size, &header);
+  header.append(type, 4);
+  uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+  if (size > 0) {
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data), size);
+  }
+  std::string checksum;
+  AppendUint32(crc, &checksum);
+
+  stream->write(header.data(), header.size());
+  stream->write(data, size);
+  stream->write(checksum.data(), checksum.size());
+}
+
+// Returns the predictor of the Paeth filter for the passed neighbors.
+static unsigned char Paeth(int left, int up, int up_left) {
+  const int estimate = left + up - up_left;
+  const int distance_left = std::abs(estimate - left);
+  const int distance_up = std::abs(estimate - up);
+  const int distance_up_left = std::abs(estimate - up_left);
+  if (distance_left <= distance_up && distance_left <= distance_up_left) {
+    return left;
+  }
+  return distance_up <= distance_up_left ? up : up_left;
+}
+
+// Stores the filter type followed by the filtered row in out. Picks the filter
+// type with the smallest sum of absolute differences, as recommended by the
+// PNG specification. The previous row is all zeros for the first row.
+static void FilterRow(const unsigned char* row, const unsigned char* previous,
+                      size_t size, unsigned char* out) {
+  std::vector<unsigned char> candidate(size);
+  size_t best_cost = std::numeric_limits<size_t>::max();
+  for (unsigned char type = 0; type < 5; ++type) {
+    size_t cost = 0;
+    for (size_t i = 0; i < size; ++i) {
+      const int left = i >= kPixelSize ? row[i - kPixelSize] : 0;
+      const int up = previous[i];
+      const int up_left = i >= kPixelSize ? previous[i - kPixelSize] : 0;
+      int predictor = 0;
+      switch (type) {
+        case 1: predictor = left; break;
+        case 2: predictor = up; break;
+        case 3: predictor = (left + up) / 2; break;
+        case 4: predictor = Paeth(left, up, up_left); break;
+      }
+      candidate[i] = row[i] - predictor;
+      cost += std::abs(int(static_cast<signed char>(candidate[i])));
+    }
+    if (cost < best_cost) {
+      best_cost = cost;
+      out[0] = type;
+      std::copy(candidate.begin(), candidate.end(), out + 1);
+    }
+  }
+}
+
+// Deflates data[begin, end) into a raw deflate stream which can be
+// concatenated with the streams of the neighboring chunks. Returns false if
+// zlib reports an error.
+static bool DeflateChunk(const std::vector<unsigned char>& data, size_t begin,
+                         size_t end, int level, std::string* out) {
+  z_stream stream = z_stream();
+  if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  if (begin > 0) {
+    const size_t dictionary = std::min(begin, kWindowSize);
+    deflateSetDictionary(&stream, &data[begin - dictionary], dictionary);
+  }
+
+  const bool last = end == data.size();
+  out->resize(deflateBound(&stream, end - begin) + 16);
+  stream.next_in = const_cast<Bytef*>(data.data() + begin);
+  stream.avail_in = end - begin;
+  stream.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  stream.avail_out = out->size();
+
+  // All but the last chunk end on a byte boundary without a final block.
+  const int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  out->resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == (last ? Z_STREAM_END : Z_OK) && stream.avail_in == 0;
+}
+
+PngExporter::PngExporter(const std::string& file_name, int level)
+    : file_name_(file_name), level_(level) {
+}
+
+PngExporter::~PngExporter() {
+}
+
+void PngExporter::Ended(const Sampler& sampler) {
+  if (sampler.image().SizeX() == 0 || sampler.image().SizeY() == 0) {
+    LOG(INFO) << "Empty image, not exporting to file: " << file_name_;
+    return;
+  }
+  Export(sampler.image());
+}
+
+void PngExporter::Export(const Image& image) {
+  LOG(INFO) << "Exporting image " << file_name_;
+  std::ofstream file_stream(file_name_, std::ofstream::binary);
+  Write(image, &file_stream, level_);
+  file_stream.close();
+}
+
+// static
+void PngExporter::Write(const Image& image, std::ostream* stream, int level) {
+  ScopedSpan span("PngExporter::Write");
+  const size_t width = image.SizeX();
+  const size_t height = image.SizeY();
+  const size_t row_size = kPixelSize * width;
+
+  // PNG stores the rows top to bottom, each prefixed by its filter type.
+  std::vector<unsigned char> pixels(row_size * height);
+  std::vector<unsigned char> filtered((row_size + 1) * height);
+  ImageKernels::ParallelFor(height, row_size,
+                            [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t y = begin; y < end; ++y) {
+      ImageKernels::Quantize(image.RawData() + (height - y - 1) * row_size,
+                             row_size, &pixels[y * row_size]);
+    }
+  });
+  const std::vector<unsigned char> zeros(row_size, 0);
+  ImageKernels::ParallelFor(height, row_size,
+                            [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t y = begin; y < end; ++y) {
+      const unsigned char* previous =
+          y == 0 ? zeros.data() : &pixels[(y - 1) * row_size];
+      FilterRow(&pixels[y * row_size], previous, row_size,
+                &filtered[y * (row_size + 1)]);
+    }
+  });
+
+  // Deflate the chunks in parallel and concatenate them into a zlib stream.
+  const size_t chunks = std::max<size_t>(
+      1, (filtered.size() + kChunkSize - 1) / kChunkSize);
+  std::vector<std::string> compressed(chunks);
+  std::vector<uLong> checksums(chunks);
+  std::vector<char> failed(chunks, 0);
+  ImageKernels::ParallelFor(chunks, kChunkSize,
+                            [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const size_t from = i * kChunkSize;
+      const size_t to = std::min(filtered.size(), from + kChunkSize);
+      failed[i] = !DeflateChunk(filtered, from, to, level, &compressed[i]);
+      checksums[i] = adler32(adler32(0, NULL, 0), &filtered[from], to - from);
+    }
+  });
+
+  std::string data("\x78\x9c", 2);
+  uLong checksum = adler32(0, NULL, 0);
+  for (size_t i = 0; i < chunks; ++i) {
+    if (failed[i]) {
+      LOG(ERROR) << "Failed to compress PNG data";
+      return;
+    }
+    data += compressed[i];
+    const size_t size = std::min(filtered.size() - i * kChunkSize, kChunkSize);
+    checksum = adler32_combine(checksum, checksums[i], size);
+  }
+  AppendUint32(checksum, &data);
+
+  static const char kSignature[] = "\x89PNG\r\n\x1a\n";
+  stream->write(kSignature, 8);
+
+  std::string header;
+  AppendUint32(width, &header);
+  AppendUint32(height, &header);
+  // Bit depth 8, truecolor, no interlacing.
+  header.append("\x08\x02\x00\x00\x00", 5);
+  WriteChunk("IHDR", header.data(), header.size(), stream);
+
+  for (size_t offset = 0; offset < data.size(); offset += kMaxIdatSize) {
+    const size_t size = std::min(kMaxIdatSize, data.size() - offset);
+    WriteChunk("IDAT", data.data() + offset, size, stream);
+  }
+  WriteChunk("IEND", NULL, 0, stream);
+}
+
+// static
+const int PngExporter::kDefaultLevel = 6;
@@ -0,0 +1,67 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Can dump an image to disk as a PNG file. The image data is deflated in
+ * independent chunks on parallel threads. Every chunk is primed with the end
+ * of the previous one as dictionary, so the compression ratio is close to the
+ * one of a single stream.
+ * Author: Dino Wernli
+ */
+
+#ifndef PNG_EXPORTER_H_
+#define PNG_EXPORTER_H_
+
+#include <ostream>
+#include <string>
+
+#include "renderer/updatable.h"
+#include "util/no_copy_assign.h"
+
+class Image;
+class Sampler;
+
+class PngExporter : public Updatable {
+ public:
+  // The level is passed to zlib, from 1 (fastest) to 9 (smallest).
+  PngExporter(const std::string& file_name, int level = kDefaultLevel);
+  virtual ~PngExporter();
+  NO_COPY_ASSIGN(PngExporter);
+
+  virtual void Ended(const Sampler& sampler);
+
+  // Writes the image to the file.
+  void Export(const Image& image);
+
+  // Writes the image to the stream in PNG format, with 8 bits per channel.
+  static void Write(const Image& image, std::ostream* stream,
+                    int level = kDefaultLevel);
+
+  static const int kDefaultLevel;
+
+ private:
+  // Full path to the resulting file.
+  const std::string file_name_;
+  const int level_;
+};
+
+#endif  /* PNG_EXPORTER_H_ */
@@ -26,17 +26,19 @@
 
 #include "listener/ppm_exporter.h"
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <fstream>
+#include <vector>
 
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
 #include "renderer/sampler/sampler.h"
 #include "util/color3.h"
+#include "util/trace.h"
 
-// Transforms an intensity in range [0, 1] to an integer in
-// {0, ..., kMaxPixelValue}.
-unsigned int ScaleIntensity(Intensity intensity) {
-  return intensity * PpmExporter::kMaxPixelValue;
-}
+// The number of characters of kMaxPixelValue.
+static const size_t kValueWidth = 3;
 
 PpmExporter::PpmExporter(const std::string& file_name) : file_name_(file_name) {
 }
@@ -53,28 +55,72 @@ void PpmExporter::Ended(const Sampler& sampler) {
 }
 
 void PpmExporter::Export(const Image& image) {
+  ScopedSpan span("PpmExporter::Export");
   LOG(INFO) << "Exporting image to file: " << file_name_;
   std::ofstream file_stream(file_name_);
 
-  file_stream << kMagicNumber << std::endl;
-  file_stream << image.SizeX() << " " << image.SizeY() << std::endl;
-  file_stream << kMaxPixelValue << std::endl;
-
-  for (size_t y = 0; y < image.SizeY(); ++y) {
-    for (size_t x = 0; x < image.SizeX(); ++x) {
-      // The image stores the bottom left pixel as (0, 0), we need to start with
-      // the top left pixel. So flip the y coordinate.
-      const Color3& color = image.PixelAt(x, image.SizeY() - y - 1);
-      file_stream << ScaleIntensity(color.r()) << " "
-                  << ScaleIntensity(color.g()) << " "
-                  << ScaleIntensity(color.b()) << " ";
+  file_stream << kMagicNumber << "\n";
+  file_stream << image.SizeX() << " " << image.SizeY() << "\n";
+  file_stream << kMaxPixelValue << "\n";
+
+  // Encode the rows in batches, where the rows of a batch are encoded in
+  // parallel.
+  const size_t height = image.SizeY();
+  const size_t batch_rows = std::max<size_t>(
+      1, kBatchPixels / std::max<size_t>(1, image.SizeX()));
+  std::vector<std::string> rows(std::min(batch_rows, height));
+  for (size_t y = 0; y < height; y += batch_rows) {
+    const size_t n = std::min(batch_rows, height - y);
+    ImageKernels::ParallelFor(n, 3 * image.SizeX(),
+                              [&](size_t chunk, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        // The image stores the bottom left pixel as (0, 0), we need to start
+        // with the top left pixel. So flip the y coordinate.
+        rows[i].clear();
+        EncodeRow(image, height - (y + i) - 1, false, &rows[i]);
+      }
+    });
+    for (size_t i = 0; i < n; ++i) {
+      file_stream.write(rows[i].data(), rows[i].size());
     }
-    file_stream << std::endl;
   }
-  file_stream << std::endl;
+  file_stream << "\n";
   file_stream.close();
 }
 
+// static
+void PpmExporter::EncodeRow(const Image& image, size_t y, bool fixed_width,
+                            std::string* out) {
+  const size_t n = 3 * image.SizeX();
+  std::vector<unsigned char> values(n);
+  ImageKernels::Quantize(image.RawData() + y * n, n, values.data());
+
+  out->reserve(out->size() + FixedRowSize(image.SizeX()));
+  for (size_t i = 0; i < n; ++i) {
+    const unsigned int value = values[i];
+    char digits[kValueWidth + 1] = { ' ', ' ', ' ', ' ' };
+    size_t begin = kValueWidth;
+    for (unsigned int rest = value; begin == kValueWidth || rest > 0;
+         rest /= 10) {
+      digits[--begin] = '0' + rest % 10;
+    }
+    if (fixed_width) {
+      begin = 0;
+    }
+    out->append(digits + begin, digits + kValueWidth + 1);
+  }
+  out->push_back('\n');
+}
+
+// static
+size_t PpmExporter::FixedRowSize(size_t width) {
+  // Every value is followed by a space and every row by a newline.
+  return 3 * (kValueWidth + 1) * width + 1;
+}
+
+// static
+const size_t PpmExporter::kBatchPixels = 1 << 20;
+
 const size_t PpmExporter::kMaxPixelValue = 255;
 
 const std::string PpmExporter::kMagicNumber = "P3";
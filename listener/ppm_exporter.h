@@ -28,6 +28,7 @@
 #ifndef PPM_EXPORTER_H_
 #define PPM_EXPORTER_H_
 
+#include <cstddef>
 #include <string>
 
 #include "renderer/updatable.h"
@@ -50,9 +51,21 @@ class PpmExporter : public Updatable{
   // Writes the image to the file.
   void Export(const Image& image);
 
+  // Appends row y of the image, where row 0 is the bottom one, to out. If
+  // fixed_width is true, every value is padded to the same number of
+  // characters, so that every row has FixedRowSize(image.SizeX()) characters.
+  static void EncodeRow(const Image& image, size_t y, bool fixed_width,
+                        std::string* out);
+
+  // Returns the number of characters of a row encoded with fixed width.
+  static size_t FixedRowSize(size_t width);
+
  private:
   // Full path to the resulting file.
   const std::string file_name_;
+
+  // The approximate number of pixels encoded at once.
+  static const size_t kBatchPixels;
 };
 
 #endif  /* PPM_EXPORTER_H_ */
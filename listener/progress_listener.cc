@@ -37,6 +37,8 @@ ProgressListener::~ProgressListener() {
 }
 
 void ProgressListener::Started(const Sampler& sampler) {
+  // The same listener can observe several renderings in a row.
+  last_dumped_progess_ = -1;
   LogProgress(sampler);
 }
 
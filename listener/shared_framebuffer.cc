@@ -0,0 +1,259 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "listener/shared_framebuffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "renderer/image.h"
+#include "renderer/sampler/sampler.h"
+
+static_assert(sizeof(Intensity) == sizeof(float),
+              "The segment stores the intensities as floats");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "Readers wait on the generation as a plain 32 bit futex");
+
+// The sections of the segment start at multiples of this, in bytes.
+static const size_t kAlignment = 64;
+
+static size_t Align(size_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Wakes up all processes waiting for the generation to change.
+static void WakeReaders(std::atomic<uint32_t>* generation) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(generation), FUTEX_WAKE,
+          INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+SharedFramebuffer::SharedFramebuffer(const std::string& name, size_t tile_size)
+    : name_(name), tile_size_(std::max<size_t>(1, tile_size)), segment_(NULL),
+      segment_size_(0), header_(NULL), tile_generations_(NULL),
+      pixels_(NULL) {
+}
+
+SharedFramebuffer::~SharedFramebuffer() {
+  if (segment_ != NULL) {
+    header_->state.store(STALE);
+    header_->generation.fetch_add(2, std::memory_order_release);
+    WakeReaders(&header_->generation);
+    Unmap();
+    shm_unlink(name_.c_str());
+  }
+}
+
+void SharedFramebuffer::Started(const Sampler& sampler) {
+  std::unique_lock<std::mutex> guard(lock_);
+  if (sampler.width() == 0 || sampler.height() == 0 ||
+      !Map(sampler.width(), sampler.height())) {
+    return;
+  }
+  header_->state.store(RENDERING);
+  header_->progress.store(0);
+  Publish(sampler, NULL, 0);
+}
+
+void SharedFramebuffer::Updated(const Sampler& sampler) {
+  std::unique_lock<std::mutex> guard(lock_);
+  if (segment_ == NULL) {
+    return;
+  }
+  const Image& image = sampler.image();
+  if (image.SizeX() == header_->width && image.SizeY() == header_->height) {
+    Publish(sampler, &image, 0);
+  } else {
+    // The pixels arrive through RowsCompleted().
+    header_->progress.store(sampler.Progress());
+  }
+}
+
+void SharedFramebuffer::RowsCompleted(const Sampler& sampler,
+                                      const Image& band, size_t y) {
+  std::unique_lock<std::mutex> guard(lock_);
+  if (segment_ == NULL || band.SizeX() != header_->width ||
+      y + band.SizeY() > header_->height) {
+    return;
+  }
+  Publish(sampler, &band, y);
+}
+
+void SharedFramebuffer::Ended(const Sampler& sampler) {
+  std::unique_lock<std::mutex> guard(lock_);
+  if (segment_ == NULL) {
+    return;
+  }
+  header_->state.store(DONE);
+  const Image& image = sampler.image();
+  if (image.SizeX() == header_->width && image.SizeY() == header_->height) {
+    Publish(sampler, &image, 0);
+  } else {
+    Publish(sampler, NULL, 0);
+  }
+}
+
+bool SharedFramebuffer::Map(size_t width, size_t height) {
+  if (segment_ != NULL && header_->width == width &&
+      header_->height == height) {
+    return true;
+  }
+  if (segment_ != NULL) {
+    header_->state.store(STALE);
+    header_->generation.fetch_add(2, std::memory_order_release);
+    WakeReaders(&header_->generation);
+    Unmap();
+  }
+
+  const size_t tiles_x = (width + tile_size_ - 1) / tile_size_;
+  const size_t tiles_y = (height + tile_size_ - 1) / tile_size_;
+  const size_t num_tiles = tiles_x * tiles_y;
+  const size_t tile_generations_offset = Align(sizeof(Header));
+  const size_t pixels_offset =
+      Align(tile_generations_offset + sizeof(uint32_t) * num_tiles);
+  const size_t size = pixels_offset + 3 * sizeof(float) * width * height;
+
+  // Start from a fresh segment so that readers of a previous one are not
+  // confused by a change of size.
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to create shared memory " << name_ << ": "
+               << strerror(errno);
+    return false;
+  }
+  void* segment = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (segment == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map shared memory " << name_ << ": "
+               << strerror(errno);
+    shm_unlink(name_.c_str());
+    return false;
+  }
+
+  segment_ = static_cast<char*>(segment);
+  segment_size_ = size;
+  header_ = new (segment_) Header();
+  header_->version = kVersion;
+  header_->generation.store(0);
+  header_->state.store(RENDERING);
+  header_->width = width;
+  header_->height = height;
+  header_->tile_size = tile_size_;
+  header_->tiles_x = tiles_x;
+  header_->tiles_y = tiles_y;
+  header_->progress.store(0);
+  header_->tile_generations_offset = tile_generations_offset;
+  header_->pixels_offset = pixels_offset;
+  tile_generations_ = reinterpret_cast<std::atomic<uint32_t>*>(
+      segment_ + tile_generations_offset);
+  for (size_t i = 0; i < num_tiles; ++i) {
+    new (&tile_generations_[i]) std::atomic<uint32_t>(0);
+  }
+  pixels_ = reinterpret_cast<float*>(segment_ + pixels_offset);
+
+  // Readers check the magic number last, so it marks a complete header.
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = kMagic;
+  LOG(INFO) << "Publishing image in shared memory " << name_;
+  return true;
+}
+
+void SharedFramebuffer::Unmap() {
+  munmap(segment_, segment_size_);
+  segment_ = NULL;
+  segment_size_ = 0;
+  header_ = NULL;
+  tile_generations_ = NULL;
+  pixels_ = NULL;
+}
+
+void SharedFramebuffer::Publish(const Sampler& sampler, const Image* band,
+                                size_t y) {
+  const size_t width = header_->width;
+
+  // The even generation which ends this publication.
+  const uint32_t generation =
+      header_->generation.fetch_add(1, std::memory_order_relaxed) + 2;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (band != NULL && band->SizeY() > 0) {
+    const size_t end = y + band->SizeY();
+    for (size_t tile_y = y / tile_size_; tile_y * tile_size_ < end;
+         ++tile_y) {
+      const size_t row_begin = std::max(y, tile_y * tile_size_);
+      const size_t row_end = std::min(end, (tile_y + 1) * tile_size_);
+      for (size_t tile_x = 0; tile_x < header_->tiles_x; ++tile_x) {
+        const size_t x = tile_x * tile_size_;
+        const size_t bytes = 3 * sizeof(float) *
+                             std::min(tile_size_, width - x);
+        bool changed = false;
+        for (size_t row = row_begin; row < row_end; ++row) {
+          float* target = pixels_ + 3 * (row * width + x);
+          const float* source = band->RawData() + 3 * ((row - y) * width + x);
+          if (memcmp(target, source, bytes) != 0) {
+            memcpy(target, source, bytes);
+            changed = true;
+          }
+        }
+        if (changed) {
+          const size_t tile = tile_y * header_->tiles_x + tile_x;
+          tile_generations_[tile].store(generation,
+                                        std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+  header_->progress.store(sampler.Progress(), std::memory_order_relaxed);
+  header_->generation.fetch_add(1, std::memory_order_release);
+  WakeReaders(&header_->generation);
+}
+
+// static
+const uint32_t SharedFramebuffer::kMagic = 0x42465452;  // "RTFB"
+
+// static
+const uint32_t SharedFramebuffer::kVersion = 2;
+
+// static
+const size_t SharedFramebuffer::kTileSize = 32;
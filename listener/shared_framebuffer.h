@@ -0,0 +1,135 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Publishes the image being rendered in a POSIX shared memory segment, so that
+ * other processes, e.g., preview tools on headless render nodes, can map it
+ * and read the progress without copying or polling files.
+ *
+ * The segment starts with a Header, followed by one 32 bit generation per tile
+ * and the pixels as three floats (RGB) each, row by row from the bottom left.
+ * Every publication works like a seqlock: the generation is incremented to an
+ * odd value, the changed tiles are copied and stamped with the even generation
+ * which ends the publication, and the generation is incremented to that even
+ * value. Readers which see the same even generation before and after reading
+ * have a consistent view. The tiles which changed since a generation they saw
+ * earlier are the ones with a greater stamp, even if they skipped the
+ * generations in between. On Linux, every publication wakes up readers blocked
+ * on the generation with FUTEX_WAIT.
+ *
+ * Streamed bands are published by the worker thread which completed them.
+ * Comparing and copying their tiles happens while holding a lock, so workers
+ * completing bands at the same time wait for each other.
+ * Author: Dino Wernli
+ */
+
+#ifndef SHARED_FRAMEBUFFER_H_
+#define SHARED_FRAMEBUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "renderer/updatable.h"
+#include "util/no_copy_assign.h"
+
+class Image;
+class Sampler;
+
+class SharedFramebuffer : public Updatable {
+ public:
+  enum State {
+    RENDERING = 0,
+    DONE = 1,
+
+    // The segment has been replaced by one for an image of a different size,
+    // readers need to map the name again.
+    STALE = 2,
+  };
+
+  // The layout of the start of the segment.
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint32_t> state;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+
+    // The progress of the rendering, in [0, 1].
+    std::atomic<float> progress;
+
+    // Offsets from the start of the segment, in bytes.
+    uint64_t tile_generations_offset;
+    uint64_t pixels_offset;
+  };
+
+  // The name of the segment must start with a slash, e.g., "/raytracer". The
+  // segment is removed when the framebuffer is destroyed.
+  SharedFramebuffer(const std::string& name, size_t tile_size = kTileSize);
+  virtual ~SharedFramebuffer();
+  NO_COPY_ASSIGN(SharedFramebuffer);
+
+  virtual void Started(const Sampler& sampler);
+  virtual void Updated(const Sampler& sampler);
+  virtual void RowsCompleted(const Sampler& sampler, const Image& band,
+                             size_t y);
+  virtual void Ended(const Sampler& sampler);
+
+  static const uint32_t kMagic;
+  static const uint32_t kVersion;
+  static const size_t kTileSize;
+
+ private:
+  // Maps a segment for an image of the passed size, reusing the current one if
+  // the size matches. Returns false on failure.
+  bool Map(size_t width, size_t height);
+
+  // Removes the current mapping, if any.
+  void Unmap();
+
+  // Copies the tiles of the rows [y, y + band->SizeY()) which differ from the
+  // segment, where band holds these rows, and publishes them as a new
+  // generation. If band is NULL, only the header is published. Requires
+  // lock_ to be held.
+  void Publish(const Sampler& sampler, const Image* band, size_t y);
+
+  const std::string name_;
+  const size_t tile_size_;
+
+  // The mapped segment, or NULL.
+  char* segment_;
+  size_t segment_size_;
+
+  Header* header_;
+  std::atomic<uint32_t>* tile_generations_;
+  float* pixels_;
+
+  // Serializes publications, which may come from several worker threads.
+  std::mutex lock_;
+};
+
+#endif  /* SHARED_FRAMEBUFFER_H_ */
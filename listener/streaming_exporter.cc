@@ -0,0 +1,192 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "listener/streaming_exporter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#include "listener/bmp_exporter.h"
+#include "listener/ppm_exporter.h"
+#include "renderer/image.h"
+#include "renderer/sampler/sampler.h"
+
+StreamingExporter::StreamingExporter(const std::string& file_name,
+                                     Format format)
+    : file_name_(file_name), format_(format), fd_(-1), width_(0), height_(0),
+      header_size_(0), rows_written_(0) {
+}
+
+StreamingExporter::~StreamingExporter() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void StreamingExporter::Started(const Sampler& sampler) {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  width_ = sampler.width();
+  height_ = sampler.height();
+  rows_written_ = 0;
+  if (width_ == 0 || height_ == 0) {
+    LOG(INFO) << "Empty image, not exporting to file: " << file_name_;
+    return;
+  }
+
+  std::string header;
+  size_t trailer_size = 0;
+  if (format_ == BMP) {
+    header = BmpExporter::Header(width_, height_);
+  } else {
+    std::stringstream stream;
+    stream << PpmExporter::kMagicNumber << "\n" << width_ << " " << height_
+           << "\n" << PpmExporter::kMaxPixelValue << "\n";
+    header = stream.str();
+    trailer_size = 1;
+  }
+  header_size_ = header.size();
+
+  fd_ = open(file_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             0644);
+  if (fd_ < 0) {
+    LOG(ERROR) << "Failed to open " << file_name_ << ": " << strerror(errno);
+    return;
+  }
+
+  // Size the file up front so that bands can be written in any order.
+  const size_t file_size = header_size_ + height_ * RowSize() + trailer_size;
+  if (ftruncate(fd_, file_size) != 0 ||
+      !WriteAt(header.data(), header.size(), 0) ||
+      (trailer_size > 0 && !WriteAt("\n", 1, file_size - 1))) {
+    LOG(ERROR) << "Failed to prepare " << file_name_ << ": "
+               << strerror(errno);
+    close(fd_);
+    fd_ = -1;
+    return;
+  }
+  LOG(INFO) << "Streaming image to file: " << file_name_;
+}
+
+void StreamingExporter::RowsCompleted(const Sampler& sampler,
+                                      const Image& band, size_t y) {
+  if (fd_ < 0) {
+    return;
+  }
+  if (band.SizeX() != width_ || y + band.SizeY() > height_) {
+    LOG(WARNING) << "Skipping band of size [" << band.SizeX() << ", "
+                 << band.SizeY() << "] at row " << y << " of image of size ["
+                 << width_ << ", " << height_ << "]";
+    return;
+  }
+
+  // BMP stores the rows bottom to top, PPM top to bottom. Either way the rows
+  // of a band are contiguous in the file, so they go out in a single write.
+  const size_t row_size = RowSize();
+  const size_t rows = band.SizeY();
+  std::vector<char> buffer(rows * row_size);
+  size_t first_row;
+  if (format_ == BMP) {
+    for (size_t i = 0; i < rows; ++i) {
+      EncodeRow(band, i, &buffer[i * row_size]);
+    }
+    first_row = y;
+  } else {
+    for (size_t i = 0; i < rows; ++i) {
+      EncodeRow(band, rows - i - 1, &buffer[i * row_size]);
+    }
+    first_row = height_ - y - rows;
+  }
+
+  if (WriteAt(&buffer[0], buffer.size(), header_size_ + first_row * row_size)) {
+    rows_written_ += rows;
+  } else {
+    LOG(ERROR) << "Failed to write rows to " << file_name_ << ": "
+               << strerror(errno);
+  }
+}
+
+void StreamingExporter::Ended(const Sampler& sampler) {
+  if (fd_ < 0) {
+    return;
+  }
+
+  // Samplers which keep the full image in memory do not hand out bands.
+  const Image& image = sampler.image();
+  if (rows_written_ == 0 && image.SizeX() == width_ &&
+      image.SizeY() == height_) {
+    RowsCompleted(sampler, image, 0);
+  }
+  if (rows_written_ != height_) {
+    LOG(WARNING) << "Only wrote " << rows_written_ << " of " << height_
+                 << " rows to " << file_name_;
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+size_t StreamingExporter::RowSize() const {
+  if (format_ == BMP) {
+    return BmpExporter::RowSize(width_);
+  }
+  return PpmExporter::FixedRowSize(width_);
+}
+
+void StreamingExporter::EncodeRow(const Image& band, size_t y,
+                                  char* out) const {
+  if (format_ == BMP) {
+    BmpExporter::EncodeRow(band, y, out);
+    return;
+  }
+
+  std::string row;
+  PpmExporter::EncodeRow(band, y, true, &row);
+  std::copy(row.begin(), row.end(), out);
+}
+
+bool StreamingExporter::WriteAt(const char* data, size_t size, size_t offset) {
+  while (size > 0) {
+    ssize_t written = pwrite(fd_, data, size, offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
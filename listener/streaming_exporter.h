@@ -0,0 +1,95 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Writes an image to disk while it is being rendered. Every band of completed
+ * rows is encoded and written to its final position in the file right away,
+ * so the full image never needs to be held in memory. Supports the BMP format
+ * and a PPM variant with fixed width values, which allows placing each row
+ * independently.
+ * Author: Dino Wernli
+ */
+
+#ifndef STREAMING_EXPORTER_H_
+#define STREAMING_EXPORTER_H_
+
+#include <atomic>
+#include <string>
+
+#include "renderer/updatable.h"
+#include "util/no_copy_assign.h"
+
+class Image;
+class Sampler;
+
+class StreamingExporter : public Updatable {
+ public:
+  enum Format {
+    BMP,
+    PPM,
+  };
+
+  StreamingExporter(const std::string& file_name, Format format);
+  virtual ~StreamingExporter();
+  NO_COPY_ASSIGN(StreamingExporter);
+
+  // Creates the file with its final size and writes the header.
+  virtual void Started(const Sampler& sampler);
+
+  // Encodes the band and writes it to the file. Bands may arrive concurrently
+  // and in any order.
+  virtual void RowsCompleted(const Sampler& sampler, const Image& band,
+                             size_t y);
+
+  // Writes the full image of the sampler if it did not produce any bands, then
+  // closes the file.
+  virtual void Ended(const Sampler& sampler);
+
+ private:
+  // Returns the number of bytes of an encoded row.
+  size_t RowSize() const;
+
+  // Encodes row y of the band into the RowSize() bytes starting at out.
+  void EncodeRow(const Image& band, size_t y, char* out) const;
+
+  // Writes size bytes at offset, returns whether all of them were written.
+  bool WriteAt(const char* data, size_t size, size_t offset);
+
+  // Full path to the resulting file.
+  const std::string file_name_;
+  const Format format_;
+
+  // The file being written, or -1 if there is none.
+  int fd_;
+
+  // The size of the image being written.
+  size_t width_;
+  size_t height_;
+
+  // The number of bytes before the first row.
+  size_t header_size_;
+
+  // The number of rows written so far.
+  std::atomic<size_t> rows_written_;
+};
+
+#endif  /* STREAMING_EXPORTER_H_ */
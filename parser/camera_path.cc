@@ -0,0 +1,114 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Author: Dino Wernli
+ */
+
+#include "camera_path.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+
+static double Interpolate(double a, double b, double alpha) {
+  return (1 - alpha) * a + alpha * b;
+}
+
+// Works for both PointData and VectorData.
+template<typename T>
+static void Interpolate(const T& a, const T& b, double alpha, T* result) {
+  result->set_x(Interpolate(a.x(), b.x(), alpha));
+  result->set_y(Interpolate(a.y(), b.y(), alpha));
+  result->set_z(Interpolate(a.z(), b.z(), alpha));
+}
+
+// Returns the camera at "alpha" between a and b. Discrete properties such as
+// the resolution are taken from a.
+static raytracer::CameraData Interpolate(const raytracer::CameraData& a,
+                                         const raytracer::CameraData& b,
+                                         double alpha) {
+  raytracer::CameraData result(a);
+  Interpolate(a.position(), b.position(), alpha, result.mutable_position());
+  Interpolate(a.view(), b.view(), alpha, result.mutable_view());
+  Interpolate(a.up(), b.up(), alpha, result.mutable_up());
+  result.set_opening_angle(
+      Interpolate(a.opening_angle(), b.opening_angle(), alpha));
+  if (a.has_depth_of_field() || b.has_depth_of_field()) {
+    auto* dof = result.mutable_depth_of_field();
+    dof->set_focal_depth(Interpolate(a.depth_of_field().focal_depth(),
+                                     b.depth_of_field().focal_depth(), alpha));
+    dof->set_lens_size(Interpolate(a.depth_of_field().lens_size(),
+                                   b.depth_of_field().lens_size(), alpha));
+  }
+  return result;
+}
+
+static bool EarlierKeyframe(const raytracer::CameraKeyframeData& a,
+                            const raytracer::CameraKeyframeData& b) {
+  return a.time() < b.time();
+}
+
+// static
+std::vector<raytracer::CameraData> CameraPath::Expand(
+    const raytracer::CameraPathData& path, const raytracer::CameraData& base) {
+  std::vector<raytracer::CameraData> result;
+  for (int i = 0; i < path.cameras_size(); ++i) {
+    result.push_back(base);
+    result.back().MergeFrom(path.cameras(i));
+  }
+
+  if (path.keyframes_size() == 0 || path.frames() == 0) {
+    if (path.keyframes_size() > 0 || path.frames() > 0) {
+      LOG(WARNING) << "Skipping keyframes, need at least one keyframe and "
+                   << "one frame";
+    }
+    return result;
+  }
+
+  std::vector<raytracer::CameraKeyframeData> keyframes(
+      path.keyframes().begin(), path.keyframes().end());
+  std::stable_sort(keyframes.begin(), keyframes.end(), EarlierKeyframe);
+  for (auto it = keyframes.begin(); it != keyframes.end(); ++it) {
+    raytracer::CameraData camera(base);
+    camera.MergeFrom(it->camera());
+    it->mutable_camera()->Swap(&camera);
+  }
+
+  const double start = keyframes.front().time();
+  const double end = keyframes.back().time();
+  size_t segment = 0;
+  for (size_t frame = 0; frame < path.frames(); ++frame) {
+    const double time = path.frames() == 1 ? start :
+        Interpolate(start, end, double(frame) / (path.frames() - 1));
+    while (segment + 2 < keyframes.size() &&
+           keyframes[segment + 1].time() < time) {
+      ++segment;
+    }
+
+    const auto& a = keyframes[segment];
+    const auto& b = keyframes[std::min(segment + 1, keyframes.size() - 1)];
+    const double duration = b.time() - a.time();
+    const double alpha = duration > 0 ? (time - a.time()) / duration : 0;
+    result.push_back(Interpolate(a.camera(), b.camera(),
+                                 std::min(std::max(alpha, 0.0), 1.0)));
+  }
+  return result;
+}
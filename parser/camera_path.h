@@ -0,0 +1,42 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Turns a camera path into the cameras of the individual frames.
+ * Author: Dino Wernli
+ */
+
+#ifndef CAMERA_PATH_H_
+#define CAMERA_PATH_H_
+
+#include <vector>
+
+#include "proto/scene/camera_data.pb.h"
+
+class CameraPath {
+ public:
+  // Returns one camera per frame of path, in the order in which they are to be
+  // rendered. Fields missing from the cameras of the path are taken from base.
+  static std::vector<raytracer::CameraData> Expand(
+      const raytracer::CameraPathData& path, const raytracer::CameraData& base);
+};
+
+#endif  /* CAMERA_PATH_H_ */
@@ -0,0 +1,224 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "mesh_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <glog/logging.h>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scene/mesh.h"
+#include "util/mapped_file.h"
+#include "util/point3.h"
+
+// Identifies cache files. Must change whenever the layout changes.
+static const char kMagic[8] = { 'R', 'T', 'M', 'E', 'S', 'H', '0', '1' };
+
+// The arrays in a cache file start at multiples of this many bytes.
+static const uint64_t kAlignment = 64;
+
+// The start of every cache file. The points, normals and triangles of the
+// mesh follow at the stored offsets.
+struct Header {
+  char magic[8];
+
+  // The sizes of the stored types. Builds with a different precision or SIMD
+  // setting store their data differently and cannot share cache files.
+  uint32_t scalar_size;
+  uint32_t point_size;
+  uint32_t vector_size;
+  uint32_t triangle_size;
+
+  uint32_t transformed;
+  uint32_t unused;
+  double scale;
+  double translation[3];
+
+  uint64_t num_points;
+  uint64_t points_offset;
+  uint64_t num_normals;
+  uint64_t normals_offset;
+  uint64_t num_triangles;
+  uint64_t triangles_offset;
+};
+
+static uint64_t Align(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Fills in the header of a cache file with the passed contents.
+static void InitHeader(uint64_t num_points, uint64_t num_normals,
+                       uint64_t num_triangles,
+                       const MeshCache::Transformation& transformation,
+                       Header* header) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->scalar_size = sizeof(Scalar);
+  header->point_size = sizeof(Point3);
+  header->vector_size = sizeof(Vector3);
+  header->triangle_size = sizeof(Mesh::TriangleDescriptor);
+
+  if (transformation.applied) {
+    header->transformed = 1;
+    header->scale = transformation.scale;
+    header->translation[0] = transformation.translation.x();
+    header->translation[1] = transformation.translation.y();
+    header->translation[2] = transformation.translation.z();
+  }
+
+  header->num_points = num_points;
+  header->points_offset = Align(sizeof(Header));
+  header->num_normals = num_normals;
+  header->normals_offset =
+      Align(header->points_offset + num_points * sizeof(Point3));
+  header->num_triangles = num_triangles;
+  header->triangles_offset =
+      Align(header->normals_offset + num_normals * sizeof(Vector3));
+}
+
+// Returns true if the file at "path" was modified no earlier than the file at
+// "reference".
+static bool IsUpToDate(const std::string& path, const std::string& reference) {
+  struct stat path_stat;
+  struct stat reference_stat;
+  if (stat(path.c_str(), &path_stat) != 0 ||
+      stat(reference.c_str(), &reference_stat) != 0) {
+    return false;
+  }
+  if (path_stat.st_mtim.tv_sec != reference_stat.st_mtim.tv_sec) {
+    return path_stat.st_mtim.tv_sec > reference_stat.st_mtim.tv_sec;
+  }
+  return path_stat.st_mtim.tv_nsec >= reference_stat.st_mtim.tv_nsec;
+}
+
+// Writes zeros until the stream is at "offset".
+static void PadTo(uint64_t offset, std::ofstream* stream) {
+  static const char kZeros[kAlignment] = {};
+  if (!*stream) {
+    return;
+  }
+  const uint64_t position = stream->tellp();
+  stream->write(kZeros, offset - position);
+}
+
+// static
+std::string MeshCache::CachePath(const std::string& source_path) {
+  return source_path + kExtension;
+}
+
+// static
+Mesh* MeshCache::Load(const std::string& path, const std::string& source_path,
+                      const Transformation& transformation) {
+  if (!IsUpToDate(path, source_path)) {
+    return NULL;
+  }
+
+  std::unique_ptr<MappedFile> file(MappedFile::Open(path));
+  if (file.get() == NULL || file->size() < sizeof(Header)) {
+    return NULL;
+  }
+
+  Header header;
+  memcpy(&header, file->data(), sizeof(header));
+  if (header.num_points > file->size() || header.num_normals > file->size() ||
+      header.num_triangles > file->size()) {
+    return NULL;
+  }
+
+  Header expected;
+  InitHeader(header.num_points, header.num_normals, header.num_triangles,
+             transformation, &expected);
+  const uint64_t end = expected.triangles_offset +
+      expected.num_triangles * sizeof(Mesh::TriangleDescriptor);
+  if (memcmp(&header, &expected, sizeof(header)) != 0 || end > file->size()) {
+    return NULL;
+  }
+
+  const char* data = file->data();
+  const Point3* points =
+      reinterpret_cast<const Point3*>(data + header.points_offset);
+  const Vector3* normals =
+      reinterpret_cast<const Vector3*>(data + header.normals_offset);
+  const Mesh::TriangleDescriptor* triangles =
+      reinterpret_cast<const Mesh::TriangleDescriptor*>(
+          data + header.triangles_offset);
+
+  // Triangles are used without further checks, so a corrupt file must not get
+  // past this point.
+  for (uint64_t i = 0; i < header.num_triangles; ++i) {
+    const Mesh::TriangleDescriptor& t = triangles[i];
+    if (t.p1 >= header.num_points || t.p2 >= header.num_points ||
+        t.p3 >= header.num_points || t.n1 >= header.num_normals ||
+        t.n2 >= header.num_normals || t.n3 >= header.num_normals) {
+      LOG(WARNING) << "Ignoring mesh cache with invalid triangle: " << path;
+      return NULL;
+    }
+  }
+
+  return new Mesh(file.release(), points, header.num_points, normals,
+                  header.num_normals, triangles, header.num_triangles);
+}
+
+// static
+bool MeshCache::Store(const Mesh& mesh, const Transformation& transformation,
+                      const std::string& path) {
+  Header header;
+  InitHeader(mesh.num_points(), mesh.num_normals(), mesh.num_triangles(),
+             transformation, &header);
+
+  // Write to a temporary file first so that other processes never see a
+  // partially written cache file. Every process uses its own temporary file
+  // because workers may store the same mesh concurrently.
+  const std::string temporary_path = path + "." + std::to_string(getpid());
+  std::ofstream stream(temporary_path.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  PadTo(header.points_offset, &stream);
+  stream.write(reinterpret_cast<const char*>(mesh.points()),
+               mesh.num_points() * sizeof(Point3));
+  PadTo(header.normals_offset, &stream);
+  stream.write(reinterpret_cast<const char*>(mesh.normals()),
+               mesh.num_normals() * sizeof(Vector3));
+  PadTo(header.triangles_offset, &stream);
+  stream.write(reinterpret_cast<const char*>(mesh.triangles()),
+               mesh.num_triangles() * sizeof(Mesh::TriangleDescriptor));
+  stream.close();
+
+  if (!stream || rename(temporary_path.c_str(), path.c_str()) != 0) {
+    remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// static
+const std::string MeshCache::kExtension = ".rtmesh";
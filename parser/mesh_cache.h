@@ -0,0 +1,70 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Stores meshes in a binary format which can be mapped into memory and used
+ * without any parsing or copying. A cache file contains the points, normals
+ * and 32 bit triangle indices of a mesh after it was transformed and had its
+ * normals inferred.
+ * Author: Dino Wernli
+ */
+
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <string>
+
+#include "util/numeric.h"
+#include "util/vector3.h"
+
+class Mesh;
+
+class MeshCache {
+ public:
+  // The transformation applied to a mesh after parsing it. Cache files are
+  // only reused for the transformation they were created with.
+  struct Transformation {
+    Transformation() : applied(false), scale(1) {}
+    bool applied;
+    Scalar scale;
+    Vector3 translation;
+  };
+
+  // Returns the path of the cache file for the passed OBJ file.
+  static std::string CachePath(const std::string& source_path);
+
+  // Returns a mesh backed by the cache file at "path", or NULL if there is no
+  // usable cache file. A cache file is usable if it is at least as new as the
+  // file at "source_path" and was written by a build with the same memory
+  // layout for the same transformation. The caller takes ownership of the
+  // returned pointer.
+  static Mesh* Load(const std::string& path, const std::string& source_path,
+                    const Transformation& transformation);
+
+  // Writes mesh to a cache file at "path". Returns false on failure.
+  static bool Store(const Mesh& mesh, const Transformation& transformation,
+                    const std::string& path);
+
+  static const std::string kExtension;
+};
+
+#endif  /* MESH_CACHE_H_ */
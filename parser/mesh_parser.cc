@@ -26,63 +26,435 @@
 
 #include "mesh_parser.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <glog/logging.h>
 #include <memory>
-#include <sstream>
+#include <thread>
 
 #include "scene/mesh.h"
+#include "util/mapped_file.h"
+#include "util/trace.h"
 
-// Takes a string of the form "N1//N2" and parses the numbers.
-void ExtractIndex(const std::string& index_str, size_t* n1, size_t* n2) {
-  std::stringstream string_stream(index_str);
-  string_stream >> *n1;
-  string_stream.ignore(2);
-  string_stream >> *n2;
+struct MeshParser::Chunk {
+  // An index into the points or normals of the mesh. Negative indices count
+  // backwards from the most recent element. They are stored relative to the
+  // start of the chunk until the sizes of the preceding chunks are known.
+  struct Index {
+    long long value;
+    bool relative;
+  };
+
+  struct Corner {
+    Index point;
+    Index normal;
+    bool has_normal;
+  };
+
+  std::vector<Point3> points;
+  std::vector<Vector3> normals;
+
+  // Every three consecutive corners form a triangle.
+  std::vector<Corner> corners;
+};
+
+// All powers of ten which are exactly representable as doubles.
+static const double kPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+  1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Mantissas up to this value are exactly representable as doubles.
+static const unsigned long long kMaxExactMantissa = 1ULL << 53;
+
+static inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline const char* SkipSpaces(const char* cursor, const char* end) {
+  while (cursor < end && IsSpace(*cursor)) {
+    ++cursor;
+  }
+  return cursor;
+}
+
+// Returns whether the token [begin, end) is equal to keyword.
+static inline bool Matches(const char* begin, const char* end,
+                           const std::string& keyword) {
+  return size_t(end - begin) == keyword.size() &&
+         memcmp(begin, keyword.data(), keyword.size()) == 0;
+}
+
+// Parses an optionally signed decimal integer at *cursor and advances the
+// cursor past it.
+static bool ParseInteger(const char** cursor, const char* end,
+                         long long* result) {
+  const char* current = *cursor;
+  bool negative = false;
+  if (current < end && (*current == '-' || *current == '+')) {
+    negative = *current == '-';
+    ++current;
+  }
+
+  if (current == end || !IsDigit(*current)) {
+    return false;
+  }
+
+  long long value = 0;
+  while (current < end && IsDigit(*current)) {
+    value = 10 * value + (*current - '0');
+    ++current;
+  }
+
+  *result = negative ? -value : value;
+  *cursor = current;
+  return true;
+}
+
+// Parses a decimal floating point number at *cursor and advances the cursor
+// past it. Numbers whose digits fit into a double and whose decimal exponent
+// is small are converted exactly with a single multiplication or division.
+// All other numbers are converted by strtod.
+static bool ParseScalar(const char** cursor, const char* end, Scalar* result) {
+  const char* start = *cursor;
+  const char* current = start;
+  bool negative = false;
+  if (current < end && (*current == '-' || *current == '+')) {
+    negative = *current == '-';
+    ++current;
+  }
+
+  unsigned long long mantissa = 0;
+  int exponent = 0;
+  bool exact = true;
+  bool has_digits = false;
+  bool in_fraction = false;
+  for (; current < end; ++current) {
+    if (*current == '.' && !in_fraction) {
+      in_fraction = true;
+      continue;
+    }
+    if (!IsDigit(*current)) {
+      break;
+    }
+
+    has_digits = true;
+    const unsigned digit = *current - '0';
+    if (mantissa <= (kMaxExactMantissa - digit) / 10) {
+      mantissa = 10 * mantissa + digit;
+      exponent -= in_fraction ? 1 : 0;
+    } else {
+      exact = false;
+    }
+  }
+
+  if (!has_digits) {
+    return false;
+  }
+
+  if (current < end && (*current == 'e' || *current == 'E')) {
+    ++current;
+    long long explicit_exponent;
+    if (!ParseInteger(&current, end, &explicit_exponent)) {
+      return false;
+    }
+    if (explicit_exponent > 1000 || explicit_exponent < -1000) {
+      exact = false;
+    } else {
+      exponent += explicit_exponent;
+    }
+  }
+
+  if (exact && exponent >= -22 && exponent <= 22) {
+    double value = static_cast<double>(mantissa);
+    if (exponent < 0) {
+      value /= kPowersOfTen[-exponent];
+    } else {
+      value *= kPowersOfTen[exponent];
+    }
+    *result = negative ? -value : value;
+  } else {
+    // Slow path for unusual numbers. Needs a null terminated copy since the
+    // mapped file is not terminated.
+    char buffer[128];
+    const size_t length = current - start;
+    if (length >= sizeof(buffer)) {
+      return false;
+    }
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    *result = strtod(buffer, NULL);
+  }
+
+  *cursor = current;
+  return true;
+}
+
+// Parses three whitespace separated scalars at *cursor.
+static bool ParseTriple(const char** cursor, const char* end, Scalar* x,
+                        Scalar* y, Scalar* z) {
+  Scalar* values[] = { x, y, z };
+  for (size_t i = 0; i < 3; ++i) {
+    *cursor = SkipSpaces(*cursor, end);
+    if (!ParseScalar(cursor, end, values[i])) {
+      return false;
+    }
+    if (*cursor < end && !IsSpace(**cursor)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Turns an index from the file into an index relative to the mesh or, if it
+// is negative, to the current chunk which has seen "count" elements so far.
+static bool MakeIndex(long long raw, size_t count,
+                      long long* value, bool* relative) {
+  if (raw == 0) {
+    return false;
+  }
+  *relative = raw < 0;
+  *value = *relative ? static_cast<long long>(count) + raw : raw - 1;
+  return true;
+}
+
+// Resolves an index given the number of elements in the preceding chunks.
+// Returns false if the resulting index is out of range.
+static bool ResolveIndex(long long value, bool relative, size_t offset,
+                         size_t size, size_t* result) {
+  if (relative) {
+    value += offset;
+  }
+  if (value < 0 || static_cast<unsigned long long>(value) >= size) {
+    return false;
+  }
+  *result = value;
+  return true;
 }
 
-MeshParser::MeshParser() {
+MeshParser::MeshParser(size_t num_threads, size_t min_chunk_size)
+    : num_threads_(num_threads), min_chunk_size_(min_chunk_size) {
+  if (num_threads_ == 0) {
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
 }
 
 MeshParser::~MeshParser() {
 }
 
 Mesh* MeshParser::LoadFile(const std::string& path) {
-  std::unique_ptr<Mesh> mesh(new Mesh());
-  std::ifstream file_stream(path);
+  ScopedSpan span("MeshParser::LoadFile");
+  std::unique_ptr<MappedFile> file(MappedFile::Open(path));
+  if (file.get() == NULL) {
+    return NULL;
+  }
+
+  // Split the file into chunks which start at the beginning of a line.
+  const char* data = file->data();
+  const size_t size = file->size();
+  const size_t num_chunks = std::max<size_t>(1, std::min(num_threads_,
+      size / std::max<size_t>(1, min_chunk_size_)));
+  std::vector<const char*> bounds(num_chunks + 1, data + size);
+  bounds[0] = data;
+  for (size_t i = 1; i < num_chunks; ++i) {
+    const char* bound = std::max(bounds[i - 1], data + i * (size / num_chunks));
+    const char* newline = static_cast<const char*>(
+        memchr(bound, '\n', data + size - bound));
+    bounds[i] = newline == NULL ? data + size : newline + 1;
+  }
 
-  if (!file_stream.is_open()) {
+  std::vector<Chunk> chunks(num_chunks);
+  std::unique_ptr<bool[]> success(new bool[num_chunks]);
+  if (num_chunks == 1) {
+    success[0] = ParseChunk(bounds[0], bounds[1], &chunks[0]);
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_chunks; ++i) {
+      threads.push_back(std::thread([&bounds, &chunks, &success, i]() {
+        success[i] = ParseChunk(bounds[i], bounds[i + 1], &chunks[i]);
+      }));
+    }
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+      it->join();
+    }
+  }
+
+  size_t num_points = 0;
+  size_t num_normals = 0;
+  size_t num_corners = 0;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    if (!success[i]) {
+      return NULL;
+    }
+    num_points += chunks[i].points.size();
+    num_normals += chunks[i].normals.size();
+    num_corners += chunks[i].corners.size();
+  }
+
+  // Meshes store their indices as 32 bit integers. Corners without normals
+  // may add up to one normal per point.
+  if (num_points + num_normals > UINT32_MAX) {
+    LOG(WARNING) << "Too many vertices in: " << path;
     return NULL;
   }
 
-  while (!file_stream.eof()) {
-    std::string type;
-    file_stream >> type;
+  std::unique_ptr<Mesh> mesh(new Mesh());
+  mesh->Reserve(num_points, std::max(num_points, num_normals), num_corners / 3);
+  for (size_t i = 0; i < num_chunks; ++i) {
+    for (auto it = chunks[i].points.begin(); it != chunks[i].points.end();
+         ++it) {
+      mesh->AddPoint(*it);
+    }
+    for (auto it = chunks[i].normals.begin(); it != chunks[i].normals.end();
+         ++it) {
+      mesh->AddNormal(*it);
+    }
+  }
 
-    if (type == kComment) {
-      continue;
-    } else if (type == kNormal) {
-      Scalar x, y, z;
-      file_stream >> x >> y >> z;
-      mesh->AddNormal(Vector3(x, y, z));
-    } else if (type == kVertex) {
-      Scalar x, y, z;
-      file_stream >> x >> y >> z;
-      mesh->AddPoint(Point3(x, y, z));
-    } else if (type == kTriangle) {
-      size_t v1, v2, v3, n1, n2, n3;
-      std::string index1_str, index2_str, index3_str;
-      file_stream >> index1_str >> index2_str >> index3_str;
-
-      ExtractIndex(index1_str, &v1, &n1);
-      ExtractIndex(index2_str, &v2, &n2);
-      ExtractIndex(index3_str, &v3, &n3);
-
-      mesh->AddTriangle(v1-1, n1-1, v2-1, n2-1, v3-1, n3-1);
+  // Corners without a normal get a normal of their own for each point, which
+  // is shared by all such corners of the point. Their normals are inferred
+  // later, so they must not alias normals of the file.
+  std::vector<uint32_t> point_normals;
+  size_t num_point_normals = 0;
+  size_t point_offset = 0;
+  size_t normal_offset = 0;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    const std::vector<Chunk::Corner>& corners = chunks[i].corners;
+    for (size_t c = 0; c < corners.size(); c += 3) {
+      size_t p[3];
+      size_t n[3];
+      for (size_t j = 0; j < 3; ++j) {
+        const Chunk::Corner& corner = corners[c + j];
+        if (!ResolveIndex(corner.point.value, corner.point.relative,
+                          point_offset, num_points, &p[j])) {
+          LOG(WARNING) << "Vertex index out of range in: " << path;
+          return NULL;
+        }
+        if (!corner.has_normal) {
+          if (point_normals.empty()) {
+            point_normals.assign(num_points, UINT32_MAX);
+          }
+          if (point_normals[p[j]] == UINT32_MAX) {
+            point_normals[p[j]] = num_normals + num_point_normals++;
+          }
+          n[j] = point_normals[p[j]];
+        } else if (!ResolveIndex(corner.normal.value, corner.normal.relative,
+                                 normal_offset, num_normals, &n[j])) {
+          LOG(WARNING) << "Normal index out of range in: " << path;
+          return NULL;
+        }
+      }
+      mesh->AddTriangle(p[0], n[0], p[1], n[1], p[2], n[2]);
     }
+    point_offset += chunks[i].points.size();
+    normal_offset += chunks[i].normals.size();
   }
+
+  for (size_t i = 0; i < num_point_normals; ++i) {
+    mesh->AddNormal(Vector3());
+  }
+
   return mesh.release();
 }
 
+// static
+bool MeshParser::ParseChunk(const char* begin, const char* end, Chunk* chunk) {
+  const char* line = begin;
+  while (line < end) {
+    const char* line_end = static_cast<const char*>(
+        memchr(line, '\n', end - line));
+    if (line_end == NULL) {
+      line_end = end;
+    }
+    if (!ParseLine(line, line_end, chunk)) {
+      LOG(WARNING) << "Malformed mesh line: " << std::string(line, line_end);
+      return false;
+    }
+    line = line_end + 1;
+  }
+  return true;
+}
+
+// static
+bool MeshParser::ParseLine(const char* begin, const char* end, Chunk* chunk) {
+  const char* cursor = SkipSpaces(begin, end);
+  const char* keyword = cursor;
+  while (cursor < end && !IsSpace(*cursor)) {
+    ++cursor;
+  }
+
+  if (keyword == cursor || *keyword == kComment[0]) {
+    return true;
+  } else if (Matches(keyword, cursor, kVertex)) {
+    Scalar x, y, z;
+    if (!ParseTriple(&cursor, end, &x, &y, &z)) {
+      return false;
+    }
+    chunk->points.push_back(Point3(x, y, z));
+  } else if (Matches(keyword, cursor, kNormal)) {
+    Scalar x, y, z;
+    if (!ParseTriple(&cursor, end, &x, &y, &z)) {
+      return false;
+    }
+    chunk->normals.push_back(Vector3(x, y, z));
+  } else if (Matches(keyword, cursor, kTriangle)) {
+    // Faces with more than three corners are split into a triangle fan.
+    const size_t first = chunk->corners.size();
+    size_t num_corners = 0;
+    while ((cursor = SkipSpaces(cursor, end)) < end) {
+      Chunk::Corner corner;
+      long long raw;
+      if (!ParseInteger(&cursor, end, &raw) ||
+          !MakeIndex(raw, chunk->points.size(), &corner.point.value,
+                     &corner.point.relative)) {
+        return false;
+      }
+
+      corner.has_normal = false;
+      if (cursor < end && *cursor == '/') {
+        ++cursor;
+        // Texture coordinates are not supported by meshes, skip them.
+        const bool has_texture = cursor < end && *cursor != '/';
+        if (has_texture && !ParseInteger(&cursor, end, &raw)) {
+          return false;
+        }
+        if (cursor < end && *cursor == '/') {
+          ++cursor;
+          if (!ParseInteger(&cursor, end, &raw) ||
+              !MakeIndex(raw, chunk->normals.size(), &corner.normal.value,
+                         &corner.normal.relative)) {
+            return false;
+          }
+          corner.has_normal = true;
+        }
+      }
+
+      if (cursor < end && !IsSpace(*cursor)) {
+        return false;
+      }
+
+      if (num_corners >= 3) {
+        const Chunk::Corner first_corner = chunk->corners[first];
+        const Chunk::Corner previous_corner = chunk->corners.back();
+        chunk->corners.push_back(first_corner);
+        chunk->corners.push_back(previous_corner);
+      }
+      ++num_corners;
+      chunk->corners.push_back(corner);
+    }
+    if (num_corners < 3) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // static
 const std::string MeshParser::kComment = "#";
 
@@ -94,3 +466,6 @@ const std::string MeshParser::kVertex = "v";
 
 // static
 const std::string MeshParser::kTriangle = "f";
+
+// static
+const size_t MeshParser::kMinChunkSize = 1 << 20;
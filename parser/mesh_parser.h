@@ -21,6 +21,8 @@
 // SOFTWARE.
 
 /*
+ * Loads triangle meshes from Wavefront OBJ files. The file is memory mapped and
+ * split into line-aligned chunks which are parsed in parallel.
  * Author: Dino Wernli
  */
 
@@ -38,19 +40,42 @@ class Mesh;
 
 class MeshParser {
  public:
-  MeshParser();
+  // Parses files using "num_threads" threads, or one thread per core if 0.
+  // Each thread is given at least "min_chunk_size" bytes of the file.
+  MeshParser(size_t num_threads = 0, size_t min_chunk_size = kMinChunkSize);
   virtual ~MeshParser();
   NO_COPY_ASSIGN(MeshParser);
 
   // Parses the file and returns a new mesh with the contents, or NULL if the
   // mesh could not be loaded. The caller takes ownership of the returned
   // pointer.
+  //
+  // Supports vertices, normals and faces with any number of corners in the
+  // forms "v", "v/t", "v//n" and "v/t/n". Negative indices refer to elements
+  // relative to the end of the list defined so far. Texture coordinates are
+  // skipped. If a face omits its normals, the normal indices are set to the
+  // vertex indices so that they can be computed using Mesh::InferNormals().
   Mesh* LoadFile(const std::string& path);
 
   static const std::string kComment;
   static const std::string kNormal;
   static const std::string kVertex;
   static const std::string kTriangle;
+
+  static const size_t kMinChunkSize;
+
+ private:
+  struct Chunk;
+
+  // Parses all lines in [begin, end) into chunk. Returns false if any line is
+  // malformed.
+  static bool ParseChunk(const char* begin, const char* end, Chunk* chunk);
+
+  // Parses a single line without its terminating newline.
+  static bool ParseLine(const char* begin, const char* end, Chunk* chunk);
+
+  size_t num_threads_;
+  size_t min_chunk_size_;
 };
 
 #endif  /* MESH_PARSER_H_ */
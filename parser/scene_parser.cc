@@ -26,8 +26,12 @@
 
 #include "scene_parser.h"
 
+#include <fstream>
 #include <glog/logging.h>
+#include <google/protobuf/text_format.h>
+#include <streambuf>
 
+#include "parser/mesh_cache.h"
 #include "parser/mesh_parser.h"
 #include "proto/scene/scene_data.pb.h"
 #include "proto/util/color_data.pb.h"
@@ -44,8 +48,10 @@
 #include "scene/scene.h"
 #include "scene/texture/checkerboard.h"
 #include "scene/texture/constant_texture.h"
+#include "util/trace.h"
 
-SceneParser::SceneParser() {
+SceneParser::SceneParser(bool use_mesh_cache)
+    : use_mesh_cache_(use_mesh_cache) {
 }
 
 SceneParser::~SceneParser() {
@@ -66,6 +72,20 @@ Point3 SceneParser::Parse(const raytracer::PointData& data) {
   return Point3(data.x(), data.y(), data.z());
 }
 
+// static
+Camera* SceneParser::Parse(const raytracer::CameraData& data) {
+  if (!(data.has_position() && data.has_view() && data.has_up()
+      && data.has_opening_angle() && data.resolution_x()
+      && data.resolution_y())) {
+    return NULL;
+  }
+  auto& dof = data.depth_of_field();
+  return new Camera(Parse(data.position()), Parse(data.view()),
+                    Parse(data.up()), data.opening_angle(),
+                    data.resolution_x(), data.resolution_y(),
+                    dof.focal_depth(), dof.lens_size());
+}
+
 // static
 Texture* SceneParser::Parse(const raytracer::TextureData& data) {
   if (data.has_color()) {
@@ -83,6 +103,19 @@ Texture* SceneParser::Parse(const raytracer::TextureData& data) {
   }
 }
 
+// static
+bool SceneParser::LoadTextProto(const std::string& path,
+                                google::protobuf::Message* message) {
+  ScopedSpan span("SceneParser::LoadTextProto");
+  std::ifstream stream(path);
+  if (!stream.is_open()) {
+    return false;
+  }
+  std::string content((std::istreambuf_iterator<char>(stream)),
+                      std::istreambuf_iterator<char>());
+  return google::protobuf::TextFormat::ParseFromString(content, message);
+}
+
 Material* SceneParser::Parse(const raytracer::MaterialData& data) {
   if (!(data.has_emission_texture() && data.has_ambient_texture()
       && data.has_diffuse_texture() && data.has_specular_texture())) {
@@ -104,6 +137,7 @@ Material* SceneParser::Parse(const raytracer::MaterialData& data) {
 }
 
 void SceneParser::ParseScene(const raytracer::SceneData& data, Scene* scene) {
+  ScopedSpan span("SceneParser::ParseScene");
   material_map_.clear();
   texture_map_.clear();
 
@@ -146,21 +180,12 @@ void SceneParser::ParseScene(const raytracer::SceneData& data, Scene* scene) {
   }
 
   if (data.has_camera()) {
-    const auto& camera = data.camera();
-    if (!(camera.has_position() && camera.has_view() && camera.has_up()
-        && camera.has_opening_angle() && camera.resolution_x()
-        && camera.resolution_y())) {
+    Camera* camera = Parse(data.camera());
+    if (camera == NULL) {
       LOG(WARNING) << "Skipping incomplete camera";
     } else {
-      auto& dof = data.camera().depth_of_field();
-      Camera* camera = new Camera(Parse(data.camera().position()),
-                                  Parse(data.camera().view()),
-                                  Parse(data.camera().up()),
-                                  data.camera().opening_angle(),
-                                  data.camera().resolution_x(),
-                                  data.camera().resolution_y(),
-                                  dof.focal_depth(), dof.lens_size());
       scene->set_camera(camera);
+      auto& dof = data.camera().depth_of_field();
       if (camera->DepthOfField() && dof.has_visualization_color()) {
         Color3 v_color = Parse(dof.visualization_color());
         Material* material = Material::VisualizationMaterial(v_color);
@@ -186,8 +211,13 @@ void SceneParser::ParseScene(const raytracer::SceneData& data, Scene* scene) {
       LOG(WARNING) << "Skipping incomplete sphere light";
       continue;
     }
+    size_t shadow_samples = l.shadow_samples();
+    if (shadow_samples == 0) {
+      LOG(WARNING) << "Sphere light needs at least one shadow sample, using 1";
+      shadow_samples = 1;
+    }
     scene->AddLight(new SphereLight(Parse(l.center()), l.radius(),
-                                    Parse(l.color())));
+                                    Parse(l.color()), shadow_samples));
   }
 
   // Parse triangles if any.
@@ -277,28 +307,48 @@ void SceneParser::ParseScene(const raytracer::SceneData& data, Scene* scene) {
   for (int i = 0; i < data.meshes_size(); ++i) {
     const auto& mesh_data = data.meshes(i);
     if (mesh_data.has_obj_file()) {
+      if (!(material = GetMaterial(mesh_data.material_id()))) {
+        LOG(WARNING) << "Failed to get main material, skipping mesh";
+        continue;
+      }
+
+      MeshCache::Transformation transformation;
+      if (mesh_data.has_translation() || mesh_data.has_radius()) {
+        transformation.applied = true;
+        transformation.scale = mesh_data.has_radius() ? mesh_data.radius() : 1;
+        if (mesh_data.has_translation()) {
+          transformation.translation = Parse(mesh_data.translation());
+        }
+      }
+
       const std::string& path = mesh_data.obj_file();
-      Mesh* mesh = parser.LoadFile(path);
-      if (mesh != NULL) {
-        if (!(material = GetMaterial(mesh_data.material_id()))) {
-          LOG(WARNING) << "Failed to get main material, skipping mesh";
-          continue;
+      const std::string cache_path = MeshCache::CachePath(path);
+      Mesh* mesh = NULL;
+      if (use_mesh_cache_) {
+        mesh = MeshCache::Load(cache_path, path, transformation);
+        if (mesh != NULL) {
+          LOG(INFO) << "Loaded cached mesh from: " << cache_path;
         }
+      }
 
-        mesh->set_material(material);
-        if (mesh_data.has_translation() || mesh_data.has_radius()) {
-          Vector3 translation;
-          if (mesh_data.has_translation()) {
-            translation = Parse(mesh_data.translation());
-          }
-          mesh->Transform(mesh_data.has_radius() ? mesh_data.radius() : 1,
-                          translation);
+      if (mesh == NULL) {
+        mesh = parser.LoadFile(path);
+        if (mesh == NULL) {
+          LOG(WARNING) << "Unable to load mesh from: " << path;
+          continue;
+        }
+        if (transformation.applied) {
+          mesh->Transform(transformation.scale, transformation.translation);
         }
         mesh->InferNormals();
-        scene->AddMesh(mesh);
-      } else {
-        LOG(WARNING) << "Unable to load mesh from: " << path;
+        if (use_mesh_cache_ &&
+            !MeshCache::Store(*mesh, transformation, cache_path)) {
+          LOG(WARNING) << "Unable to write mesh cache: " << cache_path;
+        }
       }
+
+      mesh->set_material(material);
+      scene->AddMesh(mesh);
     } else {
       LOG(WARNING) << "Skipping incomplete mesh";
     }
@@ -37,19 +37,29 @@
 #include "util/point3.h"
 #include "util/vector3.h"
 
+namespace google {
+namespace protobuf {
+class Message;
+}
+}
+
 namespace raytracer {
+class CameraData;
 class MaterialData;
 class SceneData;
 class TextureData;
 }
 
+class Camera;
 class Material;
 class Scene;
 class Texture;
 
 class SceneParser {
  public:
-  SceneParser();
+  // If "use_mesh_cache" is true, meshes are loaded from binary cache files
+  // next to their OBJ files, which are created if missing or outdated.
+  explicit SceneParser(bool use_mesh_cache = false);
   virtual ~SceneParser();
   NO_COPY_ASSIGN(SceneParser);
 
@@ -61,9 +71,15 @@ class SceneParser {
   static Color3 Parse(const raytracer::ColorData& data);
   static Vector3 Parse(const raytracer::VectorData& data);
   static Point3 Parse(const raytracer::PointData& data);
+  static Camera* Parse(const raytracer::CameraData& data);
 
   Material* Parse(const raytracer::MaterialData& data);
 
+  // Reads the text format proto stored at path, such as scene data, into
+  // message. Returns false if the file could not be read or parsed.
+  static bool LoadTextProto(const std::string& path,
+                            google::protobuf::Message* message);
+
   // Parses data and add everything to scene.
   void ParseScene(const raytracer::SceneData& data, Scene* scene);
 
@@ -74,6 +90,8 @@ class SceneParser {
   // Maps material identifiers to materials.
   std::map<std::string, Material*> material_map_;
   std::map<std::string, Texture*> texture_map_;
+
+  bool use_mesh_cache_;
 };
 
 #endif  /* SCENE_PARSER_H_ */
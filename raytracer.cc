@@ -25,26 +25,37 @@
  * Autor: Dino Wernli
  */
 
-#include <fstream>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/stubs/common.h>
-#include <google/protobuf/text_format.h>
 #include <memory>
 #include <sstream>
-#include <streambuf>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "listener/bmp_exporter.h"
+#include "listener/exr_exporter.h"
+#include "listener/frame_exporter.h"
+#include "listener/png_exporter.h"
 #include "listener/ppm_exporter.h"
 #include "listener/progress_listener.h"
 #include "listener/raytracer_window.h"
+#include "listener/shared_framebuffer.h"
+#include "listener/streaming_exporter.h"
+#include "parser/camera_path.h"
+#include "parser/scene_parser.h"
 #include "proto/config/renderer_config.pb.h"
 #include "proto/config/scene_config.pb.h"
+#include "proto/scene/camera_data.pb.h"
+#include "proto/server/render_job.pb.h"
 #include "proto/scene/scene_data.pb.h"
 #include "renderer/renderer.h"
+#include "scene/camera.h"
 #include "scene/scene.h"
+#include "server/render_server.h"
+#include "server/tile_coordinator.h"
+#include "util/trace.h"
 
 using raytracer::RendererConfig;
 using raytracer::SceneConfig;
@@ -53,6 +64,9 @@ using std::string;
 // Renderer config flags.
 DEFINE_bool(shadows, true, "Whether or not shadows are rendered");
 
+DEFINE_uint64(light_samples, 0, "The number of lights sampled per shading "
+                                "point. If 0, all lights are evaluated");
+
 DEFINE_uint64(recursion_depth, 10, "How deep to evaluate reflective and "
                                    "refractive rays");
 
@@ -61,6 +75,12 @@ DEFINE_int32(root_rays_per_pixel, 1, "The side length of the supersampling "
 
 DEFINE_bool(use_kd_tree, true, "Whether or not to use a KdTree in the scene");
 
+DEFINE_bool(mesh_cache, true, "Whether or not to store parsed meshes in binary "
+                              "files next to their OBJ files for reuse");
+
+DEFINE_string(kd_tree_cache_dir, "", "If not empty, built KdTrees are stored "
+              "in this directory and reused by later runs on the same scene");
+
 DEFINE_int32(kd_tree_visualization_depth, -1, "How deep in the tree to "
                                               "visualize splitting planes");
 
@@ -83,6 +103,31 @@ DEFINE_double(adaptive_supersampling_threshold, -1, "A threshold for the "
 
 DEFINE_string(sampling_heatmap, "", "Path to store sampling heatmap image");
 
+DEFINE_string(kd_tree_heatmap, "", "Path to store a heatmap of the KdTree "
+                                   "nodes visited per pixel");
+
+DEFINE_string(element_tests_heatmap, "", "Path to store a heatmap of the "
+                                         "element intersection tests per "
+                                         "pixel");
+
+DEFINE_string(time_heatmap, "", "Path to store a heatmap of the wall-clock "
+                                "time spent per pixel");
+
+DEFINE_bool(heatmap_log_scale, false, "Whether heatmaps use a logarithmic "
+                                      "instead of a linear scale");
+
+DEFINE_bool(perf_counters, false, "Whether to log hardware performance "
+                                  "counters of each worker after rendering, "
+                                  "such as IPC and cache misses per ray");
+
+DEFINE_string(statistics_json, "", "If not empty, counts of the traced rays, "
+              "KdTree nodes visited and element tests are written to this "
+              "path as JSON");
+
+DEFINE_string(memory_report_json, "", "If not empty, the bytes used by the "
+              "scene, its KdTree and the sampler are written to this path as "
+              "JSON");
+
 // Camera config flags.
 DEFINE_int32(image_resolution_x, -1, "Optional override for the horizontal "
                                       "resolution of the image");
@@ -104,16 +149,82 @@ DEFINE_string(bmp_file, "", "If <file> is passed, a BMP image will be saved at "
 DEFINE_string(ppm_file, "", "If <file> is passed, a PPM image will be saved at "
                             "'output/<file>.ppm'");
 
+DEFINE_string(png_file, "", "If <file> is passed, a PNG image will be saved at "
+                            "'output/<file>.png'");
+
+DEFINE_string(exr_file, "", "If <file> is passed, an OpenEXR image with the "
+                            "unclamped colors will be saved at "
+                            "'output/<file>.exr'");
+
+DEFINE_string(shm_framebuffer, "", "If not empty, the image being rendered is "
+              "published in the POSIX shared memory segment with this name, "
+              "e.g., '/raytracer'");
+
+DEFINE_uint64(band_height, 0, "If positive, the image is written to disk in "
+              "bands of this many rows as soon as they are rendered, without "
+              "holding the full image in memory. Implies the scanline "
+              "sampler.");
+
+DEFINE_double(exposure, 1, "All intensities of the image are multiplied by "
+              "this before exporting");
+
+DEFINE_bool(tone_mapping, false, "Whether or not to compress the intensities "
+            "into the displayable range before exporting");
+
+DEFINE_double(gamma, 1, "The gamma used to encode the intensities of the "
+              "exported image");
+
+DEFINE_string(trace_file, "", "If not empty, a Chrome trace of the rendering "
+              "phases is written to this file at exit. It can be viewed in "
+              "chrome://tracing or Perfetto");
+
 DEFINE_string(scene_data, "data/scene/quadrics_tori.sd",
                           "A file from which to parse the items in the scene");
 
 DEFINE_bool(gui, false, "Whether or not to start the GLUT front end");
 
+DEFINE_string(camera_path, "", "If not empty, renders one frame for each camera"
+                               " of the text format CameraPathData in this "
+                               "file, reusing the scene for all frames. Frame "
+                               "<i> is saved at 'output/<file>_<i>.bmp'");
+
+// Server flags.
+DEFINE_bool(server, false, "If true, reads render jobs from stdin and writes "
+                           "the results to stdout instead of rendering a "
+                           "single scene");
+
+DEFINE_string(server_socket, "", "If not empty, serves render jobs on a Unix "
+                                 "domain socket at this path");
+
+DEFINE_int32(server_port, 0, "If positive, serves render jobs over TCP on this "
+                             "port. Only use on trusted networks");
+
+DEFINE_string(server_bind_address, "127.0.0.1", "The IPv4 address on which "
+                                                "--server_port listens. Pass "
+                                                "0.0.0.0 to accept jobs from "
+                                                "other hosts");
+
+DEFINE_string(server_scene_dir, "data/scene", "The directory from which jobs "
+                                              "received over TCP may load "
+                                              "scenes");
+
+DEFINE_uint64(server_cache_size, 4, "The number of scenes a render server "
+                                    "keeps in memory between jobs");
+
+// Distributed rendering flags.
+DEFINE_string(workers, "", "Comma separated render servers, given as Unix "
+                           "socket paths or <host>:<port>, to which the tiles "
+                           "of the image are distributed");
+
+DEFINE_uint64(spawn_workers, 0, "The number of local worker processes to "
+                                "which the tiles of the image are distributed");
+
+DEFINE_uint64(tile_size, 64, "The side length of the tiles handed to workers");
+
 /* General Todos:
 TODO(dinow): Don't manage free listeneres in renderer.
 TODO(dinow): Make materials optional (or add primitive and shape abstraction).
 TODO(dinow): Make scene initialization etc use the listener mechanism.
-TODO(dinow): Clamp image colors before exporting them.
 
 TODO(dinow): Implement surface area heuristics for KdTree splitting
 TODO(dinow): Add textures, perlin noise, bump maps, skyboxes, path tracing
@@ -121,7 +232,6 @@ TODO(dinow): Add possibility to load renderer config from file.
 TODO(dinow): Rename proto namespace to "config" or "proto".
 TODO(dinow): Put everything else in namespace "raytracer".
 TODO(dinow): Implement a webserver.
-TODO(dinow): Implement statistics (intersection counting).
 TODO(dinow): Remove the default values from the object constructors.
              Leave them only in the protos. Or leave them in both but always
              pass the arguments.
@@ -134,14 +244,96 @@ string DefaultFilename() {
   return stream.str();
 }
 
-bool LoadSceneData(const string& path, raytracer::SceneData* output) {
-  std::ifstream stream(path);
-  if (!stream.is_open()) {
+// Renders the scene once with each of the cameras. The scene is initialized
+// only once and reused for all frames.
+void RenderFrames(Renderer* renderer, Scene* scene,
+                  std::vector<std::unique_ptr<Camera>>* cameras) {
+  for (size_t i = 0; i < cameras->size(); ++i) {
+    LOG(INFO) << "Rendering frame " << i + 1 << " of " << cameras->size();
+    scene->set_camera((*cameras)[i].release());
+    renderer->Render(scene);
+  }
+}
+
+// Applies the camera flags to camera.
+void ApplyCameraFlags(raytracer::CameraData* camera) {
+  if (FLAGS_image_resolution_x > 0) {
+    camera->set_resolution_x(FLAGS_image_resolution_x);
+  }
+  if (FLAGS_image_resolution_y > 0) {
+    camera->set_resolution_y(FLAGS_image_resolution_y);
+  }
+
+  if (FLAGS_dof_lens_size >= 0 && FLAGS_dof_focal_depth >= 0) {
+    auto* dof = camera->mutable_depth_of_field();
+    dof->set_lens_size(FLAGS_dof_lens_size);
+    dof->set_focal_depth(FLAGS_dof_focal_depth);
+  }
+}
+
+// Renders the scene by distributing its tiles to workers. Spawned workers run
+// this binary as a render server with the passed command line arguments.
+bool RenderOnWorkers(const std::vector<string>& arguments,
+                     const RendererConfig& renderer_config) {
+  TileCoordinator coordinator(FLAGS_tile_size);
+
+  std::vector<string> worker_arguments(arguments.begin() + 1, arguments.end());
+  worker_arguments.push_back("--server");
+  worker_arguments.push_back("--server_socket=");
+  worker_arguments.push_back("--server_port=0");
+  worker_arguments.push_back("--spawn_workers=0");
+  worker_arguments.push_back("--workers=");
+  worker_arguments.push_back("--trace_file=");
+  for (size_t i = 0; i < FLAGS_spawn_workers; ++i) {
+    coordinator.SpawnWorker("/proc/self/exe", worker_arguments);
+  }
+
+  std::stringstream addresses(FLAGS_workers);
+  string address;
+  while (std::getline(addresses, address, ',')) {
+    if (!address.empty()) {
+      coordinator.ConnectWorker(address);
+    }
+  }
+
+  if (coordinator.num_workers() == 0) {
+    LOG(ERROR) << "No workers available for distributed rendering";
     return false;
   }
-  string string((std::istreambuf_iterator<char>(stream)),
-                      std::istreambuf_iterator<char>());
-  return google::protobuf::TextFormat::ParseFromString(string, output);
+
+  raytracer::RenderJob job;
+  job.set_scene_id(FLAGS_scene_data);
+  ApplyCameraFlags(job.mutable_camera());
+  job.mutable_renderer_config()->CopyFrom(renderer_config);
+
+  // Every worker uses its own number of threads, and heatmaps or statistics
+  // of a single tile are of no use.
+  job.mutable_renderer_config()->clear_threads();
+  job.mutable_renderer_config()->clear_sampling_heatmap_path();
+  job.mutable_renderer_config()->clear_statistics_path();
+  job.mutable_renderer_config()->clear_memory_report_path();
+  job.mutable_renderer_config()->clear_kd_tree_heatmap_path();
+  job.mutable_renderer_config()->clear_element_tests_heatmap_path();
+  job.mutable_renderer_config()->clear_time_heatmap_path();
+
+  coordinator.AddListener(new ProgressListener());
+  if (!FLAGS_shm_framebuffer.empty()) {
+    coordinator.AddListener(new SharedFramebuffer(FLAGS_shm_framebuffer));
+  }
+  const string dir = "output/";
+  const string name = FLAGS_bmp_file.empty() ? DefaultFilename()
+                                             : FLAGS_bmp_file;
+  coordinator.AddListener(new BmpExporter(dir + name + ".bmp"));
+  if (!FLAGS_ppm_file.empty()) {
+    coordinator.AddListener(new PpmExporter(dir + FLAGS_ppm_file + ".ppm"));
+  }
+  if (!FLAGS_png_file.empty()) {
+    coordinator.AddListener(new PngExporter(dir + FLAGS_png_file + ".png"));
+  }
+  if (!FLAGS_exr_file.empty()) {
+    coordinator.AddListener(new ExrExporter(dir + FLAGS_exr_file + ".exr"));
+  }
+  return coordinator.Render(job);
 }
 
 int main(int argc, char **argv) {
@@ -151,31 +343,20 @@ int main(int argc, char **argv) {
   // Run <binary name> --logtostderr to see log output.
   // Run <binary name> --logtostderr --v=<i> for DVLOG(j) message for j <= i.
   google::InitGoogleLogging(argv[0]);
+  const std::vector<string> arguments(argv, argv + argc);
   google::ParseCommandLineFlags(&argc, &argv, true);
 
+  if (!FLAGS_trace_file.empty()) {
+    Trace::WriteFileAtExit(FLAGS_trace_file);
+    Trace::SetThreadName("Main");
+  }
+
   // Load the configuration from the passed arguments.
   SceneConfig scene_config;
+  scene_config.set_use_mesh_cache(FLAGS_mesh_cache);
   if (FLAGS_use_kd_tree) {
     scene_config.mutable_kd_tree_config();
   }
-  if (FLAGS_scene_data.empty()) {
-    LOG(ERROR) << "Failed to load scene data, no file provided";
-    return EXIT_FAILURE;
-  }
-  if (LoadSceneData(FLAGS_scene_data, scene_config.mutable_scene_data())) {
-    LOG(INFO) << "Loaded scene data from: " << FLAGS_scene_data;
-  } else {
-    LOG(ERROR) << "Failed to load scene data from: " << FLAGS_scene_data;
-    return EXIT_FAILURE;
-  }
-
-  auto& camera_config = *(scene_config.mutable_scene_data()->mutable_camera());
-  if (FLAGS_image_resolution_x > 0) {
-    camera_config.set_resolution_x(FLAGS_image_resolution_x);
-  }
-  if (FLAGS_image_resolution_y > 0) {
-    camera_config.set_resolution_y(FLAGS_image_resolution_y);
-  }
 
   if (!FLAGS_splitting_strategy.empty()) {
     if (FLAGS_splitting_strategy == "midpoint") {
@@ -191,14 +372,9 @@ int main(int argc, char **argv) {
   raytracer::ColorData vis_color;
   vis_color.set_r(0.6); vis_color.set_g(0.25); vis_color.set_b(0.1);
 
-  if (FLAGS_dof_lens_size >= 0 && FLAGS_dof_focal_depth >= 0) {
-    auto* camera = scene_config.mutable_scene_data()->mutable_camera();
-    auto* dof = camera->mutable_depth_of_field();
-    dof->set_lens_size(FLAGS_dof_lens_size);
-    dof->set_focal_depth(FLAGS_dof_focal_depth);
-    if(FLAGS_dof_visualization) {
-      dof->mutable_visualization_color()->CopyFrom(vis_color);
-    }
+  if (FLAGS_use_kd_tree && !FLAGS_kd_tree_cache_dir.empty()) {
+    scene_config.mutable_kd_tree_config()->set_cache_directory(
+        FLAGS_kd_tree_cache_dir);
   }
 
   if (FLAGS_use_kd_tree && FLAGS_kd_tree_visualization_depth >= 0) {
@@ -207,21 +383,40 @@ int main(int argc, char **argv) {
     kd_config->mutable_visualization_color()->CopyFrom(vis_color);
   }
 
-  // Build the scene from the config.
-  std::unique_ptr<Scene> scene(Scene::FromConfig(scene_config));
-
   // Load renderer config from flags.
   RendererConfig renderer_config;
   renderer_config.set_threads(FLAGS_worker_threads);
   renderer_config.set_shadows(FLAGS_shadows);
+  renderer_config.set_light_samples(FLAGS_light_samples);
   renderer_config.set_recursion_depth(FLAGS_recursion_depth);
   renderer_config.set_root_rays_per_pixel(FLAGS_root_rays_per_pixel);
   renderer_config.set_adaptive_supersampling_threshold(
       FLAGS_adaptive_supersampling_threshold);
+  renderer_config.set_exposure(FLAGS_exposure);
+  renderer_config.set_tone_mapping(FLAGS_tone_mapping);
+  renderer_config.set_gamma(FLAGS_gamma);
 
   if(!FLAGS_sampling_heatmap.empty()) {
     renderer_config.set_sampling_heatmap_path(FLAGS_sampling_heatmap);
   }
+  if (!FLAGS_statistics_json.empty()) {
+    renderer_config.set_statistics_path(FLAGS_statistics_json);
+  }
+  if (!FLAGS_memory_report_json.empty()) {
+    renderer_config.set_memory_report_path(FLAGS_memory_report_json);
+  }
+  if (!FLAGS_kd_tree_heatmap.empty()) {
+    renderer_config.set_kd_tree_heatmap_path(FLAGS_kd_tree_heatmap);
+  }
+  if (!FLAGS_element_tests_heatmap.empty()) {
+    renderer_config.set_element_tests_heatmap_path(
+        FLAGS_element_tests_heatmap);
+  }
+  if (!FLAGS_time_heatmap.empty()) {
+    renderer_config.set_time_heatmap_path(FLAGS_time_heatmap);
+  }
+  renderer_config.set_heatmap_log_scale(FLAGS_heatmap_log_scale);
+  renderer_config.set_perf_counters(FLAGS_perf_counters);
 
   if (!FLAGS_sampler_type.empty()) {
     if (FLAGS_sampler_type == "progressive") {
@@ -233,21 +428,135 @@ int main(int argc, char **argv) {
     }
   }
 
+  // In server mode, the scenes and cameras are provided by the render jobs.
+  if (FLAGS_server || !FLAGS_server_socket.empty() || FLAGS_server_port > 0) {
+    RenderServer server(scene_config, renderer_config, FLAGS_server_cache_size);
+    server.set_scene_dir(FLAGS_server_scene_dir);
+    bool success;
+    if (!FLAGS_server_socket.empty()) {
+      success = server.ServeSocket(FLAGS_server_socket);
+    } else if (FLAGS_server_port > 0) {
+      success = server.ServePort(FLAGS_server_bind_address, FLAGS_server_port);
+    } else {
+      success = server.Serve(stdin, stdout);
+    }
+    google::protobuf::ShutdownProtobufLibrary();
+    google::ShutdownGoogleLogging();
+    google::ShutDownCommandLineFlags();
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // In coordinator mode, the tiles of the image are rendered by workers.
+  if (!FLAGS_workers.empty() || FLAGS_spawn_workers > 0) {
+    if (!FLAGS_camera_path.empty()) {
+      LOG(WARNING) << "Ignoring camera path for distributed rendering";
+    }
+    const bool success = RenderOnWorkers(arguments, renderer_config);
+    google::protobuf::ShutdownProtobufLibrary();
+    google::ShutdownGoogleLogging();
+    google::ShutDownCommandLineFlags();
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (FLAGS_scene_data.empty()) {
+    LOG(ERROR) << "Failed to load scene data, no file provided";
+    return EXIT_FAILURE;
+  }
+  if (SceneParser::LoadTextProto(FLAGS_scene_data,
+                                 scene_config.mutable_scene_data())) {
+    LOG(INFO) << "Loaded scene data from: " << FLAGS_scene_data;
+  } else {
+    LOG(ERROR) << "Failed to load scene data from: " << FLAGS_scene_data;
+    return EXIT_FAILURE;
+  }
+
+  auto* camera_config = scene_config.mutable_scene_data()->mutable_camera();
+  ApplyCameraFlags(camera_config);
+  if (FLAGS_dof_lens_size >= 0 && FLAGS_dof_focal_depth >= 0 &&
+      FLAGS_dof_visualization) {
+    camera_config->mutable_depth_of_field()->mutable_visualization_color()
+        ->CopyFrom(vis_color);
+  }
+
+  // Load the cameras of a batch of frames, if any.
+  std::vector<std::unique_ptr<Camera>> frames;
+  if (!FLAGS_camera_path.empty()) {
+    raytracer::CameraPathData camera_path;
+    if (!SceneParser::LoadTextProto(FLAGS_camera_path, &camera_path)) {
+      LOG(ERROR) << "Failed to load camera path from: " << FLAGS_camera_path;
+      return EXIT_FAILURE;
+    }
+    for (const auto& camera : CameraPath::Expand(
+             camera_path, scene_config.scene_data().camera())) {
+      frames.push_back(std::unique_ptr<Camera>(SceneParser::Parse(camera)));
+      if (frames.back().get() == NULL) {
+        LOG(ERROR) << "Incomplete camera for frame " << frames.size() - 1;
+        return EXIT_FAILURE;
+      }
+    }
+    LOG(INFO) << "Loaded " << frames.size() << " frames from: "
+              << FLAGS_camera_path;
+  }
+
+  // Build the scene from the config.
+  std::unique_ptr<Scene> scene(Scene::FromConfig(scene_config));
+
+  // Streaming only applies to single images which are not displayed.
+  const bool streaming = FLAGS_band_height > 0;
+  if (streaming && !frames.empty()) {
+    LOG(WARNING) << "Ignoring band height when rendering a camera path";
+  } else if (streaming && FLAGS_gui) {
+    LOG(WARNING) << "Ignoring band height when running the GUI";
+  } else if (streaming) {
+    renderer_config.set_band_height(FLAGS_band_height);
+  }
+
   // Build a renderer from the config.
   std::unique_ptr<Renderer> renderer(Renderer::FromConfig(renderer_config));
 
   renderer->AddListener(new ProgressListener());
+  if (!FLAGS_shm_framebuffer.empty()) {
+    renderer->AddListener(new SharedFramebuffer(FLAGS_shm_framebuffer));
+  }
   const string dir = "output/";
-  if (!FLAGS_bmp_file.empty()) {
+  if (renderer_config.band_height() > 0) {
+    const string name = FLAGS_bmp_file.empty() ? DefaultFilename()
+                                               : FLAGS_bmp_file;
+    renderer->AddListener(new StreamingExporter(dir + name + ".bmp",
+                                                StreamingExporter::BMP));
+    if (!FLAGS_ppm_file.empty()) {
+      renderer->AddListener(new StreamingExporter(
+          dir + FLAGS_ppm_file + ".ppm", StreamingExporter::PPM));
+    }
+  } else if (!frames.empty()) {
+    const string name = FLAGS_bmp_file.empty() ? DefaultFilename()
+                                               : FLAGS_bmp_file;
+    const string ppm_name = FLAGS_ppm_file.empty() ? "" : dir + FLAGS_ppm_file;
+    renderer->AddListener(new FrameExporter(dir + name, ppm_name));
+  } else if (!FLAGS_bmp_file.empty()) {
     renderer->AddListener(new BmpExporter(dir + FLAGS_bmp_file + ".bmp"));
   } else {
     renderer->AddListener(new BmpExporter(dir + DefaultFilename() + ".bmp"));
   }
 
-  if (!FLAGS_ppm_file.empty()) {
+  if (!FLAGS_ppm_file.empty() && frames.empty() &&
+      renderer_config.band_height() == 0) {
     renderer->AddListener(new PpmExporter("output/" + FLAGS_ppm_file + ".ppm"));
   }
 
+  // Compressed formats need the full image, so they are not streamed.
+  if (frames.empty() && renderer_config.band_height() == 0) {
+    if (!FLAGS_png_file.empty()) {
+      renderer->AddListener(new PngExporter(dir + FLAGS_png_file + ".png"));
+    }
+    if (!FLAGS_exr_file.empty()) {
+      renderer->AddListener(new ExrExporter(dir + FLAGS_exr_file + ".exr"));
+    }
+  } else if (!FLAGS_png_file.empty() || !FLAGS_exr_file.empty()) {
+    LOG(WARNING) << "PNG and OpenEXR files are only written for single images "
+                 << "which are not streamed";
+  }
+
   RaytracerWindow* window = NULL;
   if (FLAGS_gui) {
     window = new RaytracerWindow(&argc, argv);
@@ -256,7 +565,12 @@ int main(int argc, char **argv) {
 
   // Run the rendering itself on an own thread to allow the UI (if any) to be
   // on the main thread.
-  std::thread thread(&Renderer::Render, renderer.get(), scene.get());
+  std::thread thread;
+  if (frames.empty()) {
+    thread = std::thread(&Renderer::Render, renderer.get(), scene.get());
+  } else {
+    thread = std::thread(&RenderFrames, renderer.get(), scene.get(), &frames);
+  }
 
   if (window != NULL) {
     // This never returns. That's ok since memory freeing is done after this
@@ -267,6 +581,9 @@ int main(int argc, char **argv) {
   // Only relevant if there is no GUI.
   thread.join();
 
+  // Waits for frames which are still being exported.
+  renderer.reset();
+
   // Free all memory in the various Google libraries.
   google::protobuf::ShutdownProtobufLibrary();
   google::ShutdownGoogleLogging();
@@ -0,0 +1,422 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Renders a set of scenes at a fixed resolution, seed and number of threads,
+ * and reports timings, ray throughput and memory usage as JSON. If a baseline
+ * report is passed, exits with a failure if any of the measurements regressed
+ * by more than a threshold.
+ * Author: Dino Wernli
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/util/json_util.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "parser/scene_parser.h"
+#include "proto/bench/bench_report.pb.h"
+#include "proto/config/renderer_config.pb.h"
+#include "proto/config/scene_config.pb.h"
+#include "proto/scene/scene_data.pb.h"
+#include "renderer/renderer.h"
+#include "renderer/trace_counters.h"
+#include "scene/scene.h"
+#include "util/memory_report.h"
+#include "util/random.h"
+
+using raytracer::BenchReport;
+using raytracer::BenchResult;
+using std::string;
+
+DEFINE_string(scenes, "", "Comma separated scene data files to render. If "
+                          "empty, all '.sd' files in scene_dir are rendered");
+
+DEFINE_string(scene_dir, "data/scene", "The directory from which scenes are "
+                                       "taken if no scenes are passed");
+
+DEFINE_int32(width, 640, "The horizontal resolution of all images");
+
+DEFINE_int32(height, 480, "The vertical resolution of all images");
+
+DEFINE_string(threads, "1,4", "Comma separated numbers of worker threads with "
+                              "which each scene is rendered");
+
+DEFINE_uint64(seed, 1, "The seed of all random number generators");
+
+DEFINE_uint64(repetitions, 3, "How often each scene is rendered. Only the "
+                              "fastest rendering is reported");
+
+DEFINE_string(output, "", "If not empty, the report is written to this file "
+                          "instead of stdout");
+
+DEFINE_string(baseline, "", "If not empty, the report is compared against the "
+                            "report stored in this file");
+
+DEFINE_double(regression_threshold, 0.1, "The fraction by which a time or the "
+                                         "peak memory usage may exceed the "
+                                         "baseline before it counts as a "
+                                         "regression");
+
+// Differences smaller than these are considered noise.
+static const double kMinSignificantSeconds = 0.01;
+static const uint64_t kMinSignificantKb = 1024;
+
+// Returns the number of seconds elapsed since "start".
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Splits a comma separated list, dropping empty entries.
+static std::vector<string> SplitList(const string& list) {
+  std::vector<string> result;
+  std::stringstream stream(list);
+  string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      result.push_back(item);
+    }
+  }
+  return result;
+}
+
+// Returns the scene files to render, sorted so that reports are comparable.
+static std::vector<string> SceneFiles() {
+  if (!FLAGS_scenes.empty()) {
+    return SplitList(FLAGS_scenes);
+  }
+  std::vector<string> result;
+  DIR* dir = opendir(FLAGS_scene_dir.c_str());
+  if (dir == NULL) {
+    LOG(ERROR) << "Failed to open scene directory: " << FLAGS_scene_dir;
+    return result;
+  }
+  const string suffix = ".sd";
+  while (struct dirent* entry = readdir(dir)) {
+    const string name = entry->d_name;
+    if (name.size() > suffix.size() &&
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      result.push_back(FLAGS_scene_dir + "/" + name);
+    }
+  }
+  closedir(dir);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+static double MraysPerSecond(uint64_t rays, double seconds) {
+  return seconds > 0 ? rays / seconds / 1e6 : 0;
+}
+
+// Loads and renders the scene, storing the measurements in result.
+static bool Measure(const string& path, size_t threads, BenchResult* result) {
+  Random::SetSeed(FLAGS_seed);
+  auto start = std::chrono::steady_clock::now();
+
+  // Meshes are always parsed from their source files so that loading does not
+  // depend on earlier runs.
+  raytracer::SceneConfig scene_config;
+  scene_config.set_use_mesh_cache(false);
+  scene_config.mutable_kd_tree_config();
+  if (!SceneParser::LoadTextProto(path, scene_config.mutable_scene_data())) {
+    LOG(ERROR) << "Failed to load scene data from: " << path;
+    return false;
+  }
+  auto* camera = scene_config.mutable_scene_data()->mutable_camera();
+  camera->set_resolution_x(FLAGS_width);
+  camera->set_resolution_y(FLAGS_height);
+  std::unique_ptr<Scene> scene(Scene::FromConfig(scene_config));
+  result->set_load_seconds(SecondsSince(start));
+
+  // Rendering initializes the scene too, but does nothing if it already is.
+  auto build_start = std::chrono::steady_clock::now();
+  scene->Init();
+  result->set_kd_tree_build_seconds(SecondsSince(build_start));
+
+  result->set_scene_bytes(scene->memory_report().total_bytes());
+
+  raytracer::RendererConfig renderer_config;
+  renderer_config.set_threads(threads);
+  renderer_config.set_shadows(true);
+  std::unique_ptr<Renderer> renderer(Renderer::FromConfig(renderer_config));
+
+  auto render_start = std::chrono::steady_clock::now();
+  renderer->Render(scene.get());
+  const double render_seconds = SecondsSince(render_start);
+  result->set_render_seconds(render_seconds);
+  result->set_wall_seconds(SecondsSince(start));
+
+  const TraceCounters& counters = renderer->trace_counters();
+  result->set_primary_rays(counters.primary_rays);
+  result->set_shadow_rays(counters.shadow_rays);
+  result->set_secondary_rays(counters.secondary_rays);
+  result->set_hits(counters.hits);
+  result->set_shadow_early_outs(counters.shadow_early_outs);
+  result->set_kd_tree_nodes_visited(counters.kd_tree_nodes_visited);
+  result->set_leaf_element_tests(counters.leaf_element_tests);
+  result->set_primary_mrays_per_second(
+      MraysPerSecond(counters.primary_rays, render_seconds));
+  result->set_shadow_mrays_per_second(
+      MraysPerSecond(counters.shadow_rays, render_seconds));
+  result->set_secondary_mrays_per_second(
+      MraysPerSecond(counters.secondary_rays, render_seconds));
+  result->set_total_mrays_per_second(
+      MraysPerSecond(counters.total_rays(), render_seconds));
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  result->set_peak_rss_kb(usage.ru_maxrss);
+  return true;
+}
+
+// Runs Measure in a child process, so that the peak memory usage only covers
+// this scene and no state is shared between renderings.
+static bool MeasureInChild(const string& path, size_t threads,
+                           BenchResult* result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    PLOG(ERROR) << "Failed to create pipe";
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    PLOG(ERROR) << "Failed to fork";
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    BenchResult child_result;
+    string data;
+    const bool success = Measure(path, threads, &child_result) &&
+                         child_result.SerializeToString(&data);
+    size_t written = 0;
+    while (success && written < data.size()) {
+      ssize_t n = write(fds[1], data.data() + written, data.size() - written);
+      if (n <= 0) {
+        _exit(EXIT_FAILURE);
+      }
+      written += n;
+    }
+    close(fds[1]);
+    _exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  close(fds[1]);
+  string data;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    data.append(buffer, n);
+  }
+  close(fds[0]);
+
+  int status;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != EXIT_SUCCESS) {
+    LOG(ERROR) << "Rendering " << path << " with " << threads
+               << " threads failed";
+    return false;
+  }
+  return result->ParseFromString(data);
+}
+
+// Logs and returns whether current exceeds base by more than the threshold
+// and by more than the given noise floor.
+template<typename T>
+static bool CheckRegression(const BenchResult& result, const string& name,
+                            T current, T base, T noise) {
+  if (current <= base * (1 + FLAGS_regression_threshold) ||
+      current - base <= noise) {
+    return false;
+  }
+  LOG(ERROR) << result.scene() << " with " << result.threads()
+             << " threads: " << name << " regressed from " << base << " to "
+             << current;
+  return true;
+}
+
+// Returns the number of measurements in report which regressed with respect
+// to the result for the same scene and configuration in baseline.
+static size_t CountRegressions(const BenchReport& report,
+                               const BenchReport& baseline) {
+  size_t regressions = 0;
+  for (const BenchResult& result : report.results()) {
+    const BenchResult* base = NULL;
+    for (const BenchResult& candidate : baseline.results()) {
+      if (candidate.scene() == result.scene() &&
+          candidate.threads() == result.threads() &&
+          candidate.width() == result.width() &&
+          candidate.height() == result.height()) {
+        base = &candidate;
+      }
+    }
+    if (base == NULL) {
+      LOG(WARNING) << "No baseline for " << result.scene() << " with "
+                   << result.threads() << " threads";
+      continue;
+    }
+    regressions += CheckRegression(result, "load time", result.load_seconds(),
+                                   base->load_seconds(),
+                                   kMinSignificantSeconds);
+    regressions += CheckRegression(result, "KdTree build time",
+                                   result.kd_tree_build_seconds(),
+                                   base->kd_tree_build_seconds(),
+                                   kMinSignificantSeconds);
+    regressions += CheckRegression(result, "render time",
+                                   result.render_seconds(),
+                                   base->render_seconds(),
+                                   kMinSignificantSeconds);
+    regressions += CheckRegression<uint64_t>(result, "peak RSS (kB)",
+                                             result.peak_rss_kb(),
+                                             base->peak_rss_kb(),
+                                             kMinSignificantKb);
+    if (base->has_scene_bytes()) {
+      regressions += CheckRegression<uint64_t>(result, "scene memory (bytes)",
+                                               result.scene_bytes(),
+                                               base->scene_bytes(),
+                                               kMinSignificantKb * 1024);
+    }
+  }
+  return regressions;
+}
+
+static bool ReadFile(const string& path, string* contents) {
+  std::ifstream stream(path.c_str());
+  if (!stream) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+// Runs the benchmark and returns the process exit code.
+static int RunBenchmark() {
+  std::vector<size_t> thread_counts;
+  for (const string& item : SplitList(FLAGS_threads)) {
+    thread_counts.push_back(std::stoul(item));
+  }
+  const std::vector<string> scenes = SceneFiles();
+  if (scenes.empty() || thread_counts.empty()) {
+    LOG(ERROR) << "Nothing to benchmark";
+    return EXIT_FAILURE;
+  }
+
+  BenchReport report;
+  report.set_seed(FLAGS_seed);
+  report.set_repetitions(std::max<uint64_t>(FLAGS_repetitions, 1));
+  bool success = true;
+  for (const string& scene : scenes) {
+    for (size_t threads : thread_counts) {
+      BenchResult best;
+      for (size_t i = 0; i < report.repetitions(); ++i) {
+        BenchResult result;
+        if (!MeasureInChild(scene, threads, &result)) {
+          success = false;
+          break;
+        }
+        if (i == 0 || result.wall_seconds() < best.wall_seconds()) {
+          best = result;
+        }
+      }
+      if (!best.has_wall_seconds()) {
+        continue;
+      }
+      best.set_scene(scene);
+      best.set_threads(threads);
+      best.set_width(FLAGS_width);
+      best.set_height(FLAGS_height);
+      LOG(INFO) << scene << " with " << threads << " threads: "
+                << best.render_seconds() << "s, "
+                << best.total_mrays_per_second() << " Mrays/s";
+      *report.add_results() = best;
+    }
+  }
+
+  google::protobuf::util::JsonPrintOptions options;
+  options.add_whitespace = true;
+  options.always_print_primitive_fields = true;
+  options.preserve_proto_field_names = true;
+  string json;
+  google::protobuf::util::MessageToJsonString(report, &json, options);
+  if (FLAGS_output.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream stream(FLAGS_output.c_str());
+    stream << json;
+    if (!stream) {
+      LOG(ERROR) << "Failed to write report to: " << FLAGS_output;
+      success = false;
+    }
+  }
+
+  if (!FLAGS_baseline.empty()) {
+    BenchReport baseline;
+    string contents;
+    if (!ReadFile(FLAGS_baseline, &contents) ||
+        !google::protobuf::util::JsonStringToMessage(contents,
+                                                     &baseline).ok()) {
+      LOG(ERROR) << "Failed to load baseline from: " << FLAGS_baseline;
+      return EXIT_FAILURE;
+    }
+    if (baseline.seed() != report.seed()) {
+      LOG(WARNING) << "Baseline was recorded with seed " << baseline.seed();
+    }
+    const size_t regressions = CountRegressions(report, baseline);
+    if (regressions > 0) {
+      LOG(ERROR) << regressions << " regressions against " << FLAGS_baseline;
+      success = false;
+    } else {
+      LOG(INFO) << "No regressions against " << FLAGS_baseline;
+    }
+  }
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  const int result = RunBenchmark();
+
+  google::protobuf::ShutdownProtobufLibrary();
+  google::ShutdownGoogleLogging();
+  google::ShutDownCommandLineFlags();
+  return result;
+}
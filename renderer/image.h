@@ -28,11 +28,14 @@
 #ifndef IMAGE_H_
 #define IMAGE_H_
 
+#include <algorithm>
+#include <functional>
 #include <glog/logging.h>
 #include <limits>
 #include <memory>
 #include <vector>
 
+#include "renderer/image_kernels.h"
 #include "util/color3.h"
 
 class Image {
@@ -71,35 +74,69 @@ class Image {
     return Color3(pixels_[pos], pixels_[pos + 1], pixels_[pos + 2]);
   }
 
+  // The bulk operations below process the rows of the image in parallel.
   Intensity MaxIntensity() const {
-    Intensity result = -std::numeric_limits<Intensity>::infinity();
-    for (size_t x = 0; x < SizeX(); ++x) {
-      for (size_t y = 0; y < SizeY(); ++y) {
-        const Color3& color = PixelAt(x, y);
-        result = std::max(result, color.r());
-        result = std::max(result, color.g());
-        result = std::max(result, color.b());
-      }
-    }
+    const size_t row_size = kNumberOfChannels * size_x_;
+    std::vector<Intensity> maxima(ImageKernels::NumChunks(size_y_, row_size),
+                                  -std::numeric_limits<Intensity>::infinity());
+    ImageKernels::ParallelFor(size_y_, row_size,
+                              [&](size_t chunk, size_t begin, size_t end) {
+      maxima[chunk] = ImageKernels::Max(RawData() + begin * row_size,
+                                        (end - begin) * row_size);
+    });
+    Intensity result = *std::max_element(maxima.begin(), maxima.end());
     DVLOG(1) << "Computed maximum as: " << result;
     return result;
   }
 
   // Multiplies all the intensities by factor.
   void Scale(const Intensity& factor) {
-    for (size_t x = 0; x < SizeX(); ++x) {
-      for (size_t y = 0; y < SizeY(); ++y) {
-        PutPixel(factor * PixelAt(x, y), x, y);
-      }
-    }
+    Transform([&](Intensity* values, size_t n) {
+      ImageKernels::Scale(values, n, factor);
+    });
+  }
+
+  // Clamps all the intensities to [low, high].
+  void Clamp(const Intensity& low, const Intensity& high) {
+    Transform([&](Intensity* values, size_t n) {
+      ImageKernels::Clamp(values, n, low, high);
+    });
+  }
+
+  // Compresses all the intensities into [0, 1) after multiplying them by
+  // exposure. See ImageKernels::ToneMap().
+  void ToneMap(const Intensity& exposure) {
+    Transform([&](Intensity* values, size_t n) {
+      ImageKernels::ToneMap(values, n, exposure);
+    });
+  }
+
+  // Raises all the intensities to the power of 1 / gamma.
+  void ApplyGamma(const Intensity& gamma) {
+    Transform([&](Intensity* values, size_t n) {
+      ImageKernels::Gamma(values, n, gamma);
+    });
+  }
+
+  // Applies the kernel to all the intensities, in parallel chunks of rows.
+  void Transform(const std::function<void(Intensity*, size_t)>& kernel) {
+    const size_t row_size = kNumberOfChannels * size_x_;
+    Intensity* pixels = pixels_.data();
+    ImageKernels::ParallelFor(size_y_, row_size,
+                              [&](size_t chunk, size_t begin, size_t end) {
+      kernel(pixels + begin * row_size, (end - begin) * row_size);
+    });
   }
 
   // Is guaranteed not to change throughout the lifetime of this object.
-  const Intensity* RawData() const { return &pixels_[0]; }
+  const Intensity* RawData() const { return pixels_.data(); }
 
   const size_t SizeX() const { return size_x_; }
   const size_t SizeY() const { return size_y_; }
 
+  // Returns the number of bytes used by the pixels.
+  size_t ByteSize() const { return pixels_.capacity() * sizeof(Intensity); }
+
  private:
   // We have 3 color channels.
   static const size_t kNumberOfChannels = 3;
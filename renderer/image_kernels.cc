@@ -0,0 +1,284 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "renderer/image_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+// A block of values processed at once, which fills one SIMD register. The
+// alignment is lowered so that blocks can be loaded from and stored to
+// arbitrary positions in an array.
+#ifdef __AVX__
+#define BLOCK_BYTES 32
+#else
+#define BLOCK_BYTES 16
+#endif
+typedef Intensity Block __attribute__((vector_size(BLOCK_BYTES), aligned(4)));
+typedef int IntBlock __attribute__((vector_size(BLOCK_BYTES)));
+
+static const size_t kBlockSize = sizeof(Block) / sizeof(Intensity);
+
+static inline Block Splat(Intensity value) {
+  Block block;
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    block[i] = value;
+  }
+  return block;
+}
+
+static inline Block Load(const Intensity* values) {
+  Block block;
+  memcpy(&block, values, sizeof(block));
+  return block;
+}
+
+static inline void Store(const Block& block, Intensity* values) {
+  memcpy(values, &block, sizeof(block));
+}
+
+static inline Block Min(const Block& a, const Block& b) {
+  return a < b ? a : b;
+}
+
+static inline Block Max(const Block& a, const Block& b) {
+  return a > b ? a : b;
+}
+
+static inline Intensity Min(Intensity a, Intensity b) {
+  return a < b ? a : b;
+}
+
+static inline Intensity Max(Intensity a, Intensity b) {
+  return a > b ? a : b;
+}
+
+// Replaces every value v by op(v). The operation is called with whole blocks
+// and with the single values left over at the end, so it needs to support both.
+template<typename Operation>
+static void Transform(Intensity* values, size_t n, const Operation& op) {
+  size_t i = 0;
+  for (; i + kBlockSize <= n; i += kBlockSize) {
+    Store(op(Load(values + i)), values + i);
+  }
+  for (; i < n; ++i) {
+    values[i] = op(values[i]);
+  }
+}
+
+// Converts a single value to half precision, rounding to nearest even.
+static uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  if (exponent == 128 + 15) {
+    // Infinity stays infinity, NaN stays NaN.
+    return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+  }
+  if (exponent >= 31) {
+    return sign | 0x7c00;
+  }
+
+  uint32_t shift = 13;
+  uint32_t half = (exponent << 10);
+  if (exponent <= 0) {
+    // The result is subnormal, so the implicit leading bit becomes explicit.
+    if (exponent < -10) {
+      return sign;
+    }
+    mantissa |= 0x800000;
+    shift = 14 - exponent;
+    half = 0;
+  }
+  half |= mantissa >> shift;
+  const uint32_t rest = mantissa & ((1u << shift) - 1);
+  const uint32_t halfway = 1u << (shift - 1);
+  if (rest > halfway || (rest == halfway && (half & 1))) {
+    // A carry into the exponent correctly yields the next power of two, or
+    // infinity.
+    ++half;
+  }
+  return sign | half;
+}
+
+namespace {
+
+struct ScaleOperation {
+  Intensity factor;
+  Block operator()(const Block& v) const { return v * Splat(factor); }
+  Intensity operator()(Intensity v) const { return v * factor; }
+};
+
+struct ClampOperation {
+  Intensity low;
+  Intensity high;
+  Block operator()(const Block& v) const {
+    return Min(Max(v, Splat(low)), Splat(high));
+  }
+  Intensity operator()(Intensity v) const { return Min(Max(v, low), high); }
+};
+
+struct ToneMapOperation {
+  Intensity exposure;
+  Block operator()(const Block& v) const {
+    const Block exposed = v * Splat(exposure);
+    return exposed / (Splat(1) + exposed);
+  }
+  Intensity operator()(Intensity v) const {
+    const Intensity exposed = v * exposure;
+    return exposed / (1 + exposed);
+  }
+};
+
+}  // namespace
+
+// static
+Intensity ImageKernels::Max(const Intensity* values, size_t n) {
+  const Intensity lowest = -std::numeric_limits<Intensity>::infinity();
+  Block block_max = Splat(lowest);
+  size_t i = 0;
+  for (; i + kBlockSize <= n; i += kBlockSize) {
+    block_max = ::Max(block_max, Load(values + i));
+  }
+
+  Intensity result = lowest;
+  for (size_t j = 0; j < kBlockSize; ++j) {
+    result = ::Max(result, block_max[j]);
+  }
+  for (; i < n; ++i) {
+    result = ::Max(result, values[i]);
+  }
+  return result;
+}
+
+// static
+void ImageKernels::Scale(Intensity* values, size_t n, Intensity factor) {
+  ScaleOperation op = { factor };
+  Transform(values, n, op);
+}
+
+// static
+void ImageKernels::Clamp(Intensity* values, size_t n, Intensity low,
+                         Intensity high) {
+  ClampOperation op = { low, high };
+  Transform(values, n, op);
+}
+
+// static
+void ImageKernels::ToneMap(Intensity* values, size_t n, Intensity exposure) {
+  ToneMapOperation op = { exposure };
+  Transform(values, n, op);
+}
+
+// static
+void ImageKernels::Gamma(Intensity* values, size_t n, Intensity gamma) {
+  // There is no vectorized power function, so this one runs value by value.
+  const Intensity exponent = 1 / gamma;
+  for (size_t i = 0; i < n; ++i) {
+    values[i] = std::pow(::Max(values[i], Intensity(0)), exponent);
+  }
+}
+
+// static
+void ImageKernels::Quantize(const Intensity* values, size_t n,
+                            unsigned char* out) {
+  const Block zero = Splat(0);
+  const Block one = Splat(1);
+  const Block scale = Splat(255);
+
+  size_t i = 0;
+  for (; i + kBlockSize <= n; i += kBlockSize) {
+    const Block clamped = ::Min(::Max(Load(values + i), zero), one);
+    const IntBlock scaled = __builtin_convertvector(clamped * scale, IntBlock);
+    for (size_t j = 0; j < kBlockSize; ++j) {
+      out[i + j] = (unsigned char)(scaled[j]);
+    }
+  }
+  for (; i < n; ++i) {
+    out[i] = (unsigned char)(::Min(::Max(values[i], Intensity(0)),
+                                   Intensity(1)) * 255);
+  }
+}
+
+// static
+void ImageKernels::ToHalf(const Intensity* values, size_t n, uint16_t* out) {
+  size_t i = 0;
+#ifdef __F16C__
+  for (; i + 8 <= n; i += 8) {
+    const __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(values + i),
+                                           _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), halves);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = FloatToHalf(values[i]);
+  }
+}
+
+// static
+size_t ImageKernels::ParallelFor(
+    size_t n, size_t item_size,
+    const std::function<void(size_t, size_t, size_t)>& body) {
+  const size_t chunks = NumChunks(n, item_size);
+  const size_t chunk_size = (n + chunks - 1) / chunks;
+  if (chunks == 1) {
+    body(0, 0, n);
+    return 1;
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t chunk = 1; chunk < chunks; ++chunk) {
+    const size_t begin = std::min(n, chunk * chunk_size);
+    const size_t end = std::min(n, begin + chunk_size);
+    threads.push_back(std::thread(body, chunk, begin, end));
+  }
+  body(0, 0, std::min(n, chunk_size));
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+  return chunks;
+}
+
+// static
+size_t ImageKernels::NumChunks(size_t n, size_t item_size) {
+  const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  const size_t by_size = n * item_size / kMinValuesPerThread;
+  return std::max<size_t>(1, std::min(std::min(max_threads, by_size), n));
+}
+
+// static
+const size_t ImageKernels::kMinValuesPerThread = 1 << 18;
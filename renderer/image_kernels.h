@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Bulk kernels operating on contiguous arrays of channel intensities, such as
+ * the pixels of an image. The kernels process blocks of values using the GCC
+ * vector extensions, which compile to SSE/AVX instructions where available.
+ * Author: Dino Wernli
+ */
+
+#ifndef IMAGE_KERNELS_H_
+#define IMAGE_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "util/numeric.h"
+
+class ImageKernels {
+ public:
+  // Returns the largest of the n values, or -infinity if n is 0.
+  static Intensity Max(const Intensity* values, size_t n);
+
+  // Multiplies each of the n values by factor.
+  static void Scale(Intensity* values, size_t n, Intensity factor);
+
+  // Clamps each of the n values to [low, high].
+  static void Clamp(Intensity* values, size_t n, Intensity low,
+                    Intensity high);
+
+  // Maps each of the n values v to e / (1 + e) where e = v * exposure, i.e.,
+  // applies the Reinhard operator, which compresses [0, inf) into [0, 1).
+  static void ToneMap(Intensity* values, size_t n, Intensity exposure);
+
+  // Maps each of the n values v to max(v, 0) ^ (1 / gamma).
+  static void Gamma(Intensity* values, size_t n, Intensity gamma);
+
+  // Stores each of the n values, clamped to [0, 1] and scaled to [0, 255], in
+  // the corresponding byte of out. Fractions are truncated.
+  static void Quantize(const Intensity* values, size_t n, unsigned char* out);
+
+  // Stores each of the n values as an IEEE 754 half precision float in the
+  // corresponding entry of out, rounding to the nearest representable value.
+  // Values too large for half precision become infinity.
+  static void ToHalf(const Intensity* values, size_t n, uint16_t* out);
+
+  // Splits the n items [0, n), e.g., rows of an image, into contiguous chunks,
+  // which are passed to body as (chunk, begin, end) on parallel threads. Every
+  // item consists of "item_size" values. Small amounts of values are processed
+  // on the calling thread. Returns the number of chunks.
+  static size_t ParallelFor(
+      size_t n, size_t item_size,
+      const std::function<void(size_t, size_t, size_t)>& body);
+
+  // Returns the number of chunks ParallelFor() splits the n items into.
+  static size_t NumChunks(size_t n, size_t item_size);
+
+ private:
+  // The minimum number of values processed by a thread of ParallelFor().
+  static const size_t kMinValuesPerThread;
+};
+
+#endif  /* IMAGE_KERNELS_H_ */
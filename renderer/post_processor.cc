@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "renderer/post_processor.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+
+#include "proto/config/renderer_config.pb.h"
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
+
+PostProcessor::PostProcessor(Intensity exposure, bool tone_mapping,
+                             Intensity gamma)
+    : exposure_(exposure), tone_mapping_(tone_mapping), gamma_(gamma) {
+  if (gamma_ <= 0) {
+    LOG(WARNING) << "Invalid gamma " << gamma_ << ", using 1 instead";
+    gamma_ = 1;
+  }
+}
+
+PostProcessor::~PostProcessor() {
+}
+
+void PostProcessor::Apply(Image* image) const {
+  if (IsIdentity()) {
+    return;
+  }
+  image->Transform([this](Intensity* values, size_t n) {
+    for (size_t begin = 0; begin < n; begin += kBlockSize) {
+      Intensity* block = values + begin;
+      const size_t size = std::min(kBlockSize, n - begin);
+      if (tone_mapping_) {
+        ImageKernels::ToneMap(block, size, exposure_);
+      } else if (exposure_ != 1) {
+        ImageKernels::Scale(block, size, exposure_);
+      }
+      if (gamma_ != 1) {
+        ImageKernels::Gamma(block, size, gamma_);
+      }
+    }
+  });
+}
+
+bool PostProcessor::IsIdentity() const {
+  return !tone_mapping_ && exposure_ == 1 && gamma_ == 1;
+}
+
+// static
+PostProcessor* PostProcessor::FromConfig(
+    const raytracer::RendererConfig& config) {
+  PostProcessor* result = new PostProcessor(
+      config.exposure(), config.tone_mapping(), config.gamma());
+  if (result->IsIdentity()) {
+    delete result;
+    return NULL;
+  }
+  return result;
+}
+
+// static
+const size_t PostProcessor::kBlockSize = 4096;
@@ -0,0 +1,70 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Transforms the intensities of a rendered image, e.g., to compress a high
+ * dynamic range into the displayable range before exporting.
+ * Author: Dino Wernli
+ */
+
+#ifndef POST_PROCESSOR_H_
+#define POST_PROCESSOR_H_
+
+#include <cstddef>
+
+#include "util/no_copy_assign.h"
+#include "util/numeric.h"
+
+class Image;
+
+namespace raytracer {
+class RendererConfig;
+}
+
+class PostProcessor {
+ public:
+  // See RendererConfig for the meaning of the arguments.
+  PostProcessor(Intensity exposure, bool tone_mapping, Intensity gamma);
+  virtual ~PostProcessor();
+  NO_COPY_ASSIGN(PostProcessor);
+
+  // Transforms all the intensities of the image in place.
+  void Apply(Image* image) const;
+
+  // Returns whether Apply() leaves every image unchanged.
+  bool IsIdentity() const;
+
+  // Returns NULL if the configured post-processing does nothing. The caller
+  // takes ownership of the returned object.
+  static PostProcessor* FromConfig(const raytracer::RendererConfig& config);
+
+ private:
+  Intensity exposure_;
+  bool tone_mapping_;
+  Intensity gamma_;
+
+  // All operations are applied to blocks of this many values at a time, which
+  // keeps the values in cache between the operations.
+  static const size_t kBlockSize;
+};
+
+#endif  /* POST_PROCESSOR_H_ */
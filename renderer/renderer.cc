@@ -27,19 +27,25 @@
 #include "renderer.h"
 
 #include <algorithm>
+#include <chrono>
 #include <glog/logging.h>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <thread>
 #include <unistd.h>
 
 #include "listener/bmp_exporter.h"
 #include "proto/config/renderer_config.pb.h"
+#include "renderer/image.h"
 #include "renderer/intersection_data.h"
+#include "renderer/post_processor.h"
 #include "renderer/sampler/progressive_sampler.h"
 #include "renderer/sampler/sample.h"
 #include "renderer/sampler/sampler.h"
 #include "renderer/sampler/scanline_sampler.h"
 #include "renderer/sampler/supersampler.h"
+#include "renderer/sampler/tile_sampler.h"
 #include "renderer/shader/phong_shader.h"
 #include "renderer/shader/shader.h"
 #include "renderer/statistics.h"
@@ -47,14 +53,18 @@
 #include "scene/light/light.h"
 #include "scene/material.h"
 #include "scene/scene.h"
+#include "util/memory_report.h"
 #include "util/ray.h"
+#include "util/trace.h"
 
 Renderer::Renderer(Sampler* sampler, Supersampler* supersampler,
                    Shader* shader, size_t num_threads, size_t recursion_depth,
-                   Statistics* stats)
+                   Statistics* stats, PostProcessor* post_processor,
+                   bool perf_counters)
     : sampler_(sampler), supersampler_(supersampler), shader_(shader),
       num_threads_(num_threads), recursion_depth_(recursion_depth),
-      statistics_(stats) {
+      statistics_(stats), post_processor_(post_processor),
+      perf_counters_(perf_counters) {
   if (num_threads == 0) {
     LOG(WARNING) << "Can't render with 0 workers. Using 1 instead.";
     num_threads_ = 1;
@@ -74,6 +84,7 @@ void Renderer::AddListener(Updatable* listener) {
 }
 
 void Renderer::Render(Scene* scene) {
+  ScopedSpan span("Renderer::Render");
   LOG(INFO) << "Starting rendering process";
   scene_ = scene;
 
@@ -100,7 +111,17 @@ void Renderer::Render(Scene* scene) {
     statistics_->Init(camera->resolution_x(), camera->resolution_y());
   }
 
+  // The scene logs its part of the report when it is built. Only the sampler,
+  // which is initialized for every rendering, is added here.
+  if (!memory_report_path_.empty()) {
+    MemoryReport memory_report(scene_->memory_report());
+    sampler_->AddMemoryUsage(&memory_report);
+    memory_report.WriteJson(memory_report_path_);
+  }
+
   LOG(INFO) << "Creating " << num_threads_ << " workers";
+  trace_counters_ = TraceCounters();
+  worker_perf_.assign(num_threads_, WorkerPerf());
 
   for(auto it = listeners_.begin(); it != listeners_.end(); ++it) {
     it->get()->Started(*sampler_);
@@ -114,13 +135,40 @@ void Renderer::Render(Scene* scene) {
     for(auto it = listeners_.begin(); it != listeners_.end(); ++it) {
       it->get()->Updated(*sampler_);
     }
-    usleep(kSleepTimeMilli * MILLI_TO_MICRO);
+
+    // Wake up as soon as the sampler is done so that short renderings, such as
+    // jobs on a resident scene, do not wait for the full period.
+    for (size_t slept = 0; slept < kSleepTimeMilli && !sampler_->IsDone();
+         slept += kPollTimeMilli) {
+      usleep(kPollTimeMilli * MILLI_TO_MICRO);
+    }
   }
   for (auto it = workers.begin(); it != workers.end(); ++it) {
     it->join();
   }
-  for(auto it = listeners_.begin(); it != listeners_.end(); ++it) {
-    it->get()->Ended(*sampler_);
+  LOG(INFO) << "Traced " << trace_counters_.primary_rays << " primary, "
+            << trace_counters_.shadow_rays << " shadow ("
+            << trace_counters_.shadow_early_outs << " occluded) and "
+            << trace_counters_.secondary_rays << " secondary rays with "
+            << trace_counters_.hits << " hits, visiting "
+            << trace_counters_.kd_tree_nodes_visited << " KdTree nodes and "
+            << "testing " << trace_counters_.leaf_element_tests
+            << " leaf elements";
+  if (perf_counters_) {
+    LogPerfCounters();
+  }
+  if (HasStatistics()) {
+    statistics_->set_trace_counters(trace_counters_);
+  }
+  if (post_processor_.get() != NULL) {
+    ScopedSpan post_processing_span("PostProcessor::Apply");
+    post_processor_->Apply(sampler_->mutable_image());
+  }
+  {
+    ScopedSpan listeners_span("Updatable::Ended");
+    for(auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+      it->get()->Ended(*sampler_);
+    }
   }
 
   LOG(INFO) << "All workers terminated";
@@ -135,6 +183,7 @@ void Renderer::Render(Scene* scene) {
 }
 
 void Renderer::WorkerMain(size_t worker_id) {
+  Trace::SetThreadName("Worker " + std::to_string(worker_id));
   DVLOG(1) << "Worker " << worker_id << " allocating buffer of size "
            << sampler_->MaxJobSize();
   // Buffers a set of samples which represent image pixels.
@@ -151,10 +200,32 @@ void Renderer::WorkerMain(size_t worker_id) {
   // once the first ray is fully traced.
   std::vector<Scalar> refraction_stack;
 
+  // The thread may have rendered before, e.g., on a render server.
+  TraceCounters& counters = TraceCounters::ForThisThread();
+  counters = TraceCounters();
+
+  // Only counts this thread, and only while it renders.
+  std::unique_ptr<PerfCounters> perf_counters;
+  if (perf_counters_) {
+    perf_counters.reset(new PerfCounters());
+    perf_counters->Start();
+  }
+
+  // Measuring the cost of every pixel is only worth it if it is shown.
+  const bool record_costs = HasStatistics() && statistics_->HasCostHeatmaps();
+
   size_t n_samples = 0;
   while((n_samples = sampler_->NextJob(&samples)) > 0) {
+    ScopedSpan job_span("Job");
     for (size_t i = 0; i < n_samples; ++i) {
       Sample& main_sample = samples[i];
+      TraceCounters before;
+      std::chrono::steady_clock::time_point start;
+      if (record_costs) {
+        before = counters;
+        start = std::chrono::steady_clock::now();
+      }
+
       Supersampler supersampler(*supersampler_);
       DVLOG(3) << "Processing sample " << main_sample;
 
@@ -171,17 +242,111 @@ void Renderer::WorkerMain(size_t worker_id) {
         supersampler.ReportResults(subsamples, current_subsamples);
       }
       main_sample.set_color(supersampler.MeanResults());
+
+      if (record_costs) {
+        const size_t x = main_sample.x();
+        const size_t y = main_sample.y();
+        statistics_->AddCost(Statistics::KD_TREE_NODES, x, y,
+            counters.kd_tree_nodes_visited - before.kd_tree_nodes_visited);
+        statistics_->AddCost(Statistics::ELEMENT_TESTS, x, y,
+            counters.leaf_element_tests - before.leaf_element_tests);
+        statistics_->AddCost(Statistics::NANOSECONDS, x, y,
+            std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count());
+      }
     }
     sampler_->AcceptJob(samples, n_samples);
+
+    std::unique_ptr<Image> band;
+    size_t band_y;
+    while (sampler_->PopCompletedBand(&band, &band_y)) {
+      if (post_processor_.get() != NULL) {
+        post_processor_->Apply(band.get());
+      }
+      for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+        it->get()->RowsCompleted(*sampler_, *band, band_y);
+      }
+    }
   }
+
+  WorkerPerf perf;
+  if (perf_counters.get() != NULL) {
+    perf_counters->Stop();
+    perf.values = perf_counters->Read();
+    perf.rays = counters.total_rays();
+  }
+
+  std::lock_guard<std::mutex> lock(trace_counters_mutex_);
+  trace_counters_ += counters;
+  worker_perf_[worker_id] = perf;
+}
+
+// Describes the counts and the derived instructions per cycle and counts per
+// ray, leaving out unavailable events.
+static std::string DescribePerf(const PerfCounters::Values& values,
+                                uint64_t rays) {
+  std::stringstream stream;
+  for (size_t i = 0; i < PerfCounters::kNumEvents; ++i) {
+    if (!values.valid[i]) {
+      continue;
+    }
+    PerfCounters::Event event = static_cast<PerfCounters::Event>(i);
+    stream << PerfCounters::Name(event) << ": " << values.counts[i];
+    if (event != PerfCounters::CYCLES && rays > 0) {
+      stream << " (" << double(values.counts[i]) / rays << " per ray)";
+    }
+    stream << ", ";
+  }
+  const uint64_t cycles = values.counts[PerfCounters::CYCLES];
+  if (values.valid[PerfCounters::INSTRUCTIONS] && cycles > 0) {
+    stream << "IPC: "
+           << double(values.counts[PerfCounters::INSTRUCTIONS]) / cycles;
+  }
+  std::string result = stream.str();
+  if (result.size() >= 2 && result.compare(result.size() - 2, 2, ", ") == 0) {
+    result.resize(result.size() - 2);
+  }
+  return result;
+}
+
+void Renderer::LogPerfCounters() const {
+  WorkerPerf total;
+  for (size_t i = 0; i < worker_perf_.size(); ++i) {
+    total.values += worker_perf_[i].values;
+    total.rays += worker_perf_[i].rays;
+  }
+
+  bool available = false;
+  for (size_t i = 0; i < PerfCounters::kNumEvents; ++i) {
+    available = available || total.values.valid[i];
+  }
+  if (!available) {
+    LOG(WARNING) << "Hardware performance counters are unavailable, e.g., "
+                 << "because of kernel.perf_event_paranoid or a container";
+    return;
+  }
+
+  for (size_t i = 0; i < worker_perf_.size(); ++i) {
+    LOG(INFO) << "Worker " << i << " " << DescribePerf(worker_perf_[i].values,
+                                                      worker_perf_[i].rays);
+  }
+  LOG(INFO) << "All workers " << DescribePerf(total.values, total.rays);
 }
 
 Color3 Renderer::TraceColor(const Ray& ray, size_t depth,
                             std::vector<Scalar>* refraction_stack) {
+  TraceCounters& counters = TraceCounters::ForThisThread();
+  if (depth == 0) {
+    ++counters.primary_rays;
+  } else {
+    ++counters.secondary_rays;
+  }
+
   IntersectionData data(ray);
   if (!scene_->Intersect(ray, &data)) {
     return scene_->background();
   }
+  ++counters.hits;
   if(data.IntersectedLight()) {
     // Direct hit of some light source.
     return data.light()->color();
@@ -196,9 +361,11 @@ Color3 Renderer::TraceColor(const Ray& ray, size_t depth,
   }
 
   Color3 refracted;
-  Scalar refraction_percentage = max(material.refraction_percentage(), 0.0);
+  Scalar refraction_percentage = max(material.refraction_percentage(),
+                                     Scalar(0));
   Color3 reflected;
-  Scalar reflection_percentage = max(material.reflection_percentage(), 0.0);
+  Scalar reflection_percentage = max(material.reflection_percentage(),
+                                     Scalar(0));
 
   if (refraction_percentage > 0) {
     Scalar old_index = refraction_stack->back();
@@ -263,27 +430,64 @@ Color3 Renderer::TraceColor(const Ray& ray, size_t depth,
 // static
 const size_t Renderer::kSleepTimeMilli = 300;
 
+// static
+const size_t Renderer::kPollTimeMilli = 5;
+
 // static
 Renderer* Renderer::FromConfig(const raytracer::RendererConfig& config) {
   Statistics* stats = NULL;
-  if (config.has_sampling_heatmap_path()) {
-    stats = new Statistics(new BmpExporter(config.sampling_heatmap_path()));
+  if (config.has_sampling_heatmap_path() || config.has_statistics_path() ||
+      config.has_kd_tree_heatmap_path() ||
+      config.has_element_tests_heatmap_path() ||
+      config.has_time_heatmap_path()) {
+    BmpExporter* heatmap_exporter = NULL;
+    if (config.has_sampling_heatmap_path()) {
+      heatmap_exporter = new BmpExporter(config.sampling_heatmap_path());
+    }
+    stats = new Statistics(heatmap_exporter, config.statistics_path());
+    stats->set_log_scale(config.heatmap_log_scale());
+    if (config.has_kd_tree_heatmap_path()) {
+      stats->AddCostHeatmap(Statistics::KD_TREE_NODES,
+                            new BmpExporter(config.kd_tree_heatmap_path()));
+    }
+    if (config.has_element_tests_heatmap_path()) {
+      stats->AddCostHeatmap(Statistics::ELEMENT_TESTS, new BmpExporter(
+          config.element_tests_heatmap_path()));
+    }
+    if (config.has_time_heatmap_path()) {
+      stats->AddCostHeatmap(Statistics::NANOSECONDS,
+                            new BmpExporter(config.time_heatmap_path()));
+    }
   }
 
   Sampler* sampler = NULL;
-  if (config.sampler_type() == raytracer::RendererConfig::SCANLINE) {
+  if (config.has_tile()) {
+    const auto& tile = config.tile();
+    sampler = new TileSampler(config.threads() > 1, tile.x(), tile.y(),
+                              tile.width(), tile.height());
+  } else if (config.band_height() > 0) {
+    if (config.sampler_type() != raytracer::RendererConfig::SCANLINE) {
+      LOG(WARNING) << "Streaming bands of rows requires the scanline sampler, "
+                   << "ignoring requested sampler type";
+    }
+    sampler = new ScanlineSampler(config.threads() > 1, config.band_height());
+  } else if (config.sampler_type() == raytracer::RendererConfig::SCANLINE) {
     sampler = new ScanlineSampler(config.threads() > 1);
   } else if (config.sampler_type() == raytracer::RendererConfig::PROGRESSIVE) {
     sampler = new ProgressiveSampler(config.threads() > 1);
   }
   CHECK(sampler != NULL) << "Could not load sampler";
 
-  Shader* shader = new PhongShader(config.shadows());
+  Shader* shader = new PhongShader(config.shadows(), config.light_samples());
   Supersampler* supersampler = new Supersampler(
       config.root_rays_per_pixel(),
       config.adaptive_supersampling_threshold(),
       stats);
 
-  return new Renderer(sampler, supersampler, shader, config.threads(),
-                      config.recursion_depth(), stats);
+  Renderer* renderer = new Renderer(sampler, supersampler, shader,
+                                    config.threads(), config.recursion_depth(),
+                                    stats, PostProcessor::FromConfig(config),
+                                    config.perf_counters());
+  renderer->set_memory_report_path(config.memory_report_path());
+  return renderer;
 }
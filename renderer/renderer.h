@@ -29,11 +29,16 @@
 #define RENDERER_H_
 
 #include<memory>
+#include<mutex>
+#include<string>
 #include<vector>
 
+#include "renderer/trace_counters.h"
 #include "util/color3.h"
 #include "util/no_copy_assign.h"
+#include "util/perf_counters.h"
 
+class PostProcessor;
 class Ray;
 class Sampler;
 class Scene;
@@ -50,9 +55,12 @@ class Renderer {
  public:
   // Takes ownership of all passed pointers. The argument "num_threads"
   // determines the number of worker threads in addition to the monitoring
-  // thread.
+  // thread. The post processor may be NULL. If perf_counters is set, each
+  // worker reads the hardware performance counters while rendering, and they
+  // are logged at the end of every rendering.
   Renderer(Sampler* sampler, Supersampler* supersampler, Shader* shader,
-           size_t num_threads, size_t recursion_depth, Statistics* stats);
+           size_t num_threads, size_t recursion_depth, Statistics* stats,
+           PostProcessor* post_processor = NULL, bool perf_counters = false);
   virtual ~Renderer();
   NO_COPY_ASSIGN(Renderer);
 
@@ -70,11 +78,23 @@ class Renderer {
   bool HasStatistics() const { return statistics_.get() != NULL; }
   const Statistics& statistics() const { return *statistics_; }
 
+  // Returns the counters summed over all workers of the last call to Render.
+  const TraceCounters& trace_counters() const { return trace_counters_; }
+
+  // If not empty, the memory report of the scene and the sampler is written to
+  // this path as JSON at the start of every rendering.
+  void set_memory_report_path(const std::string& path) {
+    memory_report_path_ = path;
+  }
+
  private:
   // Serves as the method passed to threads. It contains the rendering loop
   // which consists of fetching samples, tracing them, and putting them back.
   void WorkerMain(size_t worker_id);
 
+  // Logs the hardware performance counters of each worker and in total.
+  void LogPerfCounters() const;
+
   // Traces the color of the provided ray in the scene. The argument depth
   // indicates the current depth of the recursion.
   Color3 TraceColor(const Ray& ray, size_t depth,
@@ -96,8 +116,29 @@ class Renderer {
 
   std::unique_ptr<Statistics> statistics_;
 
-  // The sleep time for the monitor thread.
+  // Applied to the image, or to each band of it, before the listeners see it.
+  std::unique_ptr<PostProcessor> post_processor_;
+
+  std::string memory_report_path_;
+
+  // The hardware counters and the number of rays of a single worker.
+  struct WorkerPerf {
+    WorkerPerf() : rays(0) {}
+    PerfCounters::Values values;
+    uint64_t rays;
+  };
+
+  // Workers add their counters to these when they terminate.
+  TraceCounters trace_counters_;
+  bool perf_counters_;
+  std::vector<WorkerPerf> worker_perf_;
+  std::mutex trace_counters_mutex_;
+
+  // The time between two updates of the listeners by the monitor thread.
   static const size_t kSleepTimeMilli;
+
+  // How often the monitor thread checks whether rendering has finished.
+  static const size_t kPollTimeMilli;
 };
 
 #endif  /* RENDERER_H_ */
@@ -51,6 +51,17 @@ void ProgressiveSampler::Init(size_t resolution_x, size_t resolution_y) {
       std::vector<int>(height(), -(current_size_ * current_size_ + 1)));
 }
 
+void ProgressiveSampler::AddMemoryUsage(MemoryReport* report) const {
+  Sampler::AddMemoryUsage(report);
+  size_t bytes = priority_map_.capacity() * sizeof(priority_map_[0]);
+  size_t count = 0;
+  for (auto it = priority_map_.begin(); it != priority_map_.end(); ++it) {
+    bytes += it->capacity() * sizeof(int);
+    count += it->size();
+  }
+  report->Add("priority_map", bytes, count);
+}
+
 bool ProgressiveSampler::InternalNextSample(Sample* sample) {
   bool result = false;
   if (current_size_ > 0) {
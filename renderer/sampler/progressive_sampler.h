@@ -45,6 +45,7 @@ class ProgressiveSampler : public Sampler {
   virtual size_t MaxJobSize() const { return kJobSize; }
   virtual size_t NextJob(std::vector<Sample>* samples);
   virtual void AcceptJob(const std::vector<Sample>& samples, size_t n);
+  virtual void AddMemoryUsage(MemoryReport* report) const;
 
  private:
   // Helper method which fetches the next sample. Returns true if the new sample
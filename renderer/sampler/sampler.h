@@ -36,22 +36,20 @@
 #include <mutex>
 
 #include "renderer/image.h"
+#include "util/memory_report.h"
 
 class Image;
 class Sample;
 
 class Sampler {
  public:
-  Sampler(bool thread_safe) : thread_safe_(thread_safe) {}
+  Sampler(bool thread_safe)
+      : accepted_(0), width_(0), height_(0), thread_safe_(thread_safe) {}
   virtual ~Sampler() {};
 
   // Prepares for generating samples for a given resolution.
   virtual void Init(size_t resolution_x, size_t resolution_y) {
-    if (resolution_x == 0 || resolution_y == 0) {
-      LOG(WARNING) << "Initializing sampler with 0 resolution.";
-    }
-    image_.reset(new Image(resolution_x, resolution_y));
-    accepted_ = 0;
+    Reset(resolution_x, resolution_y, new Image(resolution_x, resolution_y));
   }
 
   // Returns the maximum size of a rendering job provided by NextJob.
@@ -65,17 +63,53 @@ class Sampler {
   // Writes the colors of the first n elements of "samples" into the image.
   virtual void AcceptJob(const std::vector<Sample>& samples, size_t n) = 0;
 
+  // Writes all pixels of "tile" into the image such that the bottom left pixel
+  // of the tile ends up at (x, y). Used to merge tiles rendered elsewhere.
+  void AcceptTile(const Image& tile, size_t x, size_t y) {
+    for (size_t tile_y = 0; tile_y < tile.SizeY(); ++tile_y) {
+      for (size_t tile_x = 0; tile_x < tile.SizeX(); ++tile_x) {
+        image_->PutPixel(tile.PixelAt(tile_x, tile_y), x + tile_x, y + tile_y);
+      }
+    }
+
+    // Only lock here because the code above is thread-safe.
+    std::unique_lock<std::mutex> guard;
+    if (IsThreadSafe()) {
+      guard = std::move(std::unique_lock<std::mutex>(lock_));
+    }
+    IncrementAccepted(tile.SizeX() * tile.SizeY());
+  }
+
+  // Moves a band of completed rows out of the sampler, if one is ready, and
+  // stores the index of its bottom row in "y". Only samplers which do not keep
+  // the full image in memory produce bands.
+  virtual bool PopCompletedBand(std::unique_ptr<Image>* band, size_t* y) {
+    return false;
+  }
+
   // Returns whether the sampler is prepared to handle multiple threads calling
   // its methods concurrently.
   virtual bool IsThreadSafe() const { return thread_safe_; }
 
+  // Adds the image and any other per-pixel data of the sampler to report.
+  virtual void AddMemoryUsage(MemoryReport* report) const {
+    if (image_.get() != NULL) {
+      report->Add("sampler_image", image_->ByteSize(),
+                  image_->SizeX() * image_->SizeY());
+    }
+  }
+
+  // Samplers which hand out bands of completed rows return an empty image.
   const Image& image() const { return *image_; }
-  size_t width() const { return image_.get() == NULL ? 0 : image_->SizeX(); }
-  size_t height() const { return image_.get() == NULL ? 0 : image_->SizeY(); }
+  Image* mutable_image() { return image_.get(); }
+
+  // The resolution of the rendering.
+  size_t width() const { return width_; }
+  size_t height() const { return height_; }
 
   // Returns the progress of the rendering as value in [0, 1].
   virtual double Progress() const {
-    size_t total_size = image().SizeX() * image_->SizeY();
+    size_t total_size = width_ * height_;
     if (total_size == 0) {
       return 1;
     }
@@ -89,12 +123,26 @@ class Sampler {
   // Intended for use by children indicating that samples have been returned.
   void IncrementAccepted(size_t samples) { accepted_ += samples; }
 
+  // Starts a new rendering with the passed resolution, storing the samples in
+  // image. Takes ownership of image.
+  void Reset(size_t resolution_x, size_t resolution_y, Image* image) {
+    if (resolution_x == 0 || resolution_y == 0) {
+      LOG(WARNING) << "Initializing sampler with 0 resolution.";
+    }
+    width_ = resolution_x;
+    height_ = resolution_y;
+    image_.reset(image);
+    accepted_ = 0;
+  }
+
   // Protected to allow children to modify it.
   std::unique_ptr<Image> image_;
   std::mutex lock_;
 
  private:
   size_t accepted_;
+  size_t width_;
+  size_t height_;
   bool thread_safe_;
 };
 
@@ -26,17 +26,38 @@
 
 #include "scanline_sampler.h"
 
+#include <algorithm>
+#include <glog/logging.h>
+
 #include "renderer/sampler/sample.h"
 #include "scene/camera.h"
 
-ScanlineSampler::ScanlineSampler(bool thread_safe) : Sampler(thread_safe) {
+struct ScanlineSampler::Band {
+  Band(size_t width, size_t height)
+      : image(new Image(width, height)), missing(width * height) {
+  }
+
+  std::unique_ptr<Image> image;
+
+  // The number of pixels of the band not yet accepted.
+  size_t missing;
+};
+
+ScanlineSampler::ScanlineSampler(bool thread_safe, size_t band_height)
+    : Sampler(thread_safe), band_height_(band_height) {
 }
 
 ScanlineSampler::~ScanlineSampler() {
 }
 
 void ScanlineSampler::Init(size_t resolution_x, size_t resolution_y) {
-  Sampler::Init(resolution_x, resolution_y);
+  if (band_height_ > 0) {
+    Reset(resolution_x, resolution_y, new Image(0, 0));
+  } else {
+    Sampler::Init(resolution_x, resolution_y);
+  }
+  open_bands_.clear();
+  completed_bands_.clear();
   current_x_ = 0;
   current_y_ = 0;
 }
@@ -51,6 +72,13 @@ bool ScanlineSampler::InternalNextSample(Sample* sample) {
     return false;
   }
 
+  // Bands are allocated lazily, so only the bands currently being rendered are
+  // held in memory.
+  if (band_height_ > 0 && current_x_ == 0 && current_y_ % band_height_ == 0) {
+    size_t rows = std::min(band_height_, height() - current_y_);
+    open_bands_[current_y_ / band_height_].reset(new Band(width(), rows));
+  }
+
   sample->set_color(Color3(0, 0, 0));
   sample->set_x(current_x_++);
   sample->set_y(current_y_);
@@ -76,6 +104,19 @@ size_t ScanlineSampler::NextJob(std::vector<Sample>* samples) {
 }
 
 void ScanlineSampler::AcceptJob(const std::vector<Sample>& samples, size_t n) {
+  if (band_height_ > 0) {
+    // The bands are shared between threads, so hold the lock while writing.
+    std::unique_lock<std::mutex> guard;
+    if (IsThreadSafe()) {
+      guard = std::move(std::unique_lock<std::mutex>(lock_));
+    }
+    for (size_t i = 0; i < n; ++i) {
+      AcceptIntoBand(samples[i]);
+    }
+    IncrementAccepted(n);
+    return;
+  }
+
   for (size_t i = 0; i < n; ++i) {
     // The point (0, 0) in sample space is at the bottom left corner. However, in
     // image space, (0, 0) represents the top left corner. Therefore, we must flip
@@ -92,6 +133,40 @@ void ScanlineSampler::AcceptJob(const std::vector<Sample>& samples, size_t n) {
   IncrementAccepted(n);
 }
 
+bool ScanlineSampler::PopCompletedBand(std::unique_ptr<Image>* band,
+                                       size_t* y) {
+  std::unique_lock<std::mutex> guard;
+  if (IsThreadSafe()) {
+    guard = std::move(std::unique_lock<std::mutex>(lock_));
+  }
+  if (completed_bands_.empty()) {
+    return false;
+  }
+  *y = completed_bands_.front().first;
+  *band = std::move(completed_bands_.front().second);
+  completed_bands_.pop_front();
+  return true;
+}
+
+void ScanlineSampler::AcceptIntoBand(const Sample& sample) {
+  const size_t index = sample.y() / band_height_;
+  auto it = open_bands_.find(index);
+  if (it == open_bands_.end()) {
+    LOG(WARNING) << "Accepted sample [" << sample.x() << ", " << sample.y()
+                 << "] outside of any open band";
+    return;
+  }
+
+  Band* band = it->second.get();
+  const size_t bottom = index * band_height_;
+  band->image->PutPixel(sample.color(), sample.x(), sample.y() - bottom);
+  if (--band->missing == 0) {
+    completed_bands_.push_back(
+        std::make_pair(bottom, std::move(band->image)));
+    open_bands_.erase(it);
+  }
+}
+
 // static
 // TODO(dinow): Figure out a decent job size by benchmarking.
 const size_t ScanlineSampler::kJobSize = 8;
@@ -28,7 +28,11 @@
 #ifndef SCANLINE_SAMPLER_H_
 #define SCANLINE_SAMPLER_H_
 
+#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <utility>
 
 #include "renderer/sampler/sampler.h"
 #include "util/no_copy_assign.h"
@@ -38,7 +42,10 @@ class Sample;
 
 class ScanlineSampler : public Sampler {
  public:
-  ScanlineSampler(bool thread_safe);
+  // If band_height is positive, the full image is never held in memory.
+  // Instead, pixels are collected in bands of band_height rows which are handed
+  // out through PopCompletedBand() as soon as all their pixels are accepted.
+  ScanlineSampler(bool thread_safe, size_t band_height = 0);
   virtual ~ScanlineSampler();
   NO_COPY_ASSIGN(ScanlineSampler);
 
@@ -48,8 +55,16 @@ class ScanlineSampler : public Sampler {
   virtual size_t MaxJobSize() const { return kJobSize; }
   virtual size_t NextJob(std::vector<Sample>* samples);
   virtual void AcceptJob(const std::vector<Sample>& samples, size_t n);
+  virtual bool PopCompletedBand(std::unique_ptr<Image>* band, size_t* y);
 
  private:
+  // A band of rows which still has pixels in flight.
+  struct Band;
+
+  // Stores the sample in the band containing it. Moves the band to the queue
+  // of completed bands if this was its last missing pixel.
+  void AcceptIntoBand(const Sample& sample);
+
   // Helper method which fetches the next sample. Returns true if the new sample
   // was successfully stored in sample, and false if there are no samples left.
   bool InternalNextSample(Sample* sample);
@@ -58,6 +73,15 @@ class ScanlineSampler : public Sampler {
   size_t current_x_;
   size_t current_y_;
 
+  // The number of rows per band, or 0 if the full image is kept instead.
+  const size_t band_height_;
+
+  // The bands which have been handed out partially, keyed by band index.
+  std::map<size_t, std::unique_ptr<Band>> open_bands_;
+
+  // Completed bands along with the index of their bottom row.
+  std::deque<std::pair<size_t, std::unique_ptr<Image>>> completed_bands_;
+
   static const size_t kJobSize;
 };
 
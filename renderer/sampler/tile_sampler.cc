@@ -0,0 +1,91 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Author: Dino Wernli
+ */
+
+#include "tile_sampler.h"
+
+#include <algorithm>
+
+#include "renderer/sampler/sample.h"
+
+TileSampler::TileSampler(bool thread_safe, size_t x, size_t y, size_t width,
+                         size_t height)
+    : Sampler(thread_safe), x_(x), y_(y), width_(width), height_(height) {
+}
+
+TileSampler::~TileSampler() {
+}
+
+void TileSampler::Init(size_t resolution_x, size_t resolution_y) {
+  const size_t width = x_ < resolution_x ?
+      std::min(width_, resolution_x - x_) : 0;
+  const size_t height = y_ < resolution_y ?
+      std::min(height_, resolution_y - y_) : 0;
+  Sampler::Init(width, height);
+  current_x_ = 0;
+  current_y_ = 0;
+}
+
+size_t TileSampler::NextJob(std::vector<Sample>* samples) {
+  std::unique_lock<std::mutex> guard;
+  if (IsThreadSafe()) {
+    guard = std::move(std::unique_lock<std::mutex>(lock_));
+  }
+
+  size_t jobs_added = 0;
+  while (jobs_added < kJobSize) {
+    if (current_x_ >= width()) {
+      current_x_ = 0;
+      ++current_y_;
+    }
+    if (current_y_ >= height()) {
+      break;
+    }
+
+    // Samples are in the coordinates of the full image, which is what the
+    // camera expects.
+    Sample& sample = samples->at(jobs_added++);
+    sample.set_color(Color3(0, 0, 0));
+    sample.set_x(x_ + current_x_++);
+    sample.set_y(y_ + current_y_);
+  }
+  return jobs_added;
+}
+
+void TileSampler::AcceptJob(const std::vector<Sample>& samples, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const Sample& sample = samples[i];
+    image_->PutPixel(sample.color(), sample.x() - x_, sample.y() - y_);
+  }
+
+  // Only lock here because the code above is thread-safe.
+  std::unique_lock<std::mutex> guard;
+  if (IsThreadSafe()) {
+    guard = std::move(std::unique_lock<std::mutex>(lock_));
+  }
+  IncrementAccepted(n);
+}
+
+// static
+const size_t TileSampler::kJobSize = 8;
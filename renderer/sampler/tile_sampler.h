@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * A sampler which samples the pixels of a rectangular tile of the image in
+ * linear order. The resulting image only contains the tile.
+ * Author: Dino Wernli
+ */
+
+#ifndef TILE_SAMPLER_H_
+#define TILE_SAMPLER_H_
+
+#include "renderer/sampler/sampler.h"
+#include "util/no_copy_assign.h"
+
+class Sample;
+
+class TileSampler : public Sampler {
+ public:
+  // The tile has its bottom left pixel at (x, y). It is clipped to the
+  // resolution passed to Init().
+  TileSampler(bool thread_safe, size_t x, size_t y, size_t width,
+              size_t height);
+  virtual ~TileSampler();
+  NO_COPY_ASSIGN(TileSampler);
+
+  // Not made thread safe, expected to be called only once.
+  virtual void Init(size_t resolution_x, size_t resolution_y);
+
+  virtual size_t MaxJobSize() const { return kJobSize; }
+  virtual size_t NextJob(std::vector<Sample>* samples);
+  virtual void AcceptJob(const std::vector<Sample>& samples, size_t n);
+
+ private:
+  // The position of the tile in the full image.
+  const size_t x_;
+  const size_t y_;
+  const size_t width_;
+  const size_t height_;
+
+  // Iteration variables, relative to the tile.
+  size_t current_x_;
+  size_t current_y_;
+
+  static const size_t kJobSize;
+};
+
+#endif  /* TILE_SAMPLER_H_ */
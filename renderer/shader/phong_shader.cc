@@ -31,11 +31,22 @@
 #include <memory>
 
 #include "renderer/intersection_data.h"
-#include "scene/light/point_light.h"
+#include "renderer/trace_counters.h"
+#include "scene/light/light.h"
+#include "scene/light/light_tree.h"
 #include "scene/material.h"
 #include "scene/scene.h"
+#include "util/random.h"
 
-PhongShader::PhongShader(bool shadows) : shadows_(shadows) {
+// The shader is shared between worker threads, so each thread gets its own
+// random number generator.
+static Random& ThreadRandom() {
+  static thread_local Random random;
+  return random;
+}
+
+PhongShader::PhongShader(bool shadows, size_t light_samples)
+    : shadows_(shadows), light_samples_(light_samples) {
 }
 
 PhongShader::~PhongShader() {
@@ -48,50 +59,103 @@ Color3 PhongShader::Shade(const IntersectionData& data, const Scene& scene) {
   Color3 diffuse(0, 0, 0);
   Color3 specular(0, 0, 0);
 
-  const std::vector<std::unique_ptr<Light>>& lights = scene.lights();
-  for (auto it = lights.begin(); it != lights.end(); ++it) {
-    const Light* light = it->get();
-    Ray light_ray = light->GenerateRay(data.position);
-
-    // Ignore the contribution from this light if it is occluded. Note that even
-    // occlusion by another light counts as occlusion because all lights are
-    // considered, therefore the other light will get its turn as well.
-    if (shadows_ && scene.Intersect(light_ray)) {
-      continue;
+  if (light_samples_ == 0) {
+    const std::vector<std::unique_ptr<Light>>& lights = scene.lights();
+    for (auto it = lights.begin(); it != lights.end(); ++it) {
+      ShadeLight(*it->get(), 1, data, scene, &diffuse, &specular);
     }
+  } else {
+    const LightTree& light_tree = scene.light_tree();
+    for (size_t i = 0; i < light_samples_; ++i) {
+      Scalar pdf;
+      const Light* light = light_tree.Sample(data.position,
+                                             ThreadRandom().Get(0, 1), &pdf);
+      if (light == NULL || pdf <= 0) {
+        continue;
+      }
+      ShadeLight(*light, 1.0 / (light_samples_ * pdf), data, scene, &diffuse,
+                 &specular);
+    }
+  }
+  return (emission + ambient + diffuse + specular).Clamped();
+}
+
+void PhongShader::ShadeLight(const Light& light, Scalar weight,
+                             const IntersectionData& data, const Scene& scene,
+                             Color3* diffuse, Color3* specular) const {
+  const size_t n = light.shadow_samples();
+  if (n <= 1) {
+    ShadeRay(light, light.GenerateRay(data.position), weight, data, scene,
+             diffuse, specular);
+    return;
+  }
+
+  // Stratify the first sample dimension into n intervals. The second dimension
+  // follows a randomly shifted golden ratio sequence, which spreads the samples
+  // evenly for any n while keeping each sample uniformly distributed.
+  Random& random = ThreadRandom();
+  Scalar v = random.Get(0, 1);
+  for (size_t i = 0; i < n; ++i) {
+    Scalar u = (i + random.Get(0, 1)) / n;
+    v += kGoldenRatioConjugate;
+    v -= floor(v);
+    ShadeRay(light, light.SampleRay(data.position, u, v), weight / n, data,
+             scene, diffuse, specular);
+  }
+}
 
-    Vector3 point_to_light = -1 * light_ray.direction();
-    const Point3& cam_pos = scene.camera().position();
-    Vector3 point_to_camera = data.position.VectorTo(cam_pos).Normalized();
-    Vector3 normal = data.normal.Normalized();
-    Scalar prod = point_to_light.Dot(normal);
+void PhongShader::ShadeRay(const Light& light, const Ray& light_ray,
+                           Scalar weight, const IntersectionData& data,
+                           const Scene& scene, Color3* diffuse,
+                           Color3* specular) const {
+  const Material& material = *data.material;
 
-    // Flip normal if the light is inside the element.
-    if (prod < 0) {
-      normal = -normal;
+  // Ignore the contribution from this ray if it is occluded. Note that even
+  // occlusion by another light counts as occlusion because the other light
+  // gets its own chance to contribute.
+  if (shadows_) {
+    TraceCounters& counters = TraceCounters::ForThisThread();
+    ++counters.shadow_rays;
+    if (scene.Intersect(light_ray)) {
+      ++counters.hits;
+      ++counters.shadow_early_outs;
+      return;
     }
+  }
 
-    // Clamping seems to be necessary, otherwise some images get dark.
-    Color3 diff = material.diffuse(data) * light->color();
-    diffuse += (diff * prod).Clamped();
+  Vector3 point_to_light = -1 * light_ray.direction();
+  const Point3& cam_pos = scene.camera().position();
+  Vector3 point_to_camera = data.position.VectorTo(cam_pos).Normalized();
+  Vector3 normal = data.normal.Normalized();
+  Scalar prod = point_to_light.Dot(normal);
 
-    // Add specular contribution.
-    Color3 spec = material.specular(data) * light->color();
-    Vector3 reflection = (-point_to_light).ReflectedOnPlane(normal);
+  // Flip normal if the light is inside the element.
+  if (prod < 0) {
+    normal = -normal;
+  }
 
-    // Flip reflection if the camera is not on the same side of the element as
-    // the light.
-    if (prod < 0) {
-      reflection = -reflection;
-    }
+  // Clamping seems to be necessary, otherwise some images get dark.
+  Color3 diff = material.diffuse(data) * light.color();
+  *diffuse += weight * (diff * prod).Clamped();
 
-    // Prevent cosine from turning positive through exponentiation.
-    Scalar cosine = reflection.Dot(point_to_camera);
-    cosine = cosine < 0 ? 0 : cosine;
-    cosine = cosine > 1 ? 1 : cosine;
+  // Add specular contribution.
+  Color3 spec = material.specular(data) * light.color();
+  Vector3 reflection = (-point_to_light).ReflectedOnPlane(normal);
 
-    // Again, clamping seems to be necessary, otherwise some images get dark.
-    specular += (spec * pow(cosine, material.shininess())).Clamped();
+  // Flip reflection if the camera is not on the same side of the element as
+  // the light.
+  if (prod < 0) {
+    reflection = -reflection;
   }
-  return (emission + ambient + diffuse + specular).Clamped();
+
+  // Prevent cosine from turning positive through exponentiation.
+  Scalar cosine = reflection.Dot(point_to_camera);
+  cosine = cosine < 0 ? 0 : cosine;
+  cosine = cosine > 1 ? 1 : cosine;
+
+  // Again, clamping seems to be necessary, otherwise some images get dark.
+  *specular += weight * (spec * pow(cosine, material.shininess())).Clamped();
 }
+
+// static
+const Scalar PhongShader::kGoldenRatioConjugate = 0.6180339887498949;
@@ -28,19 +28,44 @@
 #ifndef PHONG_SHADER_H_
 #define PHONG_SHADER_H_
 
+#include <cstddef>
+
 #include "renderer/shader/shader.h"
 #include "util/no_copy_assign.h"
 
+class Light;
+class Ray;
+
 class PhongShader : public Shader {
  public:
-  PhongShader(bool shadows = true);
+  // If light_samples is 0, all lights are evaluated at every shading point.
+  // Otherwise, exactly light_samples lights are picked from the light tree of
+  // the scene and their contributions are weighted accordingly.
+  PhongShader(bool shadows = true, size_t light_samples = 0);
   virtual ~PhongShader();
   NO_COPY_ASSIGN(PhongShader);
 
   virtual Color3 Shade(const IntersectionData& data, const Scene& scene);
 
  private:
+  // Adds the contribution of a single light, multiplied by weight, to the
+  // diffuse and specular sums. Traces as many shadow rays as requested by the
+  // light.
+  void ShadeLight(const Light& light, Scalar weight,
+                  const IntersectionData& data, const Scene& scene,
+                  Color3* diffuse, Color3* specular) const;
+
+  // Adds the contribution of a single ray of light, multiplied by weight, to
+  // the diffuse and specular sums.
+  void ShadeRay(const Light& light, const Ray& light_ray, Scalar weight,
+                const IntersectionData& data, const Scene& scene,
+                Color3* diffuse, Color3* specular) const;
+
+  // Used to spread the second dimension of stratified light samples.
+  static const Scalar kGoldenRatioConjugate;
+
   bool shadows_;
+  size_t light_samples_;
 };
 
 #endif  /* PHONG_SHADER_H_ */
@@ -0,0 +1,155 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "renderer/statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <glog/logging.h>
+#include <sstream>
+
+#include "listener/bmp_exporter.h"
+
+Statistics::Statistics(BmpExporter* sampling_heatmap_exporter,
+                       const std::string& counters_path)
+    : sampling_heatmap_exporter_(sampling_heatmap_exporter),
+      counters_path_(counters_path), log_scale_(false) {
+}
+
+Statistics::~Statistics() {
+}
+
+void Statistics::Init(size_t width, size_t height) {
+  LOG(INFO) << "Initializing statistics";
+  if (sampling_heatmap_exporter_.get() != NULL) {
+    sampling_heatmap_.reset(new Image(width, height));
+  }
+  for (size_t i = 0; i < kNumCostTypes; ++i) {
+    if (cost_heatmap_exporters_[i].get() != NULL) {
+      cost_heatmaps_[i].reset(new Image(width, height));
+    }
+  }
+  trace_counters_ = TraceCounters();
+}
+
+void Statistics::AddCostHeatmap(CostType type, BmpExporter* exporter) {
+  cost_heatmap_exporters_[type].reset(exporter);
+}
+
+bool Statistics::HasCostHeatmaps() const {
+  for (size_t i = 0; i < kNumCostTypes; ++i) {
+    if (cost_heatmap_exporters_[i].get() != NULL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Statistics::Export() const {
+  if (sampling_heatmap_.get() != NULL) {
+    // Sampler just stored number of rays per pixel. Normalize.
+    Normalize(sampling_heatmap_.get());
+    sampling_heatmap_exporter_->Export(*sampling_heatmap_);
+  }
+
+  for (size_t i = 0; i < kNumCostTypes; ++i) {
+    Image* heatmap = cost_heatmaps_[i].get();
+    if (heatmap == NULL) {
+      continue;
+    }
+    Normalize(heatmap);
+
+    // All channels hold the same value, and rows never split a pixel.
+    heatmap->Transform([](Intensity* values, size_t n) {
+      for (size_t j = 0; j + 2 < n; j += 3) {
+        Color3 color = FalseColor(values[j]);
+        values[j] = color.r();
+        values[j + 1] = color.g();
+        values[j + 2] = color.b();
+      }
+    });
+    cost_heatmap_exporters_[i]->Export(*heatmap);
+  }
+
+  if (!counters_path_.empty()) {
+    std::ofstream file(counters_path_.c_str());
+    file << ToJson(trace_counters_);
+    if (!file) {
+      LOG(ERROR) << "Failed to write trace counters to: " << counters_path_;
+    }
+  }
+}
+
+void Statistics::Normalize(Image* heatmap) const {
+  if (log_scale_) {
+    heatmap->Transform([](Intensity* values, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        values[i] = std::log1p(values[i]);
+      }
+    });
+  }
+  Intensity maximum = heatmap->MaxIntensity();
+  if (maximum != 0) {
+    heatmap->Scale(1.0 / maximum);
+  }
+}
+
+// static
+Color3 Statistics::FalseColor(Intensity value) {
+  // Blue, cyan, green, yellow and red at equal distances.
+  static const Color3 kRamp[] = {
+    Color3(0, 0, 1), Color3(0, 1, 1), Color3(0, 1, 0), Color3(1, 1, 0),
+    Color3(1, 0, 0),
+  };
+  static const size_t kSegments = sizeof(kRamp) / sizeof(kRamp[0]) - 1;
+
+  Intensity position = std::min(std::max(value, Intensity(0)), Intensity(1))
+                       * kSegments;
+  size_t segment = std::min(size_t(position), kSegments - 1);
+  Scalar fraction = position - segment;
+  return (1 - fraction) * kRamp[segment] + fraction * kRamp[segment + 1];
+}
+
+// static
+std::string Statistics::ToJson(const TraceCounters& counters) {
+  std::stringstream stream;
+  stream << "{\n"
+         << "  \"primary_rays\": " << counters.primary_rays << ",\n"
+         << "  \"shadow_rays\": " << counters.shadow_rays << ",\n"
+         << "  \"secondary_rays\": " << counters.secondary_rays << ",\n"
+         << "  \"total_rays\": " << counters.total_rays() << ",\n"
+         << "  \"hits\": " << counters.hits << ",\n"
+         << "  \"shadow_early_outs\": " << counters.shadow_early_outs << ",\n"
+         << "  \"kd_tree_nodes_visited\": " << counters.kd_tree_nodes_visited
+         << ",\n"
+         << "  \"leaf_element_tests\": " << counters.leaf_element_tests << "\n"
+         << "}\n";
+  return stream.str();
+}
+
+// static
+const size_t Statistics::kNumCostTypes;
@@ -28,38 +28,81 @@
 #ifndef STATISTICS_H_
 #define STATISTICS_H_
 
-#include <glog/logging.h>
 #include <memory>
+#include <string>
 
-#include "listener/bmp_exporter.h"
 #include "renderer/image.h"
+#include "renderer/trace_counters.h"
+
+class BmpExporter;
 
 class Statistics {
  public:
-  // Takes ownership of the heatmap exporter.
-  Statistics(BmpExporter* sampling_heatmap_exporter) {
-    sampling_heatmap_exporter_.reset(sampling_heatmap_exporter);
-  }
+  // The kinds of work of which a heatmap can be recorded per pixel.
+  enum CostType {
+    KD_TREE_NODES = 0,
+    ELEMENT_TESTS = 1,
+    NANOSECONDS = 2,
+  };
+  static const size_t kNumCostTypes = 3;
 
-  void Init(size_t width, size_t height) {
-    LOG(INFO) << "Initializing statistics";
-    sampling_heatmap_.reset(new Image(width, height));
-  }
+  // Takes ownership of the heatmap exporter. If it is NULL, no sampling heatmap
+  // is recorded. If counters_path is not empty, the trace counters are written
+  // to that file as JSON.
+  Statistics(BmpExporter* sampling_heatmap_exporter,
+             const std::string& counters_path = "");
+  ~Statistics();
+
+  void Init(size_t width, size_t height);
+  void Export() const;
+
+  // Returns NULL if no heatmap is recorded.
+  Image* sampling_heatmap() const { return sampling_heatmap_.get(); }
+
+  // Records a heatmap of the cost of each pixel, which is exported with the
+  // passed exporter using a false-color ramp from blue (cheap) to red
+  // (expensive). Takes ownership of the exporter. Must be called before Init.
+  void AddCostHeatmap(CostType type, BmpExporter* exporter);
+  bool HasCostHeatmaps() const;
 
-  void Export() const {
-    // Sampler just stored number of rays per pixel. Normalize.
-    Intensity maximum = sampling_heatmap_->MaxIntensity();
-    if (maximum != 0) {
-      sampling_heatmap_->Scale(1.0 / maximum);
+  // Adds cost to pixel (x, y) of the heatmap of type, if it is recorded. May be
+  // called concurrently for distinct pixels.
+  void AddCost(CostType type, size_t x, size_t y, Intensity cost) {
+    Image* heatmap = cost_heatmaps_[type].get();
+    if (heatmap != NULL) {
+      heatmap->PutPixel(heatmap->PixelAt(x, y) + Color3(cost, cost, cost), x,
+                        y);
     }
-    sampling_heatmap_exporter_->Export(*sampling_heatmap_);
   }
 
-  Image* sampling_heatmap() const { return sampling_heatmap_.get(); }
+  // If set, all heatmaps are exported on a logarithmic scale, which keeps
+  // cheap regions distinguishable next to a few very expensive pixels.
+  void set_log_scale(bool log_scale) { log_scale_ = log_scale; }
+
+  // Stores the counters summed over all workers of a rendering.
+  void set_trace_counters(const TraceCounters& counters) {
+    trace_counters_ = counters;
+  }
+  const TraceCounters& trace_counters() const { return trace_counters_; }
+
+  // Writes the counters as a flat JSON object.
+  static std::string ToJson(const TraceCounters& counters);
+
+  // Returns the color of the ramp used by cost heatmaps at value in [0, 1].
+  static Color3 FalseColor(Intensity value);
 
  private:
+  // Scales the heatmap such that its maximum is 1, logarithmically if
+  // log_scale_ is set.
+  void Normalize(Image* heatmap) const;
+
   std::unique_ptr<BmpExporter> sampling_heatmap_exporter_;
   std::unique_ptr<Image> sampling_heatmap_;
+  std::unique_ptr<BmpExporter> cost_heatmap_exporters_[kNumCostTypes];
+  std::unique_ptr<Image> cost_heatmaps_[kNumCostTypes];
+  const std::string counters_path_;
+  bool log_scale_;
+  TraceCounters trace_counters_;
 };
 
 #endif  /* STATISTICS_H_ */
@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Counts the work done while tracing. Every thread accumulates into its own
+ * instance, so counting needs no synchronization. The renderer adds up the
+ * counters of its workers once they have terminated.
+ * Author: Dino Wernli
+ */
+
+#ifndef TRACE_COUNTERS_H_
+#define TRACE_COUNTERS_H_
+
+#include <cstdint>
+
+struct TraceCounters {
+  TraceCounters()
+      : primary_rays(0), shadow_rays(0), secondary_rays(0), hits(0),
+        shadow_early_outs(0), kd_tree_nodes_visited(0),
+        leaf_element_tests(0) {}
+
+  // Returns the counters of the calling thread.
+  static TraceCounters& ForThisThread() {
+    static thread_local TraceCounters counters;
+    return counters;
+  }
+
+  uint64_t total_rays() const {
+    return primary_rays + shadow_rays + secondary_rays;
+  }
+
+  TraceCounters& operator+=(const TraceCounters& other) {
+    primary_rays += other.primary_rays;
+    shadow_rays += other.shadow_rays;
+    secondary_rays += other.secondary_rays;
+    hits += other.hits;
+    shadow_early_outs += other.shadow_early_outs;
+    kd_tree_nodes_visited += other.kd_tree_nodes_visited;
+    leaf_element_tests += other.leaf_element_tests;
+    return *this;
+  }
+
+  // Rays leaving the camera.
+  uint64_t primary_rays;
+
+  // Rays from a shading point towards a light, traced to detect occlusion.
+  uint64_t shadow_rays;
+
+  // Reflected and refracted rays.
+  uint64_t secondary_rays;
+
+  // Rays of any type which intersected the scene.
+  uint64_t hits;
+
+  // Shadow rays which stopped at the first occluder found.
+  uint64_t shadow_early_outs;
+
+  // Inner nodes and leaves of the KdTree entered during traversal.
+  uint64_t kd_tree_nodes_visited;
+
+  // Intersection tests against the elements in KdTree leaves.
+  uint64_t leaf_element_tests;
+};
+
+#endif  /* TRACE_COUNTERS_H_ */
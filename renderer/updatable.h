@@ -28,6 +28,9 @@
 #ifndef UPDATABLE_H_
 #define UPDATABLE_H_
 
+#include <cstddef>
+
+class Image;
 class Sampler;
 
 class Updatable {
@@ -35,6 +38,12 @@ class Updatable {
   virtual ~Updatable() { };
   virtual void Started(const Sampler& sampler) {}
   virtual void Updated(const Sampler& sampler) {}
+
+  // Called by the worker threads, possibly concurrently, whenever the sampler
+  // has completed a band of rows. The entry (0, 0) of band is the pixel
+  // (0, y) of the full image.
+  virtual void RowsCompleted(const Sampler& sampler, const Image& band,
+                             size_t y) {}
   virtual void Ended(const Sampler& sampler) {}
 };
 
@@ -32,6 +32,7 @@
 #include <memory>
 
 #include "util/bounding_box.h"
+#include "util/no_copy_assign.h"
 
 class IntersectionData;
 class Material;
@@ -39,7 +40,18 @@ class Ray;
 
 class Element {
  public:
+  // The concrete types of elements which a GeometryStore intersects without
+  // virtual calls.
+  enum Type {
+    TRIANGLE = 0,
+    SPHERE = 1,
+    PLANE = 2,
+    CIRCLE_PLANE = 3,
+    OTHER = 4,
+  };
+
   virtual ~Element() {}
+  NO_COPY_ASSIGN(Element);
 
   // Returns whether the ray intersects this element. If this returns true and
   // data != NULL, information about the first intersection is stored in data.
@@ -47,20 +59,41 @@ class Element {
                          IntersectionData* data = NULL) const = 0;
 
   // Returns NULL if the object has no bounding box.
-  const BoundingBox* bounding_box() const { return bounding_box_.get(); }
+  const BoundingBox* bounding_box() const {
+    return bounded_ ? &bounding_box_ : NULL;
+  }
 
-  const bool IsBounded() const { return bounding_box() != NULL; }
+  const bool IsBounded() const { return bounded_; }
 
   const Material& material() const { return material_; }
 
+  // Returns the size of the concrete element object. Used to account for the
+  // memory of a scene.
+  virtual size_t ObjectSize() const = 0;
+
+  // Returns the bytes which the element allocated apart from the object itself,
+  // such as the copied vertices of a triangle.
+  virtual size_t AllocatedSize() const { return 0; }
+
+  // Returns the concrete type of the element. Elements of types which are not
+  // listed in Type return OTHER and are always intersected through Intersect().
+  virtual Type type() const { return OTHER; }
+
  protected:
+  // Creates an element without a bounding box.
+  explicit Element(const Material& material)
+      : bounded_(false), material_(material) {}
+
   // Only to be called by subclasses who wish to initialize the bounding box.
-  // Takes ownership of the passed BoundingBox.
-  Element(const Material& material, BoundingBox* box = NULL)
-      : bounding_box_(box), material_(material) {}
+  // Stores a copy of the passed box.
+  Element(const Material& material, const BoundingBox& box)
+      : bounding_box_(box), bounded_(true), material_(material) {}
 
  private:
-  std::unique_ptr<BoundingBox> bounding_box_;
+  // Stored inline, which spares an allocation per element and a dependent load
+  // whenever the box is read.
+  BoundingBox bounding_box_;
+  bool bounded_;
 
   const Material& material_;
 };
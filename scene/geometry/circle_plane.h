@@ -37,6 +37,8 @@ class CirclePlane : public Plane {
   virtual ~CirclePlane();
 
   virtual bool Intersect(const Ray& ray, IntersectionData* data = NULL) const;
+  virtual size_t ObjectSize() const { return sizeof(*this); }
+  virtual Type type() const { return CIRCLE_PLANE; }
 
  private:
   Scalar radius_;
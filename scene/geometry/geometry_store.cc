@@ -0,0 +1,129 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "scene/geometry/geometry_store.h"
+
+#include <glog/logging.h>
+
+GeometryStore::GeometryStore() {
+}
+
+GeometryStore::~GeometryStore() {
+}
+
+GeometryStore::Ref GeometryStore::Add(const Element* element) {
+  const Element::Type type = element->type();
+  size_t index = 0;
+  switch (type) {
+    case Element::TRIANGLE:
+      index = triangles_.size();
+      triangles_.push_back(&static_cast<const Triangle*>(element)->geometry());
+      break;
+    case Element::SPHERE:
+      index = spheres_.size();
+      spheres_.push_back(static_cast<const Sphere*>(element));
+      break;
+    case Element::PLANE:
+      index = planes_.size();
+      planes_.push_back(static_cast<const Plane*>(element));
+      break;
+    case Element::CIRCLE_PLANE:
+      index = circle_planes_.size();
+      circle_planes_.push_back(static_cast<const CirclePlane*>(element));
+      break;
+    default:
+      index = others_.size();
+      others_.push_back(element);
+      break;
+  }
+  CHECK(index <= kIndexMask) << "Too many elements of type " << type;
+  return (static_cast<uint32_t>(type) << kIndexBits) | index;
+}
+
+void GeometryStore::Clear() {
+  triangles_.clear();
+  spheres_.clear();
+  planes_.clear();
+  circle_planes_.clear();
+  others_.clear();
+}
+
+size_t GeometryStore::size() const {
+  return triangles_.size() + spheres_.size() + planes_.size() +
+         circle_planes_.size() + others_.size();
+}
+
+bool GeometryStore::Contains(Ref ref) const {
+  const uint32_t index = ref & kIndexMask;
+  switch (ref >> kIndexBits) {
+    case Element::TRIANGLE:
+      return index < triangles_.size();
+    case Element::SPHERE:
+      return index < spheres_.size();
+    case Element::PLANE:
+      return index < planes_.size();
+    case Element::CIRCLE_PLANE:
+      return index < circle_planes_.size();
+    case Element::OTHER:
+      return index < others_.size();
+    default:
+      return false;
+  }
+}
+
+const Element* GeometryStore::Get(Ref ref) const {
+  const uint32_t index = ref & kIndexMask;
+  switch (ref >> kIndexBits) {
+    case Element::TRIANGLE:
+      return triangles_[index]->triangle;
+    case Element::SPHERE:
+      return spheres_[index];
+    case Element::PLANE:
+      return planes_[index];
+    case Element::CIRCLE_PLANE:
+      return circle_planes_[index];
+    default:
+      return others_[index];
+  }
+}
+
+size_t GeometryStore::DenseIndex(Ref ref) const {
+  // The arrays are numbered one after the other in the order of the types.
+  const uint32_t type = ref >> kIndexBits;
+  size_t offset = 0;
+  if (type > Element::TRIANGLE) offset += triangles_.size();
+  if (type > Element::SPHERE) offset += spheres_.size();
+  if (type > Element::PLANE) offset += planes_.size();
+  if (type > Element::CIRCLE_PLANE) offset += circle_planes_.size();
+  return offset + (ref & kIndexMask);
+}
+
+size_t GeometryStore::ByteSize() const {
+  const size_t num_pointers = triangles_.capacity() + spheres_.capacity() +
+                              planes_.capacity() + circle_planes_.capacity() +
+                              others_.capacity();
+  return num_pointers * sizeof(const void*);
+}
@@ -0,0 +1,120 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Holds elements grouped by their concrete type so that they can be
+ * intersected without virtual calls. Each added element is identified by a
+ * reference which encodes its type and its index into the array of that type.
+ * Triangles are referenced through their packed corner and edges, so
+ * intersecting them does not touch the triangle itself unless there is a hit.
+ * Elements of other types are intersected through their virtual Intersect().
+ *
+ * Author: Dino Wernli
+ */
+
+#ifndef GEOMETRY_STORE_H_
+#define GEOMETRY_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "renderer/intersection_data.h"
+#include "scene/element.h"
+#include "scene/geometry/circle_plane.h"
+#include "scene/geometry/plane.h"
+#include "scene/geometry/sphere.h"
+#include "scene/geometry/triangle.h"
+#include "util/no_copy_assign.h"
+#include "util/ray.h"
+
+class GeometryStore {
+ public:
+  // The type of an element in the top bits and its index in the lower bits.
+  typedef uint32_t Ref;
+
+  GeometryStore();
+  virtual ~GeometryStore();
+  NO_COPY_ASSIGN(GeometryStore);
+
+  // Adds the element and returns its reference. Takes no ownership of the
+  // element. References of elements of the same type are assigned in order.
+  Ref Add(const Element* element);
+
+  // Removes all elements.
+  void Clear();
+
+  // Returns the number of elements added.
+  size_t size() const;
+
+  // Returns whether the passed reference belongs to an element of the store.
+  bool Contains(Ref ref) const;
+
+  // Returns the element with the passed reference.
+  const Element* Get(Ref ref) const;
+
+  // Returns a unique index smaller than size() for the passed reference.
+  size_t DenseIndex(Ref ref) const;
+
+  // Returns the bytes used by the arrays of the store.
+  size_t ByteSize() const;
+
+  // Behaves exactly like calling Intersect() on the referenced element.
+  bool Intersect(Ref ref, const Ray& ray, IntersectionData* data) const {
+    const uint32_t index = ref & kIndexMask;
+    switch (ref >> kIndexBits) {
+      case Element::TRIANGLE: {
+        const PackedTriangle& triangle = *triangles_[index];
+        Scalar t, u, v;
+        if (!Triangle::IntersectEdges(triangle.corner, triangle.edge12,
+                                      triangle.edge13, ray, &t, &u, &v)) {
+          return false;
+        }
+        bool found = ray.InRange(t) && (data == NULL || t < data->t);
+        if (found && data != NULL) {
+          triangle.triangle->StoreIntersection(ray, t, u, v, data);
+        }
+        return found;
+      }
+      case Element::SPHERE:
+        return spheres_[index]->Sphere::Intersect(ray, data);
+      case Element::PLANE:
+        return planes_[index]->Plane::Intersect(ray, data);
+      case Element::CIRCLE_PLANE:
+        return circle_planes_[index]->CirclePlane::Intersect(ray, data);
+      default:
+        return others_[index]->Intersect(ray, data);
+    }
+  }
+
+ private:
+  static const uint32_t kIndexBits = 29;
+  static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+
+  std::vector<const PackedTriangle*> triangles_;
+  std::vector<const Sphere*> spheres_;
+  std::vector<const Plane*> planes_;
+  std::vector<const CirclePlane*> circle_planes_;
+  std::vector<const Element*> others_;
+};
+
+#endif  /* GEOMETRY_STORE_H_ */
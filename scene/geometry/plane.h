@@ -39,6 +39,8 @@ class Plane : public Element {
   virtual ~Plane();
 
   virtual bool Intersect(const Ray& ray, IntersectionData* data = NULL) const;
+  virtual size_t ObjectSize() const { return sizeof(*this); }
+  virtual Type type() const { return PLANE; }
 
   const Point3 point() const { return point_; }
 
@@ -30,9 +30,9 @@
 #include "util/ray.h"
 
 // Convenience method which creates a bounding box for a circle.
-static inline BoundingBox* MakeBoundingBox(const Point3& center, Scalar radius){
+static inline BoundingBox MakeBoundingBox(const Point3& center, Scalar radius){
   Vector3 offset(radius, radius, radius);
-  return &(new BoundingBox(center + offset))->Include(center - offset);
+  return BoundingBox(center + offset, center - offset);
 }
 
 Sphere::Sphere(const Point3& center, Scalar radius, const Material& material)
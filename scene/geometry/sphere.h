@@ -41,12 +41,17 @@ class Sphere : public Element {
   virtual ~Sphere();
 
   virtual bool Intersect(const Ray& ray, IntersectionData* data = NULL) const;
+  virtual size_t ObjectSize() const { return sizeof(*this); }
+  virtual Type type() const { return SPHERE; }
 
   // Returns a uniformly distributed random point on the surface of the sphere.
   // This guarantees that "point" is visible from the returned point.
   // TODO(dinow): This is not true, replace this my a method taking a normal.
   Point3 Sample(const Point3& point) const;
 
+  const Point3& center() const { return center_; }
+  Scalar radius() const { return radius_; }
+
  private:
   Point3 center_;
   Scalar radius_;
@@ -29,61 +29,80 @@
 #include "renderer/intersection_data.h"
 #include "util/ray.h"
 
+// Returns the normalized normal if it is not NULL, and the normal of the face
+// spanned by the corners otherwise.
+static Vector3 VertexNormal(const Vector3* normal, const Point3& c1,
+                            const Point3& c2, const Point3& c3) {
+  if (normal != NULL) {
+    return normal->Normalized();
+  }
+  return c1.VectorTo(c2).Cross(c1.VectorTo(c3)).Normalized();
+}
+
+// Returns a box around the corners.
+static BoundingBox MakeBoundingBox(const Point3& c1, const Point3& c2,
+                                   const Point3& c3) {
+  BoundingBox box(c1);
+  box.Include(c2).Include(c3);
+  return box;
+}
+
 Triangle::Triangle(const Point3& c1, const Point3& c2, const Point3& c3,
                    const Material& material, const Vector3* n1,
                    const Vector3* n2, const Vector3* n3)
-    : Element(material, &(new BoundingBox(c1))->Include(c2).Include(c3)) {
-  Vector3 normal = c1.VectorTo(c2).Cross(c1.VectorTo(c3)).Normalized();
-  vertex1_.reset(new Vertex(c1, n1 == NULL ? normal : n1->Normalized()));
-  vertex2_.reset(new Vertex(c2, n2 == NULL ? normal : n2->Normalized()));
-  vertex3_.reset(new Vertex(c3, n3 == NULL ? normal : n3->Normalized()));
+    : Element(material, MakeBoundingBox(c1, c2, c3)),
+      owned_(new OwnedData()) {
+  Pack(c1, c2, c3, &owned_->geometry);
+  owned_->normals[0] = VertexNormal(n1, c1, c2, c3);
+  owned_->normals[1] = VertexNormal(n2, c1, c2, c3);
+  owned_->normals[2] = VertexNormal(n3, c1, c2, c3);
+  normal1_ = &owned_->normals[0];
+  normal2_ = &owned_->normals[1];
+  normal3_ = &owned_->normals[2];
 }
 
-Triangle::Triangle(const Point3* c1, const Point3* c2, const Point3* c3,
+Triangle::Triangle(const Point3& c1, const Point3& c2, const Point3& c3,
                    const Vector3* n1, const Vector3* n2, const Vector3* n3,
-                   const Material& material)
-    : Element(material, &(new BoundingBox(*c1))->Include(*c2).Include(*c3)),
-      vertex1_(new Vertex(c1, n1)), vertex2_(new Vertex(c2, n2)),
-      vertex3_(new Vertex(c3, n3)) {
+                   const Material& material, PackedTriangle* geometry)
+    : Element(material, MakeBoundingBox(c1, c2, c3)),
+      normal1_(n1), normal2_(n2), normal3_(n3) {
+  Pack(c1, c2, c3, geometry);
 }
 
 Triangle::~Triangle() {
 }
 
-bool Triangle::Intersect(const Ray& ray, IntersectionData* data) const {
-  Vector3 edge12(vertex1_->point().VectorTo(vertex2_->point()));
-  Vector3 edge13(vertex1_->point().VectorTo(vertex3_->point()));
-
-  Vector3 dir_cross_first(ray.direction().Cross(edge13));
-  Scalar determinant = edge12.Dot(dir_cross_first);
-  if (determinant > -EPSILON && determinant < EPSILON) {
-    return false;
-  }
-  Scalar invdet = 1 / determinant;
+size_t Triangle::AllocatedSize() const {
+  return owned_.get() == NULL ? 0 : sizeof(OwnedData);
+}
 
-  // Compute barycentric u.
-  Vector3 vertex_to_origin(vertex1_->point().VectorTo(ray.origin()));
-  Scalar u = vertex_to_origin.Dot(dir_cross_first) * invdet;
-  if (u < 0 || u > 1) {
-    return false;
-  }
+void Triangle::Pack(const Point3& c1, const Point3& c2, const Point3& c3,
+                    PackedTriangle* geometry) {
+  geometry->corner = c1;
+  geometry->edge12 = c1.VectorTo(c2);
+  geometry->edge13 = c1.VectorTo(c3);
+  geometry->triangle = this;
+  geometry_ = geometry;
+}
 
-  // Compute barycentric v.
-  Vector3 plane_normal = vertex_to_origin.Cross(edge12);
-  Scalar v = ray.direction().Dot(plane_normal) * invdet;
-  if (v < 0 || v + u > 1) {
+bool Triangle::Intersect(const Ray& ray, IntersectionData* data) const {
+  Scalar t, u, v;
+  if (!IntersectEdges(geometry_->corner, geometry_->edge12, geometry_->edge13,
+                      ray, &t, &u, &v)) {
     return false;
   }
-
-  Scalar t = edge13.Dot(plane_normal) * invdet;
   bool found = ray.InRange(t) && (data == NULL || t < data->t);
   if (found && data != NULL) {
-    data->set_element(this);
-    data->position = ray.PointAt(t);
-    data->normal = vertex1_->normal() * (1 - u - v) + vertex2_->normal() * u
-                   + vertex3_->normal() * v;
-    data->material = &material();
-    data->t = t;
+    StoreIntersection(ray, t, u, v, data);
   }
   return found;
 }
+
+void Triangle::StoreIntersection(const Ray& ray, Scalar t, Scalar u, Scalar v,
+                                 IntersectionData* data) const {
+  data->set_element(this);
+  data->position = ray.PointAt(t);
+  data->normal = *normal1_ * (1 - u - v) + *normal2_ * u + *normal3_ * v;
+  data->material = &material();
+  data->t = t;
+}
@@ -28,11 +28,29 @@
 #ifndef TRIANGLE_H_
 #define TRIANGLE_H_
 
+#include <memory>
+
 #include "scene/element.h"
-#include "scene/geometry/vertex.h"
 #include "util/no_copy_assign.h"
+#include "util/numeric.h"
+#include "util/point3.h"
+#include "util/ray.h"
+#include "util/vector3.h"
 
 class Material;
+class Triangle;
+
+// The data needed to test a triangle for intersection, which is the only copy
+// of its corners. Meshes keep these in one array, so intersecting many
+// triangles reads contiguous memory and only touches a Triangle on a hit.
+struct PackedTriangle {
+  Point3 corner;
+  Vector3 edge12;
+  Vector3 edge13;
+
+  // Holds the data needed for shading.
+  const Triangle* triangle;
+};
 
 class Triangle : public Element {
  public:
@@ -42,31 +60,95 @@ class Triangle : public Element {
            const Material& material, const Vector3* n1 = NULL,
            const Vector3* n2 = NULL, const Vector3* n3 = NULL);
 
-  // Takes no ownership of the passed data, all pointers are simply copied.
-  Triangle(const Point3* c1, const Point3* c2, const Point3* c3,
+  // Stores the corners in "geometry", which must outlive the triangle. Takes no
+  // ownership of the passed data, the normals are referenced. The triangle
+  // owns no memory, so it may be allocated in an arena.
+  Triangle(const Point3& c1, const Point3& c2, const Point3& c3,
            const Vector3* n1, const Vector3* n2, const Vector3* n3,
-           const Material& material);
+           const Material& material, PackedTriangle* geometry);
 
   virtual ~Triangle();
   NO_COPY_ASSIGN(Triangle);
 
   virtual bool Intersect(const Ray& ray, IntersectionData* data = NULL) const;
+  virtual size_t ObjectSize() const { return sizeof(*this); }
+  virtual size_t AllocatedSize() const;
+  virtual Type type() const { return TRIANGLE; }
+
+  // Stores the intersection at parameter t with barycentric coordinates u and
+  // v, as computed by IntersectEdges(), in data.
+  void StoreIntersection(const Ray& ray, Scalar t, Scalar u, Scalar v,
+                         IntersectionData* data) const;
+
+  // Intersects the ray with the triangle spanned by corner, corner + edge12
+  // and corner + edge13. Returns false if the ray misses the triangle, and
+  // otherwise stores the parameter of the intersection in t and its
+  // barycentric coordinates in u and v. Whether t is in the range of the ray
+  // is left to the caller. Defined here so that callers which intersect many
+  // triangles can inline it.
+  static bool IntersectEdges(const Point3& corner, const Vector3& edge12,
+                             const Vector3& edge13, const Ray& ray, Scalar* t,
+                             Scalar* u, Scalar* v) {
+    Vector3 dir_cross_first(ray.direction().Cross(edge13));
+    Scalar determinant = edge12.Dot(dir_cross_first);
+    if (determinant > -DETERMINANT_EPSILON
+        && determinant < DETERMINANT_EPSILON) {
+      return false;
+    }
+    Scalar invdet = 1 / determinant;
 
-  const Vertex& vertex1() const { return *vertex1_; }
-  const Vertex& vertex2() const { return *vertex2_; }
-  const Vertex& vertex3() const { return *vertex3_; }
+    // Compute barycentric u.
+    Vector3 vertex_to_origin(corner.VectorTo(ray.origin()));
+    *u = vertex_to_origin.Dot(dir_cross_first) * invdet;
+    if (*u < 0 || *u > 1) {
+      return false;
+    }
+
+    // Compute barycentric v.
+    Vector3 plane_normal = vertex_to_origin.Cross(edge12);
+    *v = ray.direction().Dot(plane_normal) * invdet;
+    if (*v < 0 || *v + *u > 1) {
+      return false;
+    }
+
+    *t = edge13.Dot(plane_normal) * invdet;
+    return true;
+  }
+
+  const PackedTriangle& geometry() const { return *geometry_; }
+  Point3 point1() const { return geometry_->corner; }
+  Point3 point2() const { return geometry_->corner + geometry_->edge12; }
+  Point3 point3() const { return geometry_->corner + geometry_->edge13; }
+
+  const Vector3& normal1() const { return *normal1_; }
+  const Vector3& normal2() const { return *normal2_; }
+  const Vector3& normal3() const { return *normal3_; }
 
  private:
-  std::unique_ptr<Vertex> vertex1_;
-  std::unique_ptr<Vertex> vertex2_;
-  std::unique_ptr<Vertex> vertex3_;
+  // The geometry and normals of a triangle which copied them.
+  struct OwnedData {
+    PackedTriangle geometry;
+    Vector3 normals[3];
+  };
+
+  // Stores the corners and this triangle in geometry.
+  void Pack(const Point3& c1, const Point3& c2, const Point3& c3,
+            PackedTriangle* geometry);
+
+  const PackedTriangle* geometry_;
+  const Vector3* normal1_;
+  const Vector3* normal2_;
+  const Vector3* normal3_;
+
+  // Only set if the triangle copied its geometry and normals.
+  std::unique_ptr<OwnedData> owned_;
 };
 
 template<class OStream>
 OStream& operator<<(OStream& os, const Triangle& t)
 {
-  return os << "(triangle: " << t.vertex1() << ", " << t.vertex2() << ", "
-            << t.vertex3() << ")";
+  return os << "(triangle: " << t.point1() << ", " << t.point2() << ", "
+            << t.point3() << ")";
 }
 
 #endif  /* TRIANGLE_H_ */
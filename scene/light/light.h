@@ -29,22 +29,44 @@
 #ifndef LIGHT_H_
 #define LIGHT_H_
 
+#include <cstddef>
+
+#include "util/bounding_box.h"
 #include "util/color3.h"
+#include "util/ray.h"
 
-class Point3;
-class Ray;
+class IntersectionData;
 
 class Light {
  public:
-  Light(const Color3& color) : color_(color) {}
+  // The argument shadow_samples determines how many rays per shading point
+  // are used to estimate the visibility of this light.
+  Light(const Color3& color, size_t shadow_samples = 1)
+      : color_(color), shadow_samples_(shadow_samples) {}
   virtual ~Light() {}
 
   // Generates a ray of light from the source to target.
   virtual Ray GenerateRay(const Point3& target) const = 0;
 
+  // Like GenerateRay(), but uses the pair (u, v) in [0, 1)^2 to pick the point
+  // on the light instead of random numbers. This allows callers to stratify
+  // multiple samples. Lights without extent ignore u and v.
+  virtual Ray SampleRay(const Point3& target, Scalar u, Scalar v) const {
+    return GenerateRay(target);
+  }
+
+  size_t shadow_samples() const { return shadow_samples_; }
+
   // Returns the color of light coming from this source.
   const Color3& color() const { return color_; }
 
+  // Returns a scalar estimate of the amount of light emitted by this source.
+  // Used to decide how often the light is picked when sampling many lights.
+  Scalar Power() const { return (color_.r() + color_.g() + color_.b()) / 3; }
+
+  // Returns a box which contains all points from which light can be emitted.
+  virtual BoundingBox Bounds() const = 0;
+
   // Returns whether the ray intersects this light source. If this returns true
   // and data != NULL, information about the first intersection is stored.
   virtual bool Intersect(const Ray& ray,
@@ -52,6 +74,7 @@ class Light {
 
  private:
   Color3 color_;
+  size_t shadow_samples_;
 };
 
 
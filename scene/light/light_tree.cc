@@ -0,0 +1,147 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "light_tree.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+
+#include "scene/light/light.h"
+#include "util/bounding_box.h"
+#include "util/point3.h"
+
+// Returns the center of the passed box.
+static Point3 Center(const BoundingBox& box) {
+  return box.min() + 0.5 * box.min().VectorTo(box.max());
+}
+
+struct LightTree::Node {
+  // Creates a leaf for a single light.
+  explicit Node(const Light* light_)
+      : box(light_->Bounds()), power(light_->Power()), light(light_) {}
+
+  // Creates an inner node. Takes ownership of both children.
+  Node(Node* left_, Node* right_)
+      : box(left_->box), power(left_->power + right_->power), light(NULL),
+        left(left_), right(right_) {
+    box.Include(right_->box);
+  }
+
+  bool IsLeaf() const { return light != NULL; }
+
+  // Returns an estimate of how much light from this node reaches "point". The
+  // distance is clamped to the extent of the box in order to avoid a blowup
+  // for points which are close to (or inside) the node.
+  Scalar Importance(const Point3& point) const {
+    Scalar squared_distance = Point3::SquaredDistance(point, Center(box));
+    Scalar squared_extent = 0.25 * Point3::SquaredDistance(box.min(),
+                                                           box.max());
+    return power / std::max(squared_distance,
+                            std::max(squared_extent, Scalar(EPSILON)));
+  }
+
+  BoundingBox box;
+  Scalar power;
+
+  // Only set for leaves.
+  const Light* light;
+
+  std::unique_ptr<Node> left;
+  std::unique_ptr<Node> right;
+};
+
+LightTree::LightTree() : num_lights_(0) {
+}
+
+LightTree::~LightTree() {
+}
+
+void LightTree::Init(const std::vector<std::unique_ptr<Light>>& lights) {
+  std::vector<const Light*> light_pointers;
+  for (auto it = lights.begin(); it != lights.end(); ++it) {
+    light_pointers.push_back(it->get());
+  }
+
+  num_lights_ = light_pointers.size();
+  root_.reset(light_pointers.empty() ? NULL :
+      Build(light_pointers.begin(), light_pointers.end()));
+  LOG(INFO) << "Built light tree for " << num_lights_ << " lights";
+}
+
+// static
+LightTree::Node* LightTree::Build(std::vector<const Light*>::iterator begin,
+                                  std::vector<const Light*>::iterator end) {
+  if (end - begin == 1) {
+    return new Node(*begin);
+  }
+
+  BoundingBox centers;
+  for (auto it = begin; it != end; ++it) {
+    centers.Include(Center((*it)->Bounds()));
+  }
+
+  Vector3 extent = centers.min().VectorTo(centers.max());
+  Axis axis = Axis::x();
+  if (extent.y() > extent[axis]) axis = Axis::y();
+  if (extent.z() > extent[axis]) axis = Axis::z();
+
+  auto middle = begin + (end - begin) / 2;
+  std::nth_element(begin, middle, end,
+      [axis](const Light* first, const Light* second) {
+        return Center(first->Bounds())[axis] < Center(second->Bounds())[axis];
+      });
+  return new Node(Build(begin, middle), Build(middle, end));
+}
+
+const Light* LightTree::Sample(const Point3& point, Scalar u,
+                               Scalar* pdf) const {
+  *pdf = 0;
+  if (root_.get() == NULL) {
+    return NULL;
+  }
+
+  // Reuse the same random number for all levels by rescaling it to [0, 1)
+  // after every decision.
+  u = std::min(std::max(u, Scalar(0)), Scalar(1 - EPSILON));
+  *pdf = 1;
+  const Node* node = root_.get();
+  while (!node->IsLeaf()) {
+    Scalar left = node->left->Importance(point);
+    Scalar right = node->right->Importance(point);
+    Scalar p_left = left + right > 0 ? left / (left + right) : 0.5;
+
+    if (u < p_left) {
+      u = u / p_left;
+      *pdf *= p_left;
+      node = node->left.get();
+    } else {
+      u = (u - p_left) / (1 - p_left);
+      *pdf *= 1 - p_left;
+      node = node->right.get();
+    }
+  }
+  return node->light;
+}
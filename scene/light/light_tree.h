@@ -0,0 +1,76 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * A bounding volume hierarchy over the lights of a scene. Every node stores
+ * the bounds and the total power of the lights below it, which allows picking
+ * a single light with a probability roughly proportional to its contribution
+ * at a given point without looking at every light.
+ *
+ * Author: Dino Wernli
+ */
+
+#ifndef LIGHT_TREE_H_
+#define LIGHT_TREE_H_
+
+#include <memory>
+#include <vector>
+
+#include "util/no_copy_assign.h"
+#include "util/numeric.h"
+
+class Light;
+class Point3;
+
+class LightTree {
+ public:
+  LightTree();
+  virtual ~LightTree();
+  NO_COPY_ASSIGN(LightTree);
+
+  // Builds a tree which contains pointers to the passed lights. No ownership
+  // is taken for any of the lights.
+  void Init(const std::vector<std::unique_ptr<Light>>& lights);
+
+  // Picks a light by walking down the tree, choosing each child according to
+  // its estimated importance at "point". The argument "u" is expected to be a
+  // uniform random number in [0, 1). The probability with which the returned
+  // light was picked is stored in "pdf". Returns NULL if the tree is empty.
+  const Light* Sample(const Point3& point, Scalar u, Scalar* pdf) const;
+
+  size_t NumLights() const { return num_lights_; }
+
+ private:
+  struct Node;
+
+  // Recursively builds a subtree for the lights in [begin, end) by splitting
+  // them at the median of their centers along the longest axis. The caller
+  // takes ownership of the returned node.
+  static Node* Build(std::vector<const Light*>::iterator begin,
+                     std::vector<const Light*>::iterator end);
+
+  std::unique_ptr<Node> root_;
+
+  size_t num_lights_;
+};
+
+#endif  /* LIGHT_TREE_H_ */
@@ -48,6 +48,8 @@ class PointLight : public Light {
     return Ray(position_, direction, EPSILON, direction.Length() - EPSILON);
   }
 
+  virtual BoundingBox Bounds() const { return BoundingBox(position_); }
+
   // No ray ever intersects a dimensionless point light.
   virtual bool Intersect(const Ray& ray, IntersectionData* data) const {
     return false;
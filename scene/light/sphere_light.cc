@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "sphere_light.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "util/random.h"
+
+Ray SphereLight::GenerateRay(const Point3& target) const {
+  // Lights are shared between worker threads, so each thread gets its own
+  // random number generator.
+  static thread_local Random random;
+  return SampleRay(target, random.Get(0, 1), random.Get(0, 1));
+}
+
+Ray SphereLight::SampleRay(const Point3& target, Scalar u, Scalar v) const {
+  const Point3& center = sphere_->center();
+  const Scalar radius = sphere_->radius();
+  Vector3 to_center = target.VectorTo(center);
+  const Scalar squared_distance = to_center.SquaredLength();
+
+  Point3 origin;
+  if (squared_distance <= radius * radius) {
+    // The target is inside the sphere, so every point of the surface is
+    // visible and there is no cone to sample from.
+    origin = sphere_->Sample(target);
+  } else {
+    const Scalar distance = sqrt(squared_distance);
+    const Scalar sin_max_squared = radius * radius / squared_distance;
+    const Scalar cos_max = sqrt(std::max(Scalar(0), 1 - sin_max_squared));
+
+    // Sampling cos(theta) uniformly in [cos_max, 1] yields directions which
+    // are uniformly distributed over the solid angle of the cone.
+    const Scalar cos_theta = 1 - u * (1 - cos_max);
+    const Scalar sin_theta = sqrt(std::max(Scalar(0),
+                                           1 - cos_theta * cos_theta));
+    const Scalar phi = 2 * PI * v;
+
+    // Build an orthonormal basis around the axis of the cone.
+    Vector3 axis = (1 / distance) * to_center;
+    Vector3 helper = std::abs(axis.x()) > 0.9 ? Vector3(0, 1, 0)
+                                              : Vector3(1, 0, 0);
+    Vector3 tangent = axis.Cross(helper).Normalized();
+    Vector3 bitangent = axis.Cross(tangent);
+    Vector3 direction = sin_theta * cos(phi) * tangent
+                        + sin_theta * sin(phi) * bitangent + cos_theta * axis;
+
+    // Distance from target to the first intersection with the sphere along
+    // direction. The term under the root only becomes negative through
+    // rounding at the boundary of the cone.
+    const Scalar under_root = radius * radius
+        - squared_distance * sin_theta * sin_theta;
+    const Scalar t = distance * cos_theta - sqrt(std::max(Scalar(0),
+                                                          under_root));
+    origin = target + t * direction;
+  }
+
+  Vector3 direction = origin.VectorTo(target);
+  return Ray(origin, direction, EPSILON, direction.Length() - EPSILON);
+}
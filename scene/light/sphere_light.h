@@ -39,32 +39,24 @@
 
 class SphereLight : public Light {
  public:
-  SphereLight(const Point3& center, Scalar radius, const Color3& color)
-      : Light(color), dummy_material_(NULL, NULL, NULL, NULL, 0, 0, 0, 0) {
+  SphereLight(const Point3& center, Scalar radius, const Color3& color,
+              size_t shadow_samples = 1)
+      : Light(color, shadow_samples),
+        dummy_material_(NULL, NULL, NULL, NULL, 0, 0, 0, 0) {
     // TODO(dinow): Remove this dummy material as soon as sphere is patched.
     sphere_.reset(new Sphere(center, radius, dummy_material_));
   }
   virtual ~SphereLight() {};
 
-  virtual Ray GenerateRay(const Point3& target) const {
-    // TODO(dinow): Somehow handle the target being inside the sphere.
-    Point3 origin = sphere_->Sample(target);
-    Vector3 direction = origin.VectorTo(target);
-    Ray ray(origin, direction, EPSILON, direction.Length() - EPSILON);
+  // Samples a direction uniformly from the cone of directions under which the
+  // sphere is seen from target, and returns the ray from the corresponding
+  // point on the sphere to target.
+  virtual Ray GenerateRay(const Point3& target) const;
 
-    IntersectionData data(ray);
-    if (Intersect(ray, &data)) {
-      // Ray started on the back side of the sphere, take the intersection
-      // point as new origin.
-      // TODO(dinow): Note that this is a hack because the distribution is no
-      // longer completely uniform. However, the difference is so minimal that
-      // rejection sampling is just not worth it.
-      origin = ray.PointAt(data.t);
-      direction = origin.VectorTo(target);
-      ray = Ray(origin, direction, EPSILON, direction.Length() - EPSILON);
-    }
-    return ray;
-  }
+  // Maps the pair (u, v) uniformly to the solid angle subtended by the sphere.
+  virtual Ray SampleRay(const Point3& target, Scalar u, Scalar v) const;
+
+  virtual BoundingBox Bounds() const { return *sphere_->bounding_box(); }
 
   virtual bool Intersect(const Ray& ray, IntersectionData* data = NULL) const {
     bool result = sphere_->Intersect(ray, data);
@@ -40,7 +40,10 @@ class Material {
            Scalar reflection_percentage, Scalar refraction_percentage,
            Scalar refraction_index)
       : emission_(emission), ambient_(ambient), diffuse_(diffuse),
-        specular_(specular), shininess_(shininess),
+        specular_(specular), constant_emission_(ConstantColor(emission)),
+        constant_ambient_(ConstantColor(ambient)),
+        constant_diffuse_(ConstantColor(diffuse)),
+        constant_specular_(ConstantColor(specular)), shininess_(shininess),
         reflection_percentage_(reflection_percentage),
         refraction_percentage_(refraction_percentage),
         refraction_index_(refraction_index) {
@@ -62,19 +65,19 @@ class Material {
   }
 
   const Color3 emission(const IntersectionData& data) const {
-    return emission_->Evaluate(data);
+    return Evaluate(emission_, constant_emission_, data);
   }
 
   const Color3 ambient(const IntersectionData& data) const {
-    return ambient_->Evaluate(data);
+    return Evaluate(ambient_, constant_ambient_, data);
   }
 
   const Color3 diffuse(const IntersectionData& data) const {
-    return diffuse_->Evaluate(data);
+    return Evaluate(diffuse_, constant_diffuse_, data);
   }
 
   const Color3 specular(const IntersectionData& data) const {
-    return specular_->Evaluate(data);
+    return Evaluate(specular_, constant_specular_, data);
   }
 
   Scalar shininess() const { return shininess_; }
@@ -83,11 +86,28 @@ class Material {
   Scalar refraction_index() const { return refraction_index_; }
 
  private:
+  // Returns the constant color of texture, or NULL if there is none.
+  static const Color3* ConstantColor(const Texture* texture) {
+    return texture == NULL ? NULL : texture->constant_color();
+  }
+
+  // Evaluates texture without a virtual call if its color is constant.
+  static Color3 Evaluate(const Texture* texture, const Color3* constant,
+                         const IntersectionData& data) {
+    return constant != NULL ? *constant : texture->Evaluate(data);
+  }
+
   Texture* emission_;
   Texture* ambient_;
   Texture* diffuse_;
   Texture* specular_;
 
+  // The colors of the textures above which are constant, or NULL.
+  const Color3* constant_emission_;
+  const Color3* constant_ambient_;
+  const Color3* constant_diffuse_;
+  const Color3* constant_specular_;
+
   Scalar shininess_;
   Scalar reflection_percentage_;
   Scalar refraction_percentage_;
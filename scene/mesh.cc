@@ -27,52 +27,112 @@
 #include "mesh.h"
 
 #include <glog/logging.h>
+#include <new>
 
 #include "scene/element.h"
 #include "scene/geometry/triangle.h"
+#include "util/arena.h"
 #include "util/bounding_box.h"
+#include "util/memory_report.h"
 #include "util/point3.h"
+#include "util/trace.h"
 #include "util/vector3.h"
 
-Mesh::Mesh() {
+Mesh::Mesh()
+    : mapped_points_(NULL), num_mapped_points_(0), mapped_normals_(NULL),
+      num_mapped_normals_(0), mapped_triangles_(NULL),
+      num_mapped_triangles_(0), material_(NULL) {
+}
+
+Mesh::Mesh(MappedFile* file, const Point3* points, size_t num_points,
+           const Vector3* normals, size_t num_normals,
+           const TriangleDescriptor* triangles, size_t num_triangles)
+    : file_(file), mapped_points_(points), num_mapped_points_(num_points),
+      mapped_normals_(normals), num_mapped_normals_(num_normals),
+      mapped_triangles_(triangles), num_mapped_triangles_(num_triangles),
+      material_(NULL) {
 }
 
 Mesh::~Mesh() {
 }
 
 size_t Mesh::AddPoint(const Point3& point) {
+  CHECK(!is_mapped()) << "Cannot modify mapped mesh";
   points_.push_back(point);
   return points_.size() - 1;
 }
 
 size_t Mesh::AddNormal(const Vector3& normal) {
+  CHECK(!is_mapped()) << "Cannot modify mapped mesh";
   normals_.push_back(normal);
   return normals_.size() - 1;
 }
 
+void Mesh::Reserve(size_t num_points, size_t num_normals,
+                   size_t num_triangles) {
+  points_.reserve(num_points);
+  normals_.reserve(num_normals);
+  descriptors_.reserve(num_triangles);
+}
+
 void Mesh::AddTriangle(size_t v1, size_t n1, size_t v2, size_t n2, size_t v3,
                        size_t n3) {
+  CHECK(!is_mapped()) << "Cannot modify mapped mesh";
   descriptors_.push_back(TriangleDescriptor(v1, n1, v2, n2, v3, n3));
 }
 
-void Mesh::CreateElements(std::vector<std::unique_ptr<Element>>* target) const {
-  DVLOG(2) << "Creating " << descriptors_.size() << " triangles from mesh";
-  for (auto it = descriptors_.begin(); it != descriptors_.end(); ++it) {
-    const Point3* p1 = &points_[it->p1];
-    const Point3* p2 = &points_[it->p2];
-    const Point3* p3 = &points_[it->p3];
-
-    const Vector3* n1 = &normals_[it->n1];
-    const Vector3* n2 = &normals_[it->n2];
-    const Vector3* n3 = &normals_[it->n3];
-
-    Triangle* triangle = new Triangle(p1, p2, p3, n1, n2, n3, *material_);
+void Mesh::CreateElements(Arena* arena,
+                          std::vector<const Element*>* target) const {
+  DVLOG(2) << "Creating " << num_triangles() << " triangles from mesh";
+  const Point3* points = this->points();
+  const Vector3* normals = this->normals();
+  const TriangleDescriptor* triangles = this->triangles();
+  if (num_triangles() == 0) {
+    return;
+  }
+  target->reserve(target->size() + num_triangles());
+
+  // The corners of all triangles of the mesh are stored next to each other.
+  PackedTriangle* geometry = static_cast<PackedTriangle*>(arena->Allocate(
+      num_triangles() * sizeof(PackedTriangle), alignof(PackedTriangle)));
+  for (size_t i = 0; i < num_triangles(); ++i) {
+    const TriangleDescriptor& descriptor = triangles[i];
+    const Vector3* n1 = &normals[descriptor.n1];
+    const Vector3* n2 = &normals[descriptor.n2];
+    const Vector3* n3 = &normals[descriptor.n3];
+
+    Triangle* triangle = arena->New<Triangle>(
+        points[descriptor.p1], points[descriptor.p2], points[descriptor.p3],
+        n1, n2, n3, *material_, new (&geometry[i]) PackedTriangle());
     DVLOG(3) << "Adding triangle " << *triangle;
-    target->push_back(std::unique_ptr<Element>(triangle));
+    target->push_back(triangle);
   }
 }
 
+void Mesh::AddMemoryUsage(MemoryReport* report) const {
+  if (is_mapped()) {
+    report->Add("mesh_points", num_points() * sizeof(Point3), num_points());
+    report->Add("mesh_normals", num_normals() * sizeof(Vector3),
+                num_normals());
+    report->Add("mesh_triangles", num_triangles() * sizeof(TriangleDescriptor),
+                num_triangles());
+  } else {
+    report->Add("mesh_points", points_.capacity() * sizeof(Point3),
+                points_.size());
+    report->Add("mesh_normals", normals_.capacity() * sizeof(Vector3),
+                normals_.size());
+    report->Add("mesh_triangles",
+                descriptors_.capacity() * sizeof(TriangleDescriptor),
+                descriptors_.size());
+  }
+
+  // Allocated in the arena by CreateElements().
+  report->Add("mesh_packed_triangles", num_triangles() * sizeof(PackedTriangle),
+              num_triangles());
+}
+
 void Mesh::Transform(Scalar scale, const Vector3& translation) {
+  CHECK(!is_mapped()) << "Cannot modify mapped mesh";
   BoundingBox box;
   for (size_t i = 0; i < points_.size(); ++i) {
     box.Include(points_[i]);
@@ -88,6 +148,8 @@ void Mesh::Transform(Scalar scale, const Vector3& translation) {
 }
 
 void Mesh::InferNormals() {
+  ScopedSpan span("Mesh::InferNormals");
+  CHECK(!is_mapped()) << "Cannot modify mapped mesh";
   for(size_t i = 0; i < normals_.size(); ++i) {
     normals_[i].ReplaceWith(Vector3(0, 0, 0));
   }
@@ -29,20 +29,40 @@
 #ifndef MESH_H_
 #define MESH_H_
 
+#include<cstdint>
 #include<memory>
 #include<vector>
 
+#include "util/mapped_file.h"
 #include "util/numeric.h"
+#include "util/point3.h"
+#include "util/vector3.h"
 
+class Arena;
 class Element;
 class Material;
-class Point3;
-class Vector3;
+class MemoryReport;
 
 class Mesh {
  public:
+  // Holds the point and normal indices of the three corners of a triangle.
+  struct TriangleDescriptor {
+    TriangleDescriptor(uint32_t p1_, uint32_t n1_, uint32_t p2_, uint32_t n2_,
+                       uint32_t p3_, uint32_t n3_)
+        : p1(p1_), n1(n1_), p2(p2_), n2(n2_), p3(p3_), n3(n3_) {
+    }
+    uint32_t p1, n1, p2, n2, p3, n3;
+  };
+
   // Does not take ownership of the passed material.
   Mesh();
+
+  // Creates an immutable mesh whose data lives in a mapped file. The arrays
+  // must point into the file. Takes ownership of the file.
+  Mesh(MappedFile* file, const Point3* points, size_t num_points,
+       const Vector3* normals, size_t num_normals,
+       const TriangleDescriptor* triangles, size_t num_triangles);
+
   virtual ~Mesh();
 
   // Adds a copy of the passed point and returns the index of the new point.
@@ -53,13 +73,17 @@ class Mesh {
   // The mesh guarantees that every new normal increases the index by 1.
   size_t AddNormal(const Vector3& normal);
 
+  // Preallocates storage for the passed number of points, normals and
+  // triangles. Used by loaders which know the final size of the mesh.
+  void Reserve(size_t num_points, size_t num_normals, size_t num_triangles);
+
   // Declares a triangle using the three passed vertex indices.
   void AddTriangle(size_t v1, size_t n1, size_t v2, size_t n2, size_t v3,
                    size_t n3);
 
-  // Adds light-weight triangles to target. The caller takes ownership of the
-  // produced triangles.
-  void CreateElements(std::vector<std::unique_ptr<Element>>* target) const;
+  // Adds light-weight triangles to target. The triangles and one array of
+  // their packed corners are allocated in arena, which owns them.
+  void CreateElements(Arena* arena, std::vector<const Element*>* target) const;
 
   // Mimics the old transformation from the course XML files.
   // WARNING: Is not intuitive to use, but needed for compatibility.
@@ -69,21 +93,54 @@ class Mesh {
   // of the faces of the surrounding triangles.
   void InferNormals();
 
+  // Adds the points, normals and triangle descriptors to report. For mapped
+  // meshes, these are the sizes of the arrays in the file. Also adds the
+  // packed corners which CreateElements() allocates in the arena.
+  void AddMemoryUsage(MemoryReport* report) const;
+
   // Does not take ownership of the passed material.
   void set_material(const Material* material) { material_ = material; }
 
- private:
-  struct TriangleDescriptor {
-    TriangleDescriptor(size_t p1_, size_t n1_, size_t p2_, size_t n2_,
-                       size_t p3_, size_t n3_)
-        : p1(p1_), n1(n1_), p2(p2_), n2(n2_), p3(p3_), n3(n3_) {
-    }
-    size_t p1, n1, p2, n2, p3, n3;
-  };
+  // Returns true if the mesh data lives in a mapped file, in which case the
+  // mesh cannot be modified.
+  bool is_mapped() const { return file_.get() != NULL; }
+
+  const Point3* points() const {
+    return is_mapped() ? mapped_points_ : points_.data();
+  }
+  size_t num_points() const {
+    return is_mapped() ? num_mapped_points_ : points_.size();
+  }
+
+  const Vector3* normals() const {
+    return is_mapped() ? mapped_normals_ : normals_.data();
+  }
+  size_t num_normals() const {
+    return is_mapped() ? num_mapped_normals_ : normals_.size();
+  }
+
+  const TriangleDescriptor* triangles() const {
+    return is_mapped() ? mapped_triangles_ : descriptors_.data();
+  }
+  size_t num_triangles() const {
+    return is_mapped() ? num_mapped_triangles_ : descriptors_.size();
+  }
 
+ private:
+  // The data of meshes which are built in memory.
   std::vector<Point3> points_;
   std::vector<Vector3> normals_;
   std::vector<TriangleDescriptor> descriptors_;
+
+  // The data of meshes backed by a mapped file.
+  std::unique_ptr<MappedFile> file_;
+  const Point3* mapped_points_;
+  size_t num_mapped_points_;
+  const Vector3* mapped_normals_;
+  size_t num_mapped_normals_;
+  const TriangleDescriptor* mapped_triangles_;
+  size_t num_mapped_triangles_;
+
   const Material* material_;
 };
 
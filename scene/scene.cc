@@ -35,21 +35,26 @@
 #include "scene/material.h"
 #include "scene/mesh.h"
 #include "scene/texture/texture.h"
+#include "util/memory_report.h"
 
 Scene::Scene(KdTree* kd_tree)
     : kd_tree_(kd_tree), background_(Color3(1, 1, 1)),
-      ambient_(Color3(0, 0, 0)), refraction_index_(1) {
+      ambient_(Color3(0, 0, 0)), refraction_index_(1),
+      initialized_(false) {
 }
 
 Scene::~Scene() {
 }
 
 void Scene::AddElement(Element* element) {
-  elements_.push_back(std::unique_ptr<Element>(element));
+  owned_elements_.push_back(std::unique_ptr<Element>(element));
+  elements_.push_back(element);
+  initialized_ = false;
 }
 
 void Scene::AddLight(Light* light) {
   lights_.push_back(std::unique_ptr<Light>(light));
+  initialized_ = false;
 }
 
 void Scene::AddMaterial(Material* material) {
@@ -58,7 +63,8 @@ void Scene::AddMaterial(Material* material) {
 
 void Scene::AddMesh(Mesh* mesh) {
   meshes_.push_back(std::unique_ptr<Mesh>(mesh));
-  mesh->CreateElements(&elements_);
+  mesh->CreateElements(&arena_, &elements_);
+  initialized_ = false;
 }
 
 void Scene::AddTexture(Texture* texture) {
@@ -66,11 +72,20 @@ void Scene::AddTexture(Texture* texture) {
 }
 
 void Scene::Init() {
+  if (initialized_) {
+    return;
+  }
   DVLOG(1) << "Initializing scene with " << elements_.size() << " elements";
   if(UsesKdTree()) {
-    kd_tree_->Init(&elements_);
+    kd_tree_->Init(elements_);
   }
+  light_tree_.Init(lights_);
+  initialized_ = true;
   LOG(INFO) << "Scene initialized";
+
+  memory_report_ = MemoryReport();
+  AddMemoryUsage(&memory_report_);
+  memory_report_.Log();
 }
 
 bool Scene::Intersect(const Ray& ray, IntersectionData* data) const {
@@ -88,7 +103,7 @@ bool Scene::Intersect(const Ray& ray, IntersectionData* data) const {
     result = kd_tree_->Intersect(ray, data) || result;
   } else {
     for (auto it = elements_.begin(); it != elements_.end(); ++it) {
-      result = it->get()->Intersect(ray, data) || result;
+      result = (*it)->Intersect(ray, data) || result;
       if (result && (data == NULL)) {
         return true;
       }
@@ -97,6 +112,41 @@ bool Scene::Intersect(const Ray& ray, IntersectionData* data) const {
   return result;
 }
 
+void Scene::AddMemoryUsage(MemoryReport* report) const {
+  size_t element_bytes =
+      elements_.capacity() * sizeof(elements_[0]) +
+      owned_elements_.capacity() * sizeof(owned_elements_[0]);
+  size_t allocated_bytes = 0;
+  size_t num_allocating = 0;
+  for (auto it = elements_.begin(); it != elements_.end(); ++it) {
+    const Element& element = **it;
+    element_bytes += element.ObjectSize();
+    // Only triangles which copied their vertices allocate data of their own.
+    const size_t allocated = element.AllocatedSize();
+    if (allocated > 0) {
+      allocated_bytes += allocated;
+      ++num_allocating;
+    }
+  }
+  report->Add("elements", element_bytes, elements_.size());
+  report->Add("element_allocations", allocated_bytes, num_allocating);
+  report->Add("scene_arena_unused",
+              arena_.bytes_reserved() - arena_.bytes_used(), 0);
+
+  for (auto it = meshes_.begin(); it != meshes_.end(); ++it) {
+    it->get()->AddMemoryUsage(report);
+  }
+  if (UsesKdTree()) {
+    kd_tree_->AddMemoryUsage(report);
+  }
+
+  size_t texture_bytes = textures_.capacity() * sizeof(textures_[0]);
+  for (auto it = textures_.begin(); it != textures_.end(); ++it) {
+    texture_bytes += it->get()->ByteSize();
+  }
+  report->Add("textures", texture_bytes, textures_.size());
+}
+
 // static
 Scene* Scene::FromConfig(const raytracer::SceneConfig& config) {
   KdTree* tree = NULL;
@@ -105,7 +155,7 @@ Scene* Scene::FromConfig(const raytracer::SceneConfig& config) {
   }
 
   Scene* scene = new Scene(tree);
-  SceneParser parser;
+  SceneParser parser(config.use_mesh_cache());
   parser.ParseScene(config.scene_data(), scene);
   return scene;
 }
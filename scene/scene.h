@@ -32,8 +32,11 @@
 #include<vector>
 
 #include "scene/camera.h"
+#include "scene/light/light_tree.h"
+#include "util/arena.h"
 #include "util/color3.h"
 #include "util/kd_tree.h"
+#include "util/memory_report.h"
 #include "util/no_copy_assign.h"
 
 class Element;
@@ -69,7 +72,8 @@ class Scene {
   void AddTexture(Texture* texture);
 
   // Takes ownership of the passed mesh. Extracts all elements of the mesh and
-  // adds them to the list of elements.
+  // adds them to the list of elements. The elements are allocated in an arena
+  // of the scene and released all at once with the scene.
   void AddMesh(Mesh* mesh);
 
   // Takes ownership of the passed camera.
@@ -86,29 +90,58 @@ class Scene {
 
   // Prepares the scene, builds data structures etc. Must be called before
   // before querying for intersections. If anything is added to the scene after
-  // a call to Init(), it might be ignored until the next Init() call.
+  // a call to Init(), it might be ignored until the next Init() call. Does
+  // nothing if the scene has not changed since the last call, so a resident
+  // scene can be rendered repeatedly without rebuilding its KdTree. Logs the
+  // memory report of the scene whenever it is rebuilt.
   void Init();
 
   bool Intersect(const Ray& ray, IntersectionData* data = NULL) const;
 
+  // Adds the memory used by the elements, their bounding boxes and vertices,
+  // the meshes, the KdTree and the textures to report. Should be called after
+  // Init() in order to include the KdTree.
+  void AddMemoryUsage(MemoryReport* report) const;
+
+  // Returns the memory used by the scene as of the last call to Init().
+  const MemoryReport& memory_report() const { return memory_report_; }
+
   // TODO(dinow): Figure out how to return something which only allows iteration
   // over const Light& (without an extra memory allocation).
   const std::vector<std::unique_ptr<Light>>& lights() const { return lights_; }
 
+  // Returns a hierarchy over all lights which can be used to sample lights.
+  // Only valid after a call to Init().
+  const LightTree& light_tree() const { return light_tree_; }
+
   static Scene* FromConfig(const raytracer::SceneConfig& config);
 
  private:
-  std::vector<std::unique_ptr<Element>> elements_;
+  // Owns the elements of all meshes. Declared before all members which may
+  // refer to them.
+  Arena arena_;
+
+  // All elements of the scene. Those which are not in the arena are owned by
+  // owned_elements_.
+  std::vector<const Element*> elements_;
+  std::vector<std::unique_ptr<Element>> owned_elements_;
   std::vector<std::unique_ptr<Light>> lights_;
   std::unique_ptr<Camera> camera_;
   std::vector<std::unique_ptr<Material>> materials_;
   std::vector<std::unique_ptr<Mesh>> meshes_;
   std::vector<std::unique_ptr<Texture>> textures_;
   std::unique_ptr<KdTree> kd_tree_;
+  LightTree light_tree_;
 
   Color3 background_;
   Color3 ambient_;
   Scalar refraction_index_;
+
+  // Whether the data structures built by Init() are up to date.
+  bool initialized_;
+
+  // Built by Init() so that rendering a resident scene does not walk it again.
+  MemoryReport memory_report_;
 };
 
 #endif  /* SCENE_H_ */
@@ -43,6 +43,8 @@ class Checkerboard : public Texture2D {
       : first_(first), second_(second), length_(2 * length) {}
   virtual ~Checkerboard() {}
 
+  virtual size_t ByteSize() const { return sizeof(*this); }
+
  protected:
   virtual Color3 Evaluate2D(const IntersectionData& data) const {
     long sss = floor(data.texture_coordinate.s * length_);
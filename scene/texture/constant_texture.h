@@ -38,6 +38,10 @@ class ConstantTexture : public Texture {
     return color_;
   }
 
+  virtual const Color3* constant_color() const { return &color_; }
+
+  virtual size_t ByteSize() const { return sizeof(*this); }
+
  private:
   Color3 color_;
 };
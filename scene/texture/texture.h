@@ -28,6 +28,8 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
+#include <cstddef>
+
 #include "util/color3.h"
 
 class IntersectionData;
@@ -36,6 +38,13 @@ class Texture {
  public:
   virtual ~Texture() {}
   virtual Color3 Evaluate(const IntersectionData& data) const = 0;
+
+  // Returns the color of the texture if it is the same for all intersections,
+  // which lets callers skip Evaluate(). Returns NULL otherwise.
+  virtual const Color3* constant_color() const { return NULL; }
+
+  // Returns the bytes used by the texture, including any allocated data.
+  virtual size_t ByteSize() const = 0;
 };
 
 #endif  /* TEXTURE_H_ */
@@ -0,0 +1,395 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Author: Dino Wernli
+ */
+
+#include "render_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <glog/logging.h>
+#include <google/protobuf/text_format.h>
+#include <memory>
+#include <netinet/in.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "listener/bmp_exporter.h"
+#include "listener/exr_exporter.h"
+#include "listener/png_exporter.h"
+#include "parser/scene_parser.h"
+#include "proto/scene/camera_data.pb.h"
+#include "proto/server/render_job.pb.h"
+#include "renderer/image.h"
+#include "renderer/renderer.h"
+#include "renderer/sampler/sampler.h"
+#include "renderer/updatable.h"
+#include "scene/camera.h"
+#include "scene/scene.h"
+
+// Encodes the final image of a rendering into a string.
+class ImageEncoder : public Updatable {
+ public:
+  // Does not take ownership of "image".
+  ImageEncoder(raytracer::RenderJob::ImageFormat format, std::string* image)
+      : format_(format), image_(image) {}
+  virtual ~ImageEncoder() {}
+
+  virtual void Ended(const Sampler& sampler) {
+    if (format_ == raytracer::RenderJob::RAW) {
+      RenderServer::EncodeRaw(sampler.image(), image_);
+      return;
+    }
+
+    std::ostringstream stream;
+    if (format_ == raytracer::RenderJob::PNG) {
+      PngExporter::Write(sampler.image(), &stream);
+    } else if (format_ == raytracer::RenderJob::EXR) {
+      ExrExporter::Write(sampler.image(), &stream);
+    } else {
+      BmpExporter::Write(sampler.image(), &stream);
+    }
+    *image_ = stream.str();
+  }
+
+ private:
+  const raytracer::RenderJob::ImageFormat format_;
+  std::string* image_;
+};
+
+// Returns the number of seconds elapsed since "start".
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Returns whether config names a file which the renderer would write.
+static bool HasOutputPath(const raytracer::RendererConfig& config) {
+  return config.has_sampling_heatmap_path() || config.has_statistics_path() ||
+         config.has_kd_tree_heatmap_path() ||
+         config.has_element_tests_heatmap_path() ||
+         config.has_time_heatmap_path() || config.has_memory_report_path();
+}
+
+// Copies the fields of a remote client's config which only affect the image
+// and the work done for it from "remote" to "config". The number of threads
+// is capped at the one already in config.
+static void MergeRemoteConfig(const raytracer::RendererConfig& remote,
+                              raytracer::RendererConfig* config) {
+  if (remote.has_threads()) {
+    const uint64_t max_threads = std::max<uint64_t>(config->threads(), 1);
+    config->set_threads(std::min<uint64_t>(remote.threads(), max_threads));
+  }
+  if (remote.has_shadows()) {
+    config->set_shadows(remote.shadows());
+  }
+  if (remote.has_recursion_depth()) {
+    config->set_recursion_depth(remote.recursion_depth());
+  }
+  if (remote.has_root_rays_per_pixel()) {
+    config->set_root_rays_per_pixel(remote.root_rays_per_pixel());
+  }
+  if (remote.has_sampler_type()) {
+    config->set_sampler_type(remote.sampler_type());
+  }
+  if (remote.has_adaptive_supersampling_threshold()) {
+    config->set_adaptive_supersampling_threshold(
+        remote.adaptive_supersampling_threshold());
+  }
+  if (remote.has_light_samples()) {
+    config->set_light_samples(remote.light_samples());
+  }
+  if (remote.has_tile()) *config->mutable_tile() = remote.tile();
+  if (remote.has_exposure()) {
+    config->set_exposure(remote.exposure());
+  }
+  if (remote.has_tone_mapping()) {
+    config->set_tone_mapping(remote.tone_mapping());
+  }
+  if (remote.has_gamma()) {
+    config->set_gamma(remote.gamma());
+  }
+}
+
+RenderServer::RenderServer(const raytracer::SceneConfig& scene_config,
+                           const raytracer::RendererConfig& renderer_config,
+                           size_t cache_capacity)
+    : scene_cache_(scene_config, cache_capacity),
+      renderer_config_(renderer_config), scene_dir_("data/scene") {
+}
+
+RenderServer::~RenderServer() {
+}
+
+bool RenderServer::Serve(FILE* input, FILE* output) {
+  return Serve(input, output, false /* remote */);
+}
+
+bool RenderServer::Serve(FILE* input, FILE* output, bool remote) {
+  google::protobuf::TextFormat::Printer printer;
+  printer.SetSingleLineMode(true);
+
+  char* line = NULL;
+  size_t capacity = 0;
+  ssize_t length;
+  bool success = true;
+  while (success && (length = getline(&line, &capacity, input)) >= 0) {
+    const std::string text(line, length);
+    if (text.find_first_not_of(" \t\r\n") == std::string::npos) {
+      continue;
+    }
+
+    raytracer::RenderJob job;
+    raytracer::RenderResult result;
+    std::string image;
+    if (google::protobuf::TextFormat::ParseFromString(text, &job)) {
+      Run(job, remote, &result, &image);
+    } else {
+      result.set_error("Failed to parse job");
+    }
+
+    std::string header;
+    printer.PrintToString(result, &header);
+    header += '\n';
+    success = fwrite(header.data(), 1, header.size(), output) == header.size()
+        && fwrite(image.data(), 1, image.size(), output) == image.size()
+        && fflush(output) == 0;
+  }
+  free(line);
+  return success;
+}
+
+bool RenderServer::ServeSocket(const std::string& path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    LOG(ERROR) << "Socket path too long: " << path;
+    return false;
+  }
+  strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  // Remove a socket left behind by an earlier server, but nothing else.
+  struct stat path_stat;
+  if (stat(path.c_str(), &path_stat) == 0 && S_ISSOCK(path_stat.st_mode)) {
+    unlink(path.c_str());
+  }
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 ||
+      bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+      listen(listener, 8) != 0) {
+    LOG(ERROR) << "Failed to listen on socket " << path << ": "
+               << strerror(errno);
+    if (listener >= 0) {
+      close(listener);
+    }
+    return false;
+  }
+
+  LOG(INFO) << "Listening for render jobs on " << path;
+  ServeConnections(listener, false /* remote */);
+  return true;
+}
+
+bool RenderServer::ServePort(const std::string& address_string, int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, address_string.c_str(), &address.sin_addr) != 1) {
+    LOG(ERROR) << "Invalid IPv4 address: " << address_string;
+    return false;
+  }
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  if (listener < 0 ||
+      setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                 sizeof(reuse)) != 0 ||
+      bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+      listen(listener, 8) != 0) {
+    LOG(ERROR) << "Failed to listen on " << address_string << ":" << port
+               << ": " << strerror(errno);
+    if (listener >= 0) {
+      close(listener);
+    }
+    return false;
+  }
+
+  LOG(INFO) << "Listening for render jobs on " << address_string << ":" << port
+            << ", serving scenes in " << scene_dir_;
+  ServeConnections(listener, true /* remote */);
+  return true;
+}
+
+void RenderServer::ServeConnections(int listener, bool remote) {
+  // Clients disconnecting early must not terminate the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  while (true) {
+    int connection = accept(listener, NULL, NULL);
+    if (connection < 0) {
+      LOG(WARNING) << "Failed to accept connection: " << strerror(errno);
+      continue;
+    }
+    FILE* input = fdopen(connection, "r");
+    FILE* output = fdopen(dup(connection), "w");
+    if (input == NULL || output == NULL) {
+      LOG(WARNING) << "Failed to open connection streams";
+    } else if (!Serve(input, output, remote)) {
+      LOG(WARNING) << "Client disconnected before receiving all results";
+    }
+    if (input != NULL) {
+      fclose(input);
+    } else {
+      close(connection);
+    }
+    if (output != NULL) {
+      fclose(output);
+    }
+  }
+}
+
+bool RenderServer::InSceneDir(const std::string& path) const {
+  // Resolving both paths rules out escaping through ".." and symlinks.
+  char* dir = realpath(scene_dir_.c_str(), NULL);
+  char* file = realpath(path.c_str(), NULL);
+  bool inside = false;
+  if (dir != NULL && file != NULL) {
+    const std::string prefix = std::string(dir) + "/";
+    inside = std::string(file).compare(0, prefix.size(), prefix) == 0;
+  }
+  free(dir);
+  free(file);
+  return inside;
+}
+
+void RenderServer::Run(const raytracer::RenderJob& job, bool remote,
+                       raytracer::RenderResult* result, std::string* image) {
+  result->set_job_id(job.job_id());
+  LOG(INFO) << "Running job " << job.job_id() << " on " << job.scene_id();
+
+  if (remote && (job.has_output_path() ||
+                 HasOutputPath(job.renderer_config()))) {
+    result->set_error("Remote jobs may not set an output path");
+    return;
+  }
+  if (remote && !InSceneDir(job.scene_id())) {
+    result->set_error("Scene is not in the scene directory: " +
+                      job.scene_id());
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  raytracer::CameraData camera_data;
+  bool hit = false;
+  Scene* scene = scene_cache_.Get(job.scene_id(), &camera_data, &hit);
+  result->set_scene_cache_hit(hit);
+  result->set_load_seconds(SecondsSince(start));
+  if (scene == NULL) {
+    result->set_error("Failed to load scene: " + job.scene_id());
+    return;
+  }
+
+  camera_data.MergeFrom(job.camera());
+  Camera* camera = SceneParser::Parse(camera_data);
+  if (camera == NULL) {
+    result->set_error("Incomplete camera");
+    return;
+  }
+  scene->set_camera(camera);
+
+  raytracer::RendererConfig config(renderer_config_);
+  if (remote) {
+    MergeRemoteConfig(job.renderer_config(), &config);
+  } else {
+    config.MergeFrom(job.renderer_config());
+  }
+
+  // The result is encoded from the full image.
+  config.clear_band_height();
+
+  start = std::chrono::steady_clock::now();
+  std::unique_ptr<Renderer> renderer(Renderer::FromConfig(config));
+  if (job.has_output_path()) {
+    renderer->AddListener(new BmpExporter(job.output_path()));
+  } else {
+    renderer->AddListener(new ImageEncoder(job.image_format(), image));
+  }
+  renderer->Render(scene);
+  result->set_render_seconds(SecondsSince(start));
+  result->set_image_size(image->size());
+  result->set_success(true);
+}
+
+// static
+void RenderServer::EncodeRaw(const Image& image, std::string* data) {
+  data->resize(3 * sizeof(uint32_t) * image.SizeX() * image.SizeY());
+  char* out = &(*data)[0];
+  for (size_t y = 0; y < image.SizeY(); ++y) {
+    for (size_t x = 0; x < image.SizeX(); ++x) {
+      const Color3 pixel = image.PixelAt(x, y);
+      const float channels[3] = { float(pixel.r()), float(pixel.g()),
+                                  float(pixel.b()) };
+      for (size_t i = 0; i < 3; ++i) {
+        uint32_t bits;
+        memcpy(&bits, &channels[i], sizeof(bits));
+        for (size_t byte = 0; byte < sizeof(bits); ++byte) {
+          *out++ = char(bits >> (8 * byte));
+        }
+      }
+    }
+  }
+}
+
+// static
+bool RenderServer::DecodeRaw(const std::string& data, Image* image) {
+  if (data.size() != 3 * sizeof(uint32_t) * image->SizeX() * image->SizeY()) {
+    return false;
+  }
+  const unsigned char* in = (const unsigned char*) data.data();
+  for (size_t y = 0; y < image->SizeY(); ++y) {
+    for (size_t x = 0; x < image->SizeX(); ++x) {
+      float channels[3];
+      for (size_t i = 0; i < 3; ++i) {
+        uint32_t bits = 0;
+        for (size_t byte = 0; byte < sizeof(bits); ++byte) {
+          bits |= uint32_t(*in++) << (8 * byte);
+        }
+        memcpy(&channels[i], &bits, sizeof(bits));
+      }
+      image->PutPixel(Color3(channels[0], channels[1], channels[2]), x, y);
+    }
+  }
+  return true;
+}
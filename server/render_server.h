@@ -0,0 +1,109 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * A long-running server which renders jobs against scenes kept resident in
+ * memory. Warm jobs only pay for tracing rays, not for parsing the scene or
+ * building its KdTree.
+ * Author: Dino Wernli
+ */
+
+#ifndef RENDER_SERVER_H_
+#define RENDER_SERVER_H_
+
+#include <cstdio>
+#include <string>
+
+#include "proto/config/renderer_config.pb.h"
+#include "server/scene_cache.h"
+#include "util/no_copy_assign.h"
+
+class Image;
+
+namespace raytracer {
+class RenderJob;
+class RenderResult;
+class SceneConfig;
+}
+
+class RenderServer {
+ public:
+  // Scenes are built from "scene_config" as described in SceneCache and at
+  // most "cache_capacity" of them are kept resident. Every job is rendered
+  // with "renderer_config" merged with the overrides of the job.
+  RenderServer(const raytracer::SceneConfig& scene_config,
+               const raytracer::RendererConfig& renderer_config,
+               size_t cache_capacity);
+  virtual ~RenderServer();
+  NO_COPY_ASSIGN(RenderServer);
+
+  // Reads jobs from input until it ends and answers each of them on output.
+  // Every job is a RenderJob in text format on a single line. Every answer is
+  // a RenderResult in text format on a single line, directly followed by the
+  // "image_size" bytes of the image. Returns false if writing failed.
+  bool Serve(FILE* input, FILE* output);
+
+  // Listens on a Unix domain socket at path and serves one connection after
+  // the other. Returns false if the socket could not be set up, and never
+  // returns otherwise.
+  bool ServeSocket(const std::string& path);
+
+  // Like ServeSocket(), but listens for TCP connections on port at the IPv4
+  // address, e.g., "127.0.0.1". There is no authentication, so TCP clients
+  // may not set output paths and may only render scenes inside the scene
+  // directory. Of their renderer config, only the tile, the image quality
+  // settings and the light samples are used, and they get at most the
+  // configured number of threads.
+  bool ServePort(const std::string& address, int port);
+
+  // Renders a single job and fills in result. Unless the job has an output
+  // path, the encoded image is stored in "image". Jobs of remote clients are
+  // restricted as described in ServePort().
+  void Run(const raytracer::RenderJob& job, bool remote,
+           raytracer::RenderResult* result, std::string* image);
+
+  // Sets the directory from which remote clients may load scenes. Defaults to
+  // "data/scene".
+  void set_scene_dir(const std::string& dir) { scene_dir_ = dir; }
+  const std::string& scene_dir() const { return scene_dir_; }
+
+  // Converts between images and the RAW image format of render jobs. Decoding
+  // returns false if data does not have the size of image.
+  static void EncodeRaw(const Image& image, std::string* data);
+  static bool DecodeRaw(const std::string& data, Image* image);
+
+ private:
+  // Like Serve(), but restricts the jobs if they come from a remote client.
+  bool Serve(FILE* input, FILE* output, bool remote);
+
+  // Accepts connections on the listening socket and serves them one after the
+  // other. Never returns.
+  void ServeConnections(int listener, bool remote);
+
+  // Returns whether the file at path lies inside the scene directory.
+  bool InSceneDir(const std::string& path) const;
+
+  SceneCache scene_cache_;
+  const raytracer::RendererConfig renderer_config_;
+  std::string scene_dir_;
+};
+
+#endif  /* RENDER_SERVER_H_ */
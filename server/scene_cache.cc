@@ -0,0 +1,136 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Author: Dino Wernli
+ */
+
+#include "scene_cache.h"
+
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <utility>
+
+#include "parser/scene_parser.h"
+#include "proto/scene/camera_data.pb.h"
+#include "scene/scene.h"
+
+struct SceneCache::Entry {
+  std::string path;
+
+  // The modification time of the scene file when it was loaded.
+  struct timespec modified;
+
+  raytracer::CameraData camera;
+  std::unique_ptr<Scene> scene;
+};
+
+// Stores the modification time of the file at path in "modified". Returns
+// false if the file does not exist.
+static bool ModificationTime(const std::string& path,
+                             struct timespec* modified) {
+  struct stat path_stat;
+  if (stat(path.c_str(), &path_stat) != 0) {
+    return false;
+  }
+  *modified = path_stat.st_mtim;
+  return true;
+}
+
+SceneCache::SceneCache(const raytracer::SceneConfig& config, size_t capacity)
+    : config_(config), capacity_(capacity > 0 ? capacity : 1) {
+  if (capacity == 0) {
+    LOG(WARNING) << "Can't cache 0 scenes. Using 1 instead.";
+  }
+}
+
+SceneCache::~SceneCache() {
+}
+
+Scene* SceneCache::Get(const std::string& path, raytracer::CameraData* camera,
+                       bool* hit) {
+  if (hit != NULL) {
+    *hit = false;
+  }
+
+  struct timespec modified;
+  const bool exists = ModificationTime(path, &modified);
+
+  auto found = index_.find(path);
+  if (found != index_.end()) {
+    auto it = found->second;
+    const Entry& entry = **it;
+    if (exists && entry.modified.tv_sec == modified.tv_sec &&
+        entry.modified.tv_nsec == modified.tv_nsec) {
+      entries_.splice(entries_.begin(), entries_, it);
+      if (camera != NULL) {
+        camera->CopyFrom(entry.camera);
+      }
+      if (hit != NULL) {
+        *hit = true;
+      }
+      return entry.scene.get();
+    }
+
+    LOG(INFO) << "Scene file changed, dropping resident scene: " << path;
+    index_.erase(found);
+    entries_.erase(it);
+  }
+
+  if (!exists) {
+    LOG(WARNING) << "Scene file does not exist: " << path;
+    return NULL;
+  }
+
+  raytracer::SceneConfig config(config_);
+  if (!SceneParser::LoadTextProto(path, config.mutable_scene_data())) {
+    LOG(WARNING) << "Failed to load scene data from: " << path;
+    return NULL;
+  }
+
+  // Make room before loading so that the evicted scene's memory is released
+  // before the new one is built.
+  Shrink(capacity_ - 1);
+
+  std::unique_ptr<Entry> entry(new Entry());
+  entry->path = path;
+  entry->modified = modified;
+  entry->camera.CopyFrom(config.scene_data().camera());
+  entry->scene.reset(Scene::FromConfig(config));
+  entry->scene->Init();
+  LOG(INFO) << "Loaded resident scene: " << path;
+
+  if (camera != NULL) {
+    camera->CopyFrom(entry->camera);
+  }
+  Scene* scene = entry->scene.get();
+  entries_.push_front(std::move(entry));
+  index_[path] = entries_.begin();
+  return scene;
+}
+
+void SceneCache::Shrink(size_t size) {
+  while (entries_.size() > size) {
+    LOG(INFO) << "Evicting resident scene: " << entries_.back()->path;
+    index_.erase(entries_.back()->path);
+    entries_.pop_back();
+  }
+}
@@ -0,0 +1,80 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Keeps a bounded number of initialized scenes in memory. Scenes are
+ * identified by the path of their scene data file and evicted in least
+ * recently used order. A scene is reloaded if its file changed since it was
+ * loaded.
+ * Author: Dino Wernli
+ */
+
+#ifndef SCENE_CACHE_H_
+#define SCENE_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "proto/config/scene_config.pb.h"
+#include "util/no_copy_assign.h"
+
+namespace raytracer {
+class CameraData;
+}
+
+class Scene;
+
+class SceneCache {
+ public:
+  // Every scene is built from a copy of "config" with the scene data replaced
+  // by the contents of the scene file. At most "capacity" scenes are kept.
+  SceneCache(const raytracer::SceneConfig& config, size_t capacity);
+  virtual ~SceneCache();
+  NO_COPY_ASSIGN(SceneCache);
+
+  // Returns the initialized scene stored at path, loading it if it is not
+  // resident. Returns NULL if the scene could not be loaded. The cache retains
+  // ownership and the scene stays valid until the next call. If "camera" is
+  // not NULL, it receives the camera data of the scene file. If "hit" is not
+  // NULL, it is set to whether the scene was resident.
+  Scene* Get(const std::string& path, raytracer::CameraData* camera,
+             bool* hit);
+
+  size_t size() const { return entries_.size(); }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Entry;
+
+  // Removes least recently used entries until at most "size" remain.
+  void Shrink(size_t size);
+
+  const raytracer::SceneConfig config_;
+  const size_t capacity_;
+
+  // Ordered from most to least recently used.
+  std::list<std::unique_ptr<Entry>> entries_;
+  std::map<std::string, std::list<std::unique_ptr<Entry>>::iterator> index_;
+};
+
+#endif  /* SCENE_CACHE_H_ */
@@ -0,0 +1,398 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Author: Dino Wernli
+ */
+
+#include "tile_coordinator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <google/protobuf/text_format.h>
+#include <netdb.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "parser/scene_parser.h"
+#include "proto/scene/scene_data.pb.h"
+#include "proto/server/render_job.pb.h"
+#include "renderer/image.h"
+#include "renderer/sampler/scanline_sampler.h"
+#include "renderer/updatable.h"
+#include "server/render_server.h"
+
+extern char** environ;
+
+struct TileCoordinator::Worker {
+  std::string name;
+  FILE* input;
+  FILE* output;
+  pid_t pid;
+
+  // Whether the connection to the worker is still usable.
+  bool alive;
+};
+
+// Returns the connected socket for the Unix domain socket at path, or -1.
+static int ConnectUnix(const std::string& path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd >= 0 &&
+      connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Returns the connected socket for "<host>:<port>", or -1.
+static int ConnectTcp(const std::string& address) {
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    return -1;
+  }
+  const std::string host = address.substr(0, colon);
+  const std::string port = address.substr(colon + 1);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addresses = NULL;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+    return -1;
+  }
+
+  int fd = -1;
+  for (struct addrinfo* it = addresses; it != NULL && fd < 0;
+       it = it->ai_next) {
+    fd = socket(it->ai_family, it->ai_socktype | SOCK_CLOEXEC,
+                it->ai_protocol);
+    if (fd >= 0 && connect(fd, it->ai_addr, it->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  return fd;
+}
+
+TileCoordinator::TileCoordinator(size_t tile_size)
+    : tile_size_(tile_size > 0 ? tile_size : 1), remaining_tiles_(0),
+      live_workers_(0), failed_(false) {
+}
+
+TileCoordinator::~TileCoordinator() {
+  for (auto it = workers_.begin(); it != workers_.end(); ++it) {
+    Worker& worker = **it;
+    fclose(worker.input);
+    fclose(worker.output);
+
+    // Spawned workers exit once their input is closed.
+    if (worker.pid > 0) {
+      waitpid(worker.pid, NULL, 0);
+    }
+  }
+}
+
+bool TileCoordinator::SpawnWorker(const std::string& binary,
+                                  const std::vector<std::string>& arguments) {
+  // All descriptors are closed on exec. Otherwise, later workers would inherit
+  // the pipes of earlier ones and keep them from seeing the end of their input.
+  int to_worker[2];
+  int from_worker[2];
+  if (pipe2(to_worker, O_CLOEXEC) != 0) {
+    return false;
+  }
+  if (pipe2(from_worker, O_CLOEXEC) != 0) {
+    close(to_worker[0]);
+    close(to_worker[1]);
+    return false;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, to_worker[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, from_worker[1], STDOUT_FILENO);
+
+  std::vector<char*> argv;
+  argv.push_back(const_cast<char*>(binary.c_str()));
+  for (const std::string& argument : arguments) {
+    argv.push_back(const_cast<char*>(argument.c_str()));
+  }
+  argv.push_back(NULL);
+
+  pid_t pid = 0;
+  const int error = posix_spawn(&pid, binary.c_str(), &actions, NULL,
+                                &argv[0], environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(to_worker[0]);
+  close(from_worker[1]);
+  if (error != 0) {
+    LOG(WARNING) << "Failed to spawn worker " << binary << ": "
+                 << strerror(error);
+    close(to_worker[1]);
+    close(from_worker[0]);
+    return false;
+  }
+  return AddWorker(from_worker[0], to_worker[1], pid,
+                   "process " + std::to_string(pid));
+}
+
+bool TileCoordinator::ConnectWorker(const std::string& address) {
+  const int fd = address.find('/') != std::string::npos ?
+      ConnectUnix(address) : ConnectTcp(address);
+  if (fd < 0) {
+    LOG(WARNING) << "Failed to connect to worker " << address;
+    return false;
+  }
+  return AddWorker(fd, address);
+}
+
+bool TileCoordinator::AddWorker(int fd, const std::string& name) {
+  const int output_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (output_fd < 0) {
+    close(fd);
+    return false;
+  }
+  return AddWorker(fd, output_fd, 0, name);
+}
+
+bool TileCoordinator::AddWorker(int input_fd, int output_fd, pid_t pid,
+                                const std::string& name) {
+  FILE* input = fdopen(input_fd, "r");
+  FILE* output = fdopen(output_fd, "w");
+  if (input == NULL || output == NULL) {
+    LOG(WARNING) << "Failed to open streams for worker " << name;
+    input == NULL ? close(input_fd) : fclose(input);
+    output == NULL ? close(output_fd) : fclose(output);
+    if (pid > 0) {
+      kill(pid, SIGTERM);
+      waitpid(pid, NULL, 0);
+    }
+    return false;
+  }
+
+  std::unique_ptr<Worker> worker(new Worker());
+  worker->name = name;
+  worker->input = input;
+  worker->output = output;
+  worker->pid = pid;
+  worker->alive = true;
+  workers_.push_back(std::move(worker));
+  LOG(INFO) << "Added worker " << name;
+  return true;
+}
+
+void TileCoordinator::AddListener(Updatable* listener) {
+  listeners_.push_back(std::unique_ptr<Updatable>(listener));
+}
+
+bool TileCoordinator::Render(const raytracer::RenderJob& job) {
+  raytracer::SceneData scene_data;
+  if (!SceneParser::LoadTextProto(job.scene_id(), &scene_data)) {
+    LOG(ERROR) << "Failed to load scene data from: " << job.scene_id();
+    return false;
+  }
+  raytracer::CameraData camera(scene_data.camera());
+  camera.MergeFrom(job.camera());
+
+  ScanlineSampler sampler(true);
+  sampler.Init(camera.resolution_x(), camera.resolution_y());
+
+  // Workers which died writing to their connection must not terminate us.
+  signal(SIGPIPE, SIG_IGN);
+
+  tiles_.clear();
+  for (size_t y = 0; y < sampler.height(); y += tile_size_) {
+    for (size_t x = 0; x < sampler.width(); x += tile_size_) {
+      raytracer::TileData tile;
+      tile.set_x(x);
+      tile.set_y(y);
+      tile.set_width(std::min(tile_size_, sampler.width() - x));
+      tile.set_height(std::min(tile_size_, sampler.height() - y));
+      tiles_.push_back(tile);
+    }
+  }
+  remaining_tiles_ = tiles_.size();
+  failed_ = false;
+  LOG(INFO) << "Distributing " << tiles_.size() << " tiles";
+
+  for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+    it->get()->Started(sampler);
+  }
+
+  std::vector<std::thread> threads;
+  live_workers_ = 0;
+  for (auto it = workers_.begin(); it != workers_.end(); ++it) {
+    if ((*it)->alive) {
+      ++live_workers_;
+      threads.push_back(std::thread(&TileCoordinator::WorkerMain, this,
+                                    it->get(), job, &sampler));
+    }
+  }
+
+  bool success;
+  {
+    std::unique_lock<std::mutex> guard(lock_);
+    while (remaining_tiles_ > 0 && live_workers_ > 0 && !failed_) {
+      changed_.wait_for(guard, std::chrono::milliseconds(kSleepTimeMilli));
+      guard.unlock();
+      for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+        it->get()->Updated(sampler);
+      }
+      guard.lock();
+    }
+    success = remaining_tiles_ == 0;
+
+    // Makes the threads of the remaining workers return.
+    failed_ = !success;
+    tiles_.clear();
+  }
+  changed_.notify_all();
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+
+  // Dead workers are never used again.
+  for (auto it = workers_.begin(); it != workers_.end();) {
+    if ((*it)->alive) {
+      ++it;
+      continue;
+    }
+    fclose((*it)->input);
+    fclose((*it)->output);
+    if ((*it)->pid > 0) {
+      waitpid((*it)->pid, NULL, 0);
+    }
+    it = workers_.erase(it);
+  }
+
+  if (!success) {
+    LOG(ERROR) << "Distributed rendering failed with "
+               << remaining_tiles_ << " tiles left";
+    return false;
+  }
+  for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
+    it->get()->Ended(sampler);
+  }
+  return true;
+}
+
+void TileCoordinator::WorkerMain(Worker* worker,
+                                 const raytracer::RenderJob& job,
+                                 Sampler* sampler) {
+  google::protobuf::TextFormat::Printer printer;
+  printer.SetSingleLineMode(true);
+  raytracer::RenderJob tile_job(job);
+  tile_job.clear_output_path();
+  tile_job.set_image_format(raytracer::RenderJob::RAW);
+
+  char* line = NULL;
+  size_t capacity = 0;
+  while (true) {
+    raytracer::TileData tile;
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+
+      // Tiles of failing workers can be put back, so wait for all of them.
+      changed_.wait(guard, [this]() {
+        return !tiles_.empty() || remaining_tiles_ == 0 || failed_;
+      });
+      if (tiles_.empty() || failed_) {
+        break;
+      }
+      tile = tiles_.front();
+      tiles_.pop_front();
+    }
+
+    tile_job.set_job_id(std::to_string(tile.x()) + "," +
+                        std::to_string(tile.y()));
+    tile_job.mutable_renderer_config()->mutable_tile()->CopyFrom(tile);
+    std::string request;
+    printer.PrintToString(tile_job, &request);
+    request += '\n';
+
+    raytracer::RenderResult result;
+    std::string data;
+    ssize_t length;
+    bool received =
+        fwrite(request.data(), 1, request.size(), worker->output) ==
+            request.size() &&
+        fflush(worker->output) == 0 &&
+        (length = getline(&line, &capacity, worker->input)) >= 0 &&
+        google::protobuf::TextFormat::ParseFromString(
+            std::string(line, length), &result);
+    if (received) {
+      data.resize(result.image_size());
+      received = data.empty() ||
+          fread(&data[0], 1, data.size(), worker->input) == data.size();
+    }
+
+    if (!received) {
+      LOG(WARNING) << "Lost worker " << worker->name << ", retrying tile "
+                   << tile_job.job_id() << " elsewhere";
+      std::lock_guard<std::mutex> guard(lock_);
+      worker->alive = false;
+      --live_workers_;
+      tiles_.push_back(tile);
+      changed_.notify_all();
+      break;
+    }
+
+    Image image(tile.width(), tile.height());
+    if (!result.success() || !RenderServer::DecodeRaw(data, &image)) {
+      LOG(ERROR) << "Worker " << worker->name << " failed to render tile "
+                 << tile_job.job_id() << ": " << result.error();
+      std::lock_guard<std::mutex> guard(lock_);
+      failed_ = true;
+      changed_.notify_all();
+      break;
+    }
+
+    sampler->AcceptTile(image, tile.x(), tile.y());
+    std::lock_guard<std::mutex> guard(lock_);
+    --remaining_tiles_;
+    changed_.notify_all();
+  }
+  free(line);
+}
+
+// static
+const size_t TileCoordinator::kSleepTimeMilli = 300;
@@ -0,0 +1,115 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Distributes the rendering of an image across several render servers. The
+ * image is split into square tiles which are handed out to the servers as
+ * they become idle. Every server keeps the scene resident, so it is only
+ * loaded once per server. Tiles given to a server which disconnects or dies
+ * are handed to the remaining servers.
+ * Author: Dino Wernli
+ */
+
+#ifndef TILE_COORDINATOR_H_
+#define TILE_COORDINATOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "proto/config/renderer_config.pb.h"
+#include "util/no_copy_assign.h"
+
+namespace raytracer {
+class RenderJob;
+}
+
+class Sampler;
+class Updatable;
+
+class TileCoordinator {
+ public:
+  // Splits images into tiles of tile_size by tile_size pixels.
+  explicit TileCoordinator(size_t tile_size);
+
+  // Disconnects from all workers and waits for spawned workers to exit.
+  virtual ~TileCoordinator();
+  NO_COPY_ASSIGN(TileCoordinator);
+
+  // Starts a render server by running binary with arguments, and talks to it
+  // over its standard input and output. Returns false on failure.
+  bool SpawnWorker(const std::string& binary,
+                   const std::vector<std::string>& arguments);
+
+  // Connects to a render server listening on address, which is either the
+  // path of a Unix domain socket or "<host>:<port>". Returns false on failure.
+  bool ConnectWorker(const std::string& address);
+
+  // Uses the render server at the other end of the connected socket fd. Takes
+  // ownership of fd. Returns false on failure.
+  bool AddWorker(int fd, const std::string& name);
+
+  // Takes ownership of the passed listener.
+  void AddListener(Updatable* listener);
+
+  // Renders the image described by job on the workers and reports it to the
+  // listeners. The scene id must be valid on the workers as well as locally,
+  // where it is used to determine the resolution. Returns false if the job
+  // failed or no worker was left to render the remaining tiles.
+  bool Render(const raytracer::RenderJob& job);
+
+  size_t num_workers() const { return workers_.size(); }
+
+ private:
+  struct Worker;
+
+  // Adds a worker communicating over the passed file descriptors, of which it
+  // takes ownership. The argument "pid" is the process to wait for on
+  // destruction, or 0.
+  bool AddWorker(int input_fd, int output_fd, pid_t pid,
+                 const std::string& name);
+
+  // Serves as the method passed to threads. Hands tiles to the worker until
+  // there are none left or the worker fails.
+  void WorkerMain(Worker* worker, const raytracer::RenderJob& job,
+                  Sampler* sampler);
+
+  const size_t tile_size_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::unique_ptr<Updatable>> listeners_;
+
+  // The state of the current rendering, guarded by lock_.
+  std::deque<raytracer::TileData> tiles_;
+  size_t remaining_tiles_;
+  size_t live_workers_;
+  bool failed_;
+  std::mutex lock_;
+  std::condition_variable changed_;
+
+  // The time between two updates of the listeners.
+  static const size_t kSleepTimeMilli;
+};
+
+#endif  /* TILE_COORDINATOR_H_ */
@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the ExrExporter class.
+ * Author: Dino Wernli
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "listener/exr_exporter.h"
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
+
+namespace {
+
+template<typename T>
+T Read(const std::string& data, size_t offset) {
+  T value;
+  memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
+}
+
+// Parses the header of the file, returns the offset past the header.
+size_t ParseHeader(const std::string& file,
+                   std::map<std::string, std::string>* attributes) {
+  EXPECT_EQ(std::string("\x76\x2f\x31\x01\x02\0\0\0", 8), file.substr(0, 8));
+  size_t offset = 8;
+  while (file[offset] != '\0') {
+    const std::string name(file.c_str() + offset);
+    offset += name.size() + 1;
+    const std::string type(file.c_str() + offset);
+    offset += type.size() + 1;
+    const int32_t size = Read<int32_t>(file, offset);
+    (*attributes)[name] = file.substr(offset + 4, size);
+    offset += 4 + size;
+  }
+  return offset + 1;
+}
+
+// Returns the half precision values of the file, line by line from the top,
+// with the channels of a line in the order B, G, R.
+std::vector<uint16_t> Decode(const std::string& file, size_t width,
+                             size_t height) {
+  std::map<std::string, std::string> attributes;
+  size_t offset = ParseHeader(file, &attributes);
+  EXPECT_EQ(std::string(1, 3), attributes["compression"]);
+  EXPECT_EQ(int32_t(width - 1), Read<int32_t>(attributes["dataWindow"], 8));
+  EXPECT_EQ(int32_t(height - 1), Read<int32_t>(attributes["dataWindow"], 12));
+
+  const size_t lines_per_block = ExrExporter::kLinesPerBlock;
+  const size_t blocks = (height + lines_per_block - 1) / lines_per_block;
+  std::vector<uint16_t> values;
+  for (size_t i = 0; i < blocks; ++i) {
+    const uint64_t block = Read<uint64_t>(file, offset + 8 * i);
+    EXPECT_EQ(int32_t(i * lines_per_block), Read<int32_t>(file, block));
+    const int32_t size = Read<int32_t>(file, block + 4);
+    const std::string data = file.substr(block + 8, size);
+
+    const size_t lines = std::min(lines_per_block, height - i * lines_per_block);
+    std::string raw(lines * 3 * width * sizeof(uint16_t), '\0');
+    if (data.size() < raw.size()) {
+      std::string predicted(raw.size(), '\0');
+      uLongf length = predicted.size();
+      EXPECT_EQ(Z_OK, uncompress((Bytef*)&predicted[0], &length,
+                                 (const Bytef*)data.data(), data.size()));
+      for (size_t j = 1; j < predicted.size(); ++j) {
+        predicted[j] = predicted[j - 1] + predicted[j] - 128;
+      }
+      const size_t half = (raw.size() + 1) / 2;
+      for (size_t j = 0; j < raw.size(); ++j) {
+        raw[j] = predicted[j % 2 == 0 ? j / 2 : half + j / 2];
+      }
+    } else {
+      raw = data;
+    }
+    for (size_t j = 0; j < raw.size(); j += 2) {
+      values.push_back(Read<uint16_t>(raw, j));
+    }
+  }
+  return values;
+}
+
+void ExpectRoundTrip(const Image& image) {
+  std::stringstream stream;
+  ExrExporter::Write(image, &stream);
+
+  const size_t width = image.SizeX();
+  const size_t height = image.SizeY();
+  std::vector<uint16_t> values = Decode(stream.str(), width, height);
+  ASSERT_EQ(3 * width * height, values.size());
+
+  std::vector<uint16_t> expected(3 * width);
+  for (size_t line = 0; line < height; ++line) {
+    ImageKernels::ToHalf(image.RawData() + (height - line - 1) * 3 * width,
+                         3 * width, expected.data());
+    for (size_t x = 0; x < width; ++x) {
+      for (size_t channel = 0; channel < 3; ++channel) {
+        EXPECT_EQ(expected[3 * x + channel],
+                  values[(line * 3 + 2 - channel) * width + x])
+            << "pixel " << x << ", line " << line;
+      }
+    }
+  }
+}
+
+TEST(ExrExporter, KeepsUnclampedValues) {
+  Image image(3, 2);
+  image.PutPixel(Color3(1, 0.5, 0), 0, 0);
+  image.PutPixel(Color3(20, -1, 0.25), 2, 1);
+  ExpectRoundTrip(image);
+}
+
+TEST(ExrExporter, SeveralBlocks) {
+  Image image(37, 50);
+  for (size_t x = 0; x < image.SizeX(); ++x) {
+    for (size_t y = 0; y < image.SizeY(); ++y) {
+      image.PutPixel(Color3(Intensity(x) / image.SizeX(), y, 0.5), x, y);
+    }
+  }
+  ExpectRoundTrip(image);
+}
+
+}  // namespace
@@ -0,0 +1,145 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the PngExporter class.
+ * Author: Dino Wernli
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "listener/png_exporter.h"
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
+
+namespace {
+
+uint32_t ReadUint32(const std::string& data, size_t offset) {
+  return (uint32_t((unsigned char)data[offset]) << 24) |
+         (uint32_t((unsigned char)data[offset + 1]) << 16) |
+         (uint32_t((unsigned char)data[offset + 2]) << 8) |
+         uint32_t((unsigned char)data[offset + 3]);
+}
+
+// Returns the unfiltered rows of the PNG file, top to bottom.
+std::vector<unsigned char> Decode(const std::string& file, size_t* width,
+                                  size_t* height) {
+  EXPECT_EQ(std::string("\x89PNG\r\n\x1a\n"), file.substr(0, 8));
+  std::string compressed;
+  for (size_t offset = 8; offset < file.size();) {
+    const size_t size = ReadUint32(file, offset);
+    const std::string type = file.substr(offset + 4, 4);
+    const std::string data = file.substr(offset + 8, size);
+    EXPECT_EQ(crc32(crc32(0, (const Bytef*)type.data(), 4),
+                    (const Bytef*)data.data(), size),
+              ReadUint32(file, offset + 8 + size)) << type;
+    if (type == "IHDR") {
+      *width = ReadUint32(data, 0);
+      *height = ReadUint32(data, 4);
+    } else if (type == "IDAT") {
+      compressed += data;
+    }
+    offset += 12 + size;
+  }
+
+  const size_t row_size = 3 * *width;
+  std::vector<unsigned char> filtered((row_size + 1) * *height);
+  uLongf size = filtered.size();
+  EXPECT_EQ(Z_OK, uncompress(filtered.data(), &size,
+                             (const Bytef*)compressed.data(),
+                             compressed.size()));
+  EXPECT_EQ(filtered.size(), size);
+
+  std::vector<unsigned char> rows(row_size * *height);
+  for (size_t y = 0; y < *height; ++y) {
+    const unsigned char* in = &filtered[y * (row_size + 1)];
+    unsigned char* row = &rows[y * row_size];
+    for (size_t i = 0; i < row_size; ++i) {
+      const int a = i >= 3 ? row[i - 3] : 0;
+      const int b = y > 0 ? row[i - row_size] : 0;
+      const int c = i >= 3 && y > 0 ? row[i - 3 - row_size] : 0;
+      int predictor = 0;
+      switch (in[0]) {
+        case 1: predictor = a; break;
+        case 2: predictor = b; break;
+        case 3: predictor = (a + b) / 2; break;
+        case 4: {
+          const int p = a + b - c;
+          const int pa = std::abs(p - a), pb = std::abs(p - b);
+          const int pc = std::abs(p - c);
+          predictor = pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+          break;
+        }
+      }
+      row[i] = in[1 + i] + predictor;
+    }
+  }
+  return rows;
+}
+
+void ExpectRoundTrip(const Image& image) {
+  std::stringstream stream;
+  PngExporter::Write(image, &stream);
+
+  size_t width = 0, height = 0;
+  std::vector<unsigned char> rows = Decode(stream.str(), &width, &height);
+  ASSERT_EQ(image.SizeX(), width);
+  ASSERT_EQ(image.SizeY(), height);
+
+  const size_t row_size = 3 * width;
+  std::vector<unsigned char> expected(row_size);
+  for (size_t y = 0; y < height; ++y) {
+    ImageKernels::Quantize(image.RawData() + (height - y - 1) * row_size,
+                           row_size, expected.data());
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(),
+                           rows.begin() + y * row_size)) << "row " << y;
+  }
+}
+
+TEST(PngExporter, SmallImage) {
+  Image image(5, 3);
+  image.PutPixel(Color3(1, 0.5, 0), 0, 0);
+  image.PutPixel(Color3(2, -1, 0.25), 4, 2);
+  ExpectRoundTrip(image);
+}
+
+TEST(PngExporter, ManyCompressedChunks) {
+  // Large enough to be deflated in several chunks.
+  Image image(301, 400);
+  for (size_t x = 0; x < image.SizeX(); ++x) {
+    for (size_t y = 0; y < image.SizeY(); ++y) {
+      image.PutPixel(Color3(Intensity(x) / image.SizeX(),
+                            Intensity((x * y) % 17) / 16,
+                            (x + y) % 2), x, y);
+    }
+  }
+  ExpectRoundTrip(image);
+}
+
+}  // namespace
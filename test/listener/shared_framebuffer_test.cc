@@ -0,0 +1,242 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the SharedFramebuffer class.
+ * Author: Dino Wernli
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "listener/shared_framebuffer.h"
+#include "renderer/image.h"
+#include "renderer/sampler/sample.h"
+#include "renderer/sampler/scanline_sampler.h"
+
+namespace {
+
+typedef SharedFramebuffer::Header Header;
+
+// Maps the segment read-only, the way an external preview tool would.
+class Reader {
+ public:
+  explicit Reader(const std::string& name) : segment_(NULL), size_(0) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+      size_ = info.st_size;
+      void* segment = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+      segment_ = segment == MAP_FAILED ? NULL : static_cast<char*>(segment);
+    }
+    close(fd);
+  }
+
+  ~Reader() {
+    if (segment_ != NULL) {
+      munmap(segment_, size_);
+    }
+  }
+
+  bool valid() const { return segment_ != NULL; }
+  const Header& header() const { return *reinterpret_cast<Header*>(segment_); }
+
+  uint32_t generation() const { return header().generation.load(); }
+
+  // Returns whether the tile changed after the passed generation.
+  bool ChangedSince(size_t tile_x, size_t tile_y, uint32_t generation) const {
+    const uint32_t* tile_generations = reinterpret_cast<const uint32_t*>(
+        segment_ + header().tile_generations_offset);
+    return tile_generations[tile_y * header().tiles_x + tile_x] > generation;
+  }
+
+  float Red(size_t x, size_t y) const {
+    const float* pixels = reinterpret_cast<const float*>(
+        segment_ + header().pixels_offset);
+    return pixels[3 * (y * header().width + x)];
+  }
+
+ private:
+  char* segment_;
+  size_t size_;
+};
+
+class SharedFramebufferTest : public ::testing::Test {
+ protected:
+  SharedFramebufferTest()
+      : name_("/raytracer_test_" + std::to_string(getpid())) {
+  }
+
+  // Accepts the next job of the sampler with all pixels colored red.
+  size_t AcceptJob(Sampler* sampler) {
+    std::vector<Sample> samples(sampler->MaxJobSize());
+    size_t n = sampler->NextJob(&samples);
+    for (size_t i = 0; i < n; ++i) {
+      samples[i].set_color(Color3(1, 0, 0));
+    }
+    sampler->AcceptJob(samples, n);
+    return n;
+  }
+
+  const std::string name_;
+};
+
+TEST_F(SharedFramebufferTest, PublishesChangedTiles) {
+  ScanlineSampler sampler(false);
+  sampler.Init(40, 20);
+  std::unique_ptr<SharedFramebuffer> framebuffer(
+      new SharedFramebuffer(name_, 32));
+  framebuffer->Started(sampler);
+
+  Reader reader(name_);
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(SharedFramebuffer::kMagic, reader.header().magic);
+  EXPECT_EQ(40, reader.header().width);
+  EXPECT_EQ(20, reader.header().height);
+  EXPECT_EQ(2, reader.header().tiles_x);
+  EXPECT_EQ(1, reader.header().tiles_y);
+  EXPECT_EQ(SharedFramebuffer::RENDERING, reader.header().state.load());
+  const uint32_t started = reader.generation();
+  EXPECT_EQ(0, started % 2);
+
+  // Only the first pixels of the bottom row are rendered.
+  AcceptJob(&sampler);
+  framebuffer->Updated(sampler);
+  const uint32_t updated = reader.generation();
+  EXPECT_EQ(started + 2, updated);
+  EXPECT_TRUE(reader.ChangedSince(0, 0, started));
+  EXPECT_FALSE(reader.ChangedSince(1, 0, started));
+  EXPECT_EQ(1, reader.Red(0, 0));
+  EXPECT_EQ(0, reader.Red(39, 19));
+
+  // Nothing changed since the last update.
+  framebuffer->Updated(sampler);
+  EXPECT_FALSE(reader.ChangedSince(0, 0, updated));
+
+  while (AcceptJob(&sampler) > 0) {}
+  framebuffer->Ended(sampler);
+  EXPECT_EQ(SharedFramebuffer::DONE, reader.header().state.load());
+  EXPECT_TRUE(reader.ChangedSince(1, 0, updated));
+  EXPECT_EQ(1, reader.Red(39, 19));
+  EXPECT_FLOAT_EQ(1, reader.header().progress.load());
+
+  // The segment is removed with the framebuffer, existing mappings stay valid.
+  framebuffer.reset();
+  EXPECT_EQ(SharedFramebuffer::STALE, reader.header().state.load());
+  EXPECT_FALSE(Reader(name_).valid());
+}
+
+TEST_F(SharedFramebufferTest, PublishesBands) {
+  ScanlineSampler sampler(false, 4);
+  sampler.Init(10, 12);
+  SharedFramebuffer framebuffer(name_, 4);
+  framebuffer.Started(sampler);
+  Reader reader(name_);
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(3, reader.header().tiles_x);
+  EXPECT_EQ(3, reader.header().tiles_y);
+  const uint32_t started = reader.generation();
+
+  while (AcceptJob(&sampler) > 0) {
+    std::unique_ptr<Image> band;
+    size_t y;
+    while (sampler.PopCompletedBand(&band, &y)) {
+      const uint32_t previous = reader.generation();
+      framebuffer.RowsCompleted(sampler, *band, y);
+      for (size_t tile_x = 0; tile_x < 3; ++tile_x) {
+        EXPECT_TRUE(reader.ChangedSince(tile_x, y / 4, previous));
+        EXPECT_FALSE(reader.ChangedSince(tile_x, (y / 4 + 1) % 3, previous));
+      }
+      EXPECT_EQ(1, reader.Red(9, y + 3));
+    }
+  }
+
+  // A reader which skipped all bands still finds every tile changed.
+  for (size_t tile_y = 0; tile_y < 3; ++tile_y) {
+    for (size_t tile_x = 0; tile_x < 3; ++tile_x) {
+      EXPECT_TRUE(reader.ChangedSince(tile_x, tile_y, started));
+    }
+  }
+}
+
+TEST_F(SharedFramebufferTest, ReplacesSegmentOnResize) {
+  ScanlineSampler sampler(false);
+  SharedFramebuffer framebuffer(name_);
+  sampler.Init(8, 8);
+  framebuffer.Started(sampler);
+  Reader old_reader(name_);
+  ASSERT_TRUE(old_reader.valid());
+
+  sampler.Init(16, 4);
+  framebuffer.Started(sampler);
+  EXPECT_EQ(SharedFramebuffer::STALE, old_reader.header().state.load());
+  Reader reader(name_);
+  ASSERT_TRUE(reader.valid());
+  EXPECT_EQ(16, reader.header().width);
+  EXPECT_EQ(SharedFramebuffer::RENDERING, reader.header().state.load());
+}
+
+#ifdef __linux__
+TEST_F(SharedFramebufferTest, WakesWaitingReaders) {
+  ScanlineSampler sampler(false);
+  sampler.Init(8, 8);
+  SharedFramebuffer framebuffer(name_);
+  framebuffer.Started(sampler);
+  Reader reader(name_);
+  ASSERT_TRUE(reader.valid());
+
+  const uint32_t generation = reader.header().generation.load();
+  long result = -1;
+  int error = 0;
+  std::thread waiter([&]() {
+    struct timespec timeout = { 10, 0 };
+    result = syscall(SYS_futex, &reader.header().generation, FUTEX_WAIT,
+                     generation, &timeout, NULL, 0);
+    error = errno;
+  });
+  AcceptJob(&sampler);
+  framebuffer.Updated(sampler);
+  waiter.join();
+
+  // The waiter was either woken up, or saw the new generation right away.
+  EXPECT_TRUE(result == 0 || error == EAGAIN) << "errno " << error;
+  EXPECT_EQ(generation + 2, reader.header().generation.load());
+}
+#endif
+
+}  // namespace
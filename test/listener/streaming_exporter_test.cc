@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the StreamingExporter class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "listener/bmp_exporter.h"
+#include "listener/streaming_exporter.h"
+#include "renderer/image.h"
+#include "renderer/sampler/sample.h"
+#include "renderer/sampler/scanline_sampler.h"
+
+namespace {
+
+class StreamingExporterTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    char path[] = "/tmp/streaming_exporter_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    path_ = path;
+  }
+
+  virtual void TearDown() {
+    unlink(path_.c_str());
+  }
+
+  // Renders a gradient with the sampler, handing every completed band to the
+  // exporter in reverse order. Returns the resulting image.
+  Image Render(Sampler* sampler, StreamingExporter* exporter, size_t width,
+               size_t height) {
+    Image image(width, height);
+    sampler->Init(width, height);
+    exporter->Started(*sampler);
+
+    std::vector<Sample> samples(sampler->MaxJobSize());
+    size_t n;
+    while ((n = sampler->NextJob(&samples)) > 0) {
+      for (size_t i = 0; i < n; ++i) {
+        Sample& sample = samples[i];
+        sample.set_color(Color3(Intensity(sample.x()) / width,
+                                Intensity(sample.y()) / height, 0.5));
+        image.PutPixel(sample.color(), sample.x(), sample.y());
+      }
+      sampler->AcceptJob(samples, n);
+    }
+
+    std::vector<std::pair<size_t, std::unique_ptr<Image>>> bands;
+    std::unique_ptr<Image> band;
+    size_t y;
+    while (sampler->PopCompletedBand(&band, &y)) {
+      bands.push_back(std::make_pair(y, std::move(band)));
+    }
+    for (auto it = bands.rbegin(); it != bands.rend(); ++it) {
+      exporter->RowsCompleted(*sampler, *it->second, it->first);
+    }
+    exporter->Ended(*sampler);
+    return image;
+  }
+
+  std::string ReadFile() const {
+    std::ifstream stream(path_, std::ifstream::binary);
+    return std::string(std::istreambuf_iterator<char>(stream),
+                       std::istreambuf_iterator<char>());
+  }
+
+  std::string path_;
+};
+
+TEST_F(StreamingExporterTest, BandsMatchBmpExporter) {
+  ScanlineSampler sampler(false, 3);
+  StreamingExporter exporter(path_, StreamingExporter::BMP);
+  Image image = Render(&sampler, &exporter, 7, 10);
+
+  std::stringstream expected;
+  BmpExporter::Write(image, &expected);
+  EXPECT_EQ(expected.str(), ReadFile());
+}
+
+TEST_F(StreamingExporterTest, FullImageMatchesBmpExporter) {
+  ScanlineSampler sampler(false);
+  StreamingExporter exporter(path_, StreamingExporter::BMP);
+  Image image = Render(&sampler, &exporter, 6, 4);
+
+  std::stringstream expected;
+  BmpExporter::Write(image, &expected);
+  EXPECT_EQ(expected.str(), ReadFile());
+}
+
+TEST_F(StreamingExporterTest, PpmRowsTopToBottom) {
+  ScanlineSampler sampler(false, 2);
+  StreamingExporter exporter(path_, StreamingExporter::PPM);
+  Image image = Render(&sampler, &exporter, 4, 5);
+
+  std::stringstream stream(ReadFile());
+  std::string magic;
+  size_t width, height, max_value;
+  stream >> magic >> width >> height >> max_value;
+  EXPECT_EQ("P3", magic);
+  EXPECT_EQ(4, width);
+  EXPECT_EQ(5, height);
+  EXPECT_EQ(255, max_value);
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      unsigned int r, g, b;
+      ASSERT_TRUE(stream >> r >> g >> b);
+      const Color3 color = image.PixelAt(x, height - y - 1);
+      EXPECT_EQ((unsigned int)(color.r() * 255), r);
+      EXPECT_EQ((unsigned int)(color.g() * 255), g);
+      EXPECT_EQ((unsigned int)(color.b() * 255), b);
+    }
+  }
+  unsigned int extra;
+  EXPECT_FALSE(stream >> extra);
+}
+
+}  // namespace
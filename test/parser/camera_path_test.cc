@@ -0,0 +1,105 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Unit tests for the CameraPath class.
+ * Author: Dino Wernli
+ */
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "parser/camera_path.h"
+#include "proto/scene/camera_data.pb.h"
+
+namespace {
+
+using raytracer::CameraData;
+using raytracer::CameraPathData;
+
+class CameraPathTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(
+        "position { x:0 y:0 z:-4 } view { x:0 y:0 z:1 } up { x:0 y:1 z:0 } "
+        "opening_angle: 30 resolution_x: 20 resolution_y: 10", &base_));
+  }
+
+  static CameraPathData Path(const std::string& text) {
+    CameraPathData path;
+    EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(text, &path));
+    return path;
+  }
+
+  CameraData base_;
+};
+
+TEST_F(CameraPathTest, EmptyPath) {
+  EXPECT_TRUE(CameraPath::Expand(CameraPathData(), base_).empty());
+}
+
+TEST_F(CameraPathTest, ExplicitCamerasInheritFromBase) {
+  std::vector<CameraData> cameras = CameraPath::Expand(
+      Path("cameras { resolution_x: 5 } "
+           "cameras { position { x:1 y:2 z:3 } }"), base_);
+  ASSERT_EQ(2, cameras.size());
+
+  EXPECT_EQ(5, cameras[0].resolution_x());
+  EXPECT_EQ(10, cameras[0].resolution_y());
+  EXPECT_EQ(-4, cameras[0].position().z());
+
+  EXPECT_EQ(20, cameras[1].resolution_x());
+  EXPECT_EQ(3, cameras[1].position().z());
+  EXPECT_EQ(30, cameras[1].opening_angle());
+}
+
+TEST_F(CameraPathTest, InterpolatesKeyframes) {
+  // The keyframes are deliberately out of order.
+  std::vector<CameraData> cameras = CameraPath::Expand(
+      Path("frames: 5 "
+           "keyframes { time: 2 camera { position { x:4 y:0 z:0 } } } "
+           "keyframes { time: 0 camera { position { x:0 y:0 z:0 } } } "
+           "keyframes { time: 1 camera { position { x:1 y:0 z:0 } "
+           "                             opening_angle: 50 } }"), base_);
+  ASSERT_EQ(5, cameras.size());
+
+  const double expected_x[] = { 0, 0.5, 1, 2.5, 4 };
+  const double expected_angle[] = { 30, 40, 50, 40, 30 };
+  for (size_t i = 0; i < cameras.size(); ++i) {
+    EXPECT_DOUBLE_EQ(expected_x[i], cameras[i].position().x());
+    EXPECT_DOUBLE_EQ(expected_angle[i], cameras[i].opening_angle());
+    EXPECT_EQ(20, cameras[i].resolution_x());
+    EXPECT_DOUBLE_EQ(1, cameras[i].view().z());
+  }
+}
+
+TEST_F(CameraPathTest, SingleFrame) {
+  std::vector<CameraData> cameras = CameraPath::Expand(
+      Path("frames: 1 keyframes { time: 3 camera { resolution_x: 7 } }"),
+      base_);
+  ASSERT_EQ(1, cameras.size());
+  EXPECT_EQ(7, cameras[0].resolution_x());
+  EXPECT_EQ(-4, cameras[0].position().z());
+}
+
+}  // namespace
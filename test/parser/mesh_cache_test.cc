@@ -0,0 +1,152 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the MeshCache class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "parser/mesh_cache.h"
+#include "scene/mesh.h"
+#include "test/test_util.h"
+
+namespace {
+
+class MeshCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    source_path_ = ::testing::TempDir() + "mesh_cache_test.obj";
+    cache_path_ = MeshCache::CachePath(source_path_);
+    std::ofstream(source_path_.c_str()) << "# Only used for timestamps.\n";
+
+    mesh_.AddPoint(Point3(0, 0, 0));
+    mesh_.AddPoint(Point3(1, 0, 0));
+    mesh_.AddPoint(Point3(0, 1, 0));
+    mesh_.AddPoint(Point3(1, 1, 0));
+    mesh_.AddNormal(Vector3(0, 0, 1));
+    mesh_.AddNormal(Vector3(0, 0, -1));
+    mesh_.AddTriangle(0, 0, 1, 0, 2, 1);
+    mesh_.AddTriangle(1, 1, 3, 1, 2, 0);
+
+    transformation_.applied = true;
+    transformation_.scale = 2;
+    transformation_.translation = Vector3(1, 2, 3);
+  }
+
+  virtual void TearDown() {
+    std::remove(source_path_.c_str());
+    std::remove(cache_path_.c_str());
+  }
+
+  // Sets the modification time of the file at path to now plus "seconds".
+  static void SetModificationTime(const std::string& path, long seconds) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    struct timeval times[2] = { now, now };
+    times[0].tv_sec += seconds;
+    times[1].tv_sec += seconds;
+    utimes(path.c_str(), times);
+  }
+
+  std::string source_path_;
+  std::string cache_path_;
+  Mesh mesh_;
+  MeshCache::Transformation transformation_;
+};
+
+TEST_F(MeshCacheTest, MissingCache) {
+  EXPECT_EQ(NULL, MeshCache::Load(cache_path_, source_path_, transformation_));
+}
+
+TEST_F(MeshCacheTest, RoundTrip) {
+  ASSERT_TRUE(MeshCache::Store(mesh_, transformation_, cache_path_));
+  std::unique_ptr<Mesh> loaded(
+      MeshCache::Load(cache_path_, source_path_, transformation_));
+  ASSERT_NE(nullptr, loaded.get());
+  EXPECT_TRUE(loaded->is_mapped());
+
+  ASSERT_EQ(mesh_.num_points(), loaded->num_points());
+  for (size_t i = 0; i < mesh_.num_points(); ++i) {
+    EXPECT_SCALAR_EQ(mesh_.points()[i].x(), loaded->points()[i].x());
+    EXPECT_SCALAR_EQ(mesh_.points()[i].y(), loaded->points()[i].y());
+    EXPECT_SCALAR_EQ(mesh_.points()[i].z(), loaded->points()[i].z());
+  }
+
+  ASSERT_EQ(mesh_.num_normals(), loaded->num_normals());
+  EXPECT_SCALAR_EQ(-1, loaded->normals()[1].z());
+
+  ASSERT_EQ(mesh_.num_triangles(), loaded->num_triangles());
+  const Mesh::TriangleDescriptor& t = loaded->triangles()[1];
+  EXPECT_EQ(1, t.p1);
+  EXPECT_EQ(1, t.n1);
+  EXPECT_EQ(3, t.p2);
+  EXPECT_EQ(2, t.p3);
+  EXPECT_EQ(0, t.n3);
+}
+
+TEST_F(MeshCacheTest, RejectsOutdatedCache) {
+  ASSERT_TRUE(MeshCache::Store(mesh_, transformation_, cache_path_));
+  SetModificationTime(source_path_, 10);
+  EXPECT_EQ(NULL, MeshCache::Load(cache_path_, source_path_, transformation_));
+}
+
+TEST_F(MeshCacheTest, RejectsOtherTransformation) {
+  ASSERT_TRUE(MeshCache::Store(mesh_, transformation_, cache_path_));
+  MeshCache::Transformation other = transformation_;
+  other.scale = 3;
+  EXPECT_EQ(NULL, MeshCache::Load(cache_path_, source_path_, other));
+  EXPECT_EQ(NULL, MeshCache::Load(cache_path_, source_path_,
+                                  MeshCache::Transformation()));
+}
+
+TEST_F(MeshCacheTest, RejectsTruncatedCache) {
+  ASSERT_TRUE(MeshCache::Store(mesh_, transformation_, cache_path_));
+  ASSERT_EQ(0, truncate(cache_path_.c_str(), 200));
+  EXPECT_EQ(NULL, MeshCache::Load(cache_path_, source_path_, transformation_));
+}
+
+TEST_F(MeshCacheTest, RejectsInvalidIndices) {
+  ASSERT_TRUE(MeshCache::Store(mesh_, transformation_, cache_path_));
+
+  // Point the first corner of the last triangle past the end of the points.
+  struct stat cache_stat;
+  ASSERT_EQ(0, stat(cache_path_.c_str(), &cache_stat));
+  std::fstream stream(cache_path_.c_str(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+  stream.seekp(cache_stat.st_size - sizeof(Mesh::TriangleDescriptor));
+  const uint32_t index = 4;
+  stream.write(reinterpret_cast<const char*>(&index), sizeof(index));
+  stream.close();
+
+  EXPECT_EQ(NULL, MeshCache::Load(cache_path_, source_path_, transformation_));
+}
+
+}  // namespace
@@ -0,0 +1,214 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the MeshParser class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "parser/mesh_parser.h"
+#include "scene/mesh.h"
+#include "test/test_util.h"
+
+namespace {
+
+class MeshParserTest : public ::testing::Test {
+ protected:
+  virtual void TearDown() {
+    std::remove(path_.c_str());
+  }
+
+  // Writes contents to a temporary file and parses it with the passed parser.
+  Mesh* Load(const std::string& contents, MeshParser* parser) {
+    path_ = ::testing::TempDir() + "mesh_parser_test.obj";
+    std::ofstream(path_.c_str()) << contents;
+    return parser->LoadFile(path_);
+  }
+
+  Mesh* Load(const std::string& contents) {
+    MeshParser parser;
+    return Load(contents, &parser);
+  }
+
+  std::string path_;
+};
+
+TEST_F(MeshParserTest, MissingFile) {
+  MeshParser parser;
+  EXPECT_EQ(NULL, parser.LoadFile("/nonexistent/mesh.obj"));
+}
+
+TEST_F(MeshParserTest, VerticesAndNormals) {
+  std::unique_ptr<Mesh> mesh(Load(
+      "# A comment with v and f in it.\n"
+      "v 1 2.5 -3e2\n"
+      "v\t-0.125   .5 1E-3\r\n"
+      "v 0 0 0\n"
+      "vn 0 0 1\n"
+      "vt 0.5 0.5\n"
+      "o object\n"
+      "f 1//1 2//1 3//1\n"));
+  ASSERT_NE(nullptr, mesh.get());
+
+  ASSERT_EQ(3, mesh->num_points());
+  EXPECT_SCALAR_EQ(1, mesh->points()[0].x());
+  EXPECT_SCALAR_EQ(2.5, mesh->points()[0].y());
+  EXPECT_SCALAR_EQ(-300, mesh->points()[0].z());
+  EXPECT_SCALAR_EQ(-0.125, mesh->points()[1].x());
+  EXPECT_SCALAR_EQ(0.5, mesh->points()[1].y());
+  EXPECT_SCALAR_EQ(0.001, mesh->points()[1].z());
+
+  ASSERT_EQ(1, mesh->num_normals());
+  EXPECT_SCALAR_EQ(1, mesh->normals()[0].z());
+
+  ASSERT_EQ(1, mesh->num_triangles());
+  const Mesh::TriangleDescriptor& t = mesh->triangles()[0];
+  EXPECT_EQ(0, t.p1);
+  EXPECT_EQ(1, t.p2);
+  EXPECT_EQ(2, t.p3);
+  EXPECT_EQ(0, t.n1);
+  EXPECT_EQ(0, t.n2);
+  EXPECT_EQ(0, t.n3);
+}
+
+TEST_F(MeshParserTest, IndexForms) {
+  std::unique_ptr<Mesh> mesh(Load(
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+      "vn 0 0 1\nvn 0 0 -1\n"
+      "vt 0 0\n"
+      "f 1/1/2 2/1/1 3/1/2\n"
+      "f 2/1 4/1 3/1\n"
+      "f 4 3 1\n"));
+  ASSERT_NE(nullptr, mesh.get());
+  ASSERT_EQ(3, mesh->num_triangles());
+
+  const Mesh::TriangleDescriptor& t1 = mesh->triangles()[0];
+  EXPECT_EQ(0, t1.p1);
+  EXPECT_EQ(1, t1.n1);
+  EXPECT_EQ(1, t1.p2);
+  EXPECT_EQ(0, t1.n2);
+
+  // Corners without normals get new normals after those of the file, one for
+  // each point, which are shared between faces.
+  const Mesh::TriangleDescriptor& t2 = mesh->triangles()[1];
+  EXPECT_EQ(1, t2.p1);
+  EXPECT_EQ(2, t2.n1);
+  EXPECT_EQ(3, t2.p2);
+  EXPECT_EQ(3, t2.n2);
+  EXPECT_EQ(2, t2.p3);
+  EXPECT_EQ(4, t2.n3);
+
+  const Mesh::TriangleDescriptor& t3 = mesh->triangles()[2];
+  EXPECT_EQ(3, t3.n1);
+  EXPECT_EQ(4, t3.n2);
+  EXPECT_EQ(0, t3.p3);
+  EXPECT_EQ(5, t3.n3);
+  EXPECT_EQ(6, mesh->num_normals());
+}
+
+TEST_F(MeshParserTest, NegativeIndices) {
+  std::unique_ptr<Mesh> mesh(Load(
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\n"
+      "f -3//-1 -2//-1 -1//-1\n"
+      "v 1 1 0\n"
+      "f -3//1 -1//1 -2//1\n"));
+  ASSERT_NE(nullptr, mesh.get());
+  ASSERT_EQ(2, mesh->num_triangles());
+
+  const Mesh::TriangleDescriptor& t1 = mesh->triangles()[0];
+  EXPECT_EQ(0, t1.p1);
+  EXPECT_EQ(1, t1.p2);
+  EXPECT_EQ(2, t1.p3);
+  EXPECT_EQ(0, t1.n1);
+
+  const Mesh::TriangleDescriptor& t2 = mesh->triangles()[1];
+  EXPECT_EQ(1, t2.p1);
+  EXPECT_EQ(3, t2.p2);
+  EXPECT_EQ(2, t2.p3);
+}
+
+TEST_F(MeshParserTest, PolygonsAreTriangulated) {
+  std::unique_ptr<Mesh> mesh(Load(
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0 0\n"
+      "f 1 2 3 4 5\n"));
+  ASSERT_NE(nullptr, mesh.get());
+  ASSERT_EQ(3, mesh->num_triangles());
+  for (size_t i = 0; i < 3; ++i) {
+    const Mesh::TriangleDescriptor& t = mesh->triangles()[i];
+    EXPECT_EQ(0, t.p1);
+    EXPECT_EQ(i + 1, t.p2);
+    EXPECT_EQ(i + 2, t.p3);
+  }
+}
+
+TEST_F(MeshParserTest, RejectsMalformedFiles) {
+  EXPECT_EQ(NULL, Load("v 1 2\n"));
+  EXPECT_EQ(NULL, Load("v 1 2 x\n"));
+  EXPECT_EQ(NULL, Load("v 0 0 0\nv 1 0 0\nf 1 2\n"));
+  EXPECT_EQ(NULL, Load("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n"));
+  EXPECT_EQ(NULL, Load("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 0 1 2\n"));
+  EXPECT_EQ(NULL, Load("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1//1 2//1 3//1\n"));
+}
+
+TEST_F(MeshParserTest, ChunksMatchSingleThread) {
+  // Builds a strip of triangles where every face refers to the previous
+  // vertices through negative indices, so faces refer across chunks.
+  std::stringstream contents;
+  contents << "vn 0 0 1\n";
+  for (size_t i = 0; i < 500; ++i) {
+    contents << "v " << i << " " << (i % 2) << " 0." << i << "\n";
+    if (i >= 2) {
+      contents << "f -3//1 -2//1 -1//1\n";
+    }
+  }
+
+  MeshParser single_threaded(1);
+  std::unique_ptr<Mesh> expected(Load(contents.str(), &single_threaded));
+  MeshParser multi_threaded(7, 64);
+  std::unique_ptr<Mesh> actual(Load(contents.str(), &multi_threaded));
+  ASSERT_NE(nullptr, expected.get());
+  ASSERT_NE(nullptr, actual.get());
+
+  ASSERT_EQ(500, expected->num_points());
+  ASSERT_EQ(expected->num_points(), actual->num_points());
+  for (size_t i = 0; i < expected->num_points(); ++i) {
+    EXPECT_SCALAR_EQ(i, actual->points()[i].x());
+    EXPECT_SCALAR_EQ(expected->points()[i].z(), actual->points()[i].z());
+  }
+
+  ASSERT_EQ(498, expected->num_triangles());
+  ASSERT_EQ(expected->num_triangles(), actual->num_triangles());
+  for (size_t i = 0; i < expected->num_triangles(); ++i) {
+    EXPECT_EQ(i, actual->triangles()[i].p1);
+    EXPECT_EQ(i + 1, actual->triangles()[i].p2);
+    EXPECT_EQ(i + 2, actual->triangles()[i].p3);
+  }
+}
+
+}  // namespace
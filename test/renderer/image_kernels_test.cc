@@ -0,0 +1,139 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the ImageKernels class.
+ * Author: Dino Wernli
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <limits>
+#include <vector>
+
+#include "renderer/image.h"
+#include "renderer/image_kernels.h"
+#include "test/test_util.h"
+
+namespace {
+
+// Returns n values which are not a multiple of any block size, so that both
+// the blocks and the remaining values are exercised.
+std::vector<Intensity> Ramp(size_t n, Intensity low, Intensity high) {
+  std::vector<Intensity> values(n);
+  for (size_t i = 0; i < n; ++i) {
+    values[i] = low + (high - low) * i / (n - 1);
+  }
+  return values;
+}
+
+TEST(ImageKernels, Max) {
+  std::vector<Intensity> values = Ramp(37, -2, 3);
+  EXPECT_FLOAT_EQ(3, ImageKernels::Max(values.data(), values.size()));
+  values[5] = 7;
+  EXPECT_FLOAT_EQ(7, ImageKernels::Max(values.data(), values.size()));
+  values[36] = 8;
+  EXPECT_FLOAT_EQ(8, ImageKernels::Max(values.data(), values.size()));
+  EXPECT_EQ(-std::numeric_limits<Intensity>::infinity(),
+            ImageKernels::Max(values.data(), 0));
+}
+
+TEST(ImageKernels, ScaleAndClamp) {
+  std::vector<Intensity> values = Ramp(37, -2, 3);
+  std::vector<Intensity> expected(values);
+  ImageKernels::Scale(values.data(), values.size(), 2);
+  ImageKernels::Clamp(values.data(), values.size(), 0, 1);
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(std::min(std::max(2 * expected[i], 0.0f), 1.0f),
+                    values[i]);
+  }
+}
+
+TEST(ImageKernels, ToneMapAndGamma) {
+  std::vector<Intensity> values = Ramp(19, 0, 9);
+  std::vector<Intensity> expected(values);
+  ImageKernels::ToneMap(values.data(), values.size(), 0.5);
+  ImageKernels::Gamma(values.data(), values.size(), 2);
+  for (size_t i = 0; i < values.size(); ++i) {
+    const Intensity exposed = 0.5 * expected[i];
+    EXPECT_FLOAT_EQ(std::sqrt(exposed / (1 + exposed)), values[i]);
+  }
+}
+
+TEST(ImageKernels, Quantize) {
+  std::vector<Intensity> values = Ramp(37, -0.5, 1.5);
+  std::vector<unsigned char> bytes(values.size());
+  ImageKernels::Quantize(values.data(), values.size(), bytes.data());
+  for (size_t i = 0; i < values.size(); ++i) {
+    const Intensity clamped = std::min(std::max(values[i], 0.0f), 1.0f);
+    EXPECT_EQ((unsigned char)(clamped * 255), bytes[i]);
+  }
+}
+
+TEST(ImageKernels, ToHalf) {
+  const Intensity values[] = { 0, 1, -2, 0.1, 65504, 1e6, 5.9604645e-8, 1e-9,
+                               0.33333334, 2049, 2051, -0.0, 3, 4, 5, 6, 7 };
+  const uint16_t expected[] = { 0x0000, 0x3c00, 0xc000, 0x2e66, 0x7bff, 0x7c00,
+                                0x0001, 0x0000, 0x3555, 0x6800, 0x6802, 0x8000,
+                                0x4200, 0x4400, 0x4500, 0x4600, 0x4700 };
+  const size_t n = sizeof(values) / sizeof(values[0]);
+  uint16_t halves[n];
+  ImageKernels::ToHalf(values, n, halves);
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(expected[i], halves[i]) << "value " << values[i];
+  }
+}
+
+TEST(ImageKernels, ParallelForCoversAllItems) {
+  const size_t n = 1000;
+  std::vector<std::atomic<int>> visits(n);
+  size_t chunks = ImageKernels::ParallelFor(n, 10000,
+      [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  EXPECT_EQ(ImageKernels::NumChunks(n, 10000), chunks);
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(1, visits[i]);
+  }
+}
+
+TEST(ImageKernels, ImageBulkOperations) {
+  Image image(7, 5);
+  for (size_t x = 0; x < image.SizeX(); ++x) {
+    for (size_t y = 0; y < image.SizeY(); ++y) {
+      image.PutPixel(Color3(x, y, 1), x, y);
+    }
+  }
+  EXPECT_FLOAT_EQ(6, image.MaxIntensity());
+
+  image.Scale(0.5);
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(3, 2, 0.5), image.PixelAt(6, 4)));
+  image.Clamp(0, 1);
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(1, 1, 0.5), image.PixelAt(6, 4)));
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(0, 0, 0.5), image.PixelAt(0, 0)));
+}
+
+}  // namespace
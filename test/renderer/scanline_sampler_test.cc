@@ -0,0 +1,120 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the ScanlineSampler class.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "renderer/image.h"
+#include "renderer/sampler/sample.h"
+#include "renderer/sampler/scanline_sampler.h"
+#include "test/test_util.h"
+
+namespace {
+
+// Fetches all remaining jobs of the sampler, colors every sample by its
+// position and stores the jobs in the passed vector.
+void FetchJobs(Sampler* sampler, std::vector<std::vector<Sample>>* jobs) {
+  std::vector<Sample> samples(sampler->MaxJobSize());
+  size_t n;
+  while ((n = sampler->NextJob(&samples)) > 0) {
+    jobs->push_back(std::vector<Sample>(samples.begin(), samples.begin() + n));
+    for (Sample& sample : jobs->back()) {
+      sample.set_color(Color3(sample.x(), sample.y(), 0));
+    }
+  }
+}
+
+TEST(ScanlineSampler, FillsFullImage) {
+  ScanlineSampler sampler(false);
+  sampler.Init(5, 3);
+  std::vector<std::vector<Sample>> jobs;
+  FetchJobs(&sampler, &jobs);
+  for (const auto& job : jobs) {
+    sampler.AcceptJob(job, job.size());
+  }
+
+  EXPECT_TRUE(sampler.IsDone());
+  std::unique_ptr<Image> band;
+  size_t y;
+  EXPECT_FALSE(sampler.PopCompletedBand(&band, &y));
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(4, 2, 0),
+                                    sampler.image().PixelAt(4, 2)));
+}
+
+TEST(ScanlineSampler, BandsCoverImage) {
+  ScanlineSampler sampler(false, 2);
+  sampler.Init(5, 5);
+  EXPECT_EQ(5, sampler.width());
+  EXPECT_EQ(5, sampler.height());
+  EXPECT_EQ(0, sampler.image().SizeX());
+
+  std::vector<std::vector<Sample>> jobs;
+  FetchJobs(&sampler, &jobs);
+
+  // Accept the jobs in reverse order, so the top band completes first.
+  std::vector<std::pair<size_t, size_t>> bands;
+  for (auto it = jobs.rbegin(); it != jobs.rend(); ++it) {
+    sampler.AcceptJob(*it, it->size());
+    std::unique_ptr<Image> band;
+    size_t y;
+    while (sampler.PopCompletedBand(&band, &y)) {
+      bands.push_back(std::make_pair(y, band->SizeY()));
+      EXPECT_EQ(5, band->SizeX());
+      for (size_t row = 0; row < band->SizeY(); ++row) {
+        EXPECT_TRUE(TestUtil::ColorsEqual(Color3(3, y + row, 0),
+                                          band->PixelAt(3, row)));
+      }
+    }
+  }
+
+  EXPECT_TRUE(sampler.IsDone());
+  ASSERT_EQ(3, bands.size());
+  EXPECT_EQ(std::make_pair(size_t(4), size_t(1)), bands[0]);
+  EXPECT_EQ(std::make_pair(size_t(2), size_t(2)), bands[1]);
+  EXPECT_EQ(std::make_pair(size_t(0), size_t(2)), bands[2]);
+}
+
+TEST(ScanlineSampler, BandNotCompleteUntilAllPixelsAccepted) {
+  ScanlineSampler sampler(true, 4);
+  sampler.Init(3, 4);
+  std::vector<std::vector<Sample>> jobs;
+  FetchJobs(&sampler, &jobs);
+  ASSERT_EQ(2, jobs.size());
+
+  std::unique_ptr<Image> band;
+  size_t y;
+  sampler.AcceptJob(jobs[1], jobs[1].size());
+  EXPECT_FALSE(sampler.PopCompletedBand(&band, &y));
+  sampler.AcceptJob(jobs[0], jobs[0].size());
+  ASSERT_TRUE(sampler.PopCompletedBand(&band, &y));
+  EXPECT_EQ(0, y);
+  EXPECT_EQ(4, band->SizeY());
+  EXPECT_FALSE(sampler.PopCompletedBand(&band, &y));
+}
+
+}  // namespace
@@ -0,0 +1,137 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the Statistics class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include "listener/bmp_exporter.h"
+#include "renderer/statistics.h"
+#include "renderer/trace_counters.h"
+#include "test/test_util.h"
+
+namespace {
+
+TEST(Statistics, AddsCounters) {
+  TraceCounters a;
+  a.primary_rays = 1;
+  a.shadow_rays = 2;
+  a.leaf_element_tests = 5;
+  TraceCounters b;
+  b.primary_rays = 10;
+  b.secondary_rays = 3;
+  b.hits = 7;
+  a += b;
+  EXPECT_EQ(11, a.primary_rays);
+  EXPECT_EQ(16, a.total_rays());
+  EXPECT_EQ(7, a.hits);
+  EXPECT_EQ(5, a.leaf_element_tests);
+}
+
+TEST(Statistics, ExportsCountersAsJson) {
+  char path[] = "/tmp/statistics_testXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  // Without a heatmap exporter, only the counters are exported.
+  Statistics statistics(NULL, path);
+  statistics.Init(4, 3);
+  EXPECT_TRUE(statistics.sampling_heatmap() == NULL);
+
+  TraceCounters counters;
+  counters.primary_rays = 12;
+  counters.shadow_early_outs = 4;
+  counters.kd_tree_nodes_visited = 123456789012ULL;
+  statistics.set_trace_counters(counters);
+  statistics.Export();
+
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  unlink(path);
+  EXPECT_EQ(Statistics::ToJson(counters), contents.str());
+  EXPECT_NE(std::string::npos, contents.str().find("\"primary_rays\": 12,"));
+  EXPECT_NE(std::string::npos,
+            contents.str().find("\"kd_tree_nodes_visited\": 123456789012,"));
+  EXPECT_NE(std::string::npos,
+            contents.str().find("\"leaf_element_tests\": 0\n}"));
+}
+
+TEST(Statistics, FalseColorRamp) {
+  const Color3 low = Statistics::FalseColor(0);
+  EXPECT_SCALAR_EQ(0, low.r());
+  EXPECT_SCALAR_EQ(0, low.g());
+  EXPECT_SCALAR_EQ(1, low.b());
+
+  const Color3 middle = Statistics::FalseColor(0.5);
+  EXPECT_SCALAR_EQ(0, middle.r());
+  EXPECT_SCALAR_EQ(1, middle.g());
+  EXPECT_SCALAR_EQ(0, middle.b());
+
+  const Color3 high = Statistics::FalseColor(1);
+  EXPECT_SCALAR_EQ(1, high.r());
+  EXPECT_SCALAR_EQ(0, high.g());
+  EXPECT_SCALAR_EQ(0, high.b());
+
+  // Values outside [0, 1] are clamped.
+  EXPECT_SCALAR_EQ(1, Statistics::FalseColor(7).r());
+}
+
+TEST(Statistics, ExportsCostHeatmap) {
+  char path[] = "/tmp/statistics_testXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  Statistics statistics(NULL);
+  EXPECT_FALSE(statistics.HasCostHeatmaps());
+  statistics.AddCostHeatmap(Statistics::ELEMENT_TESTS, new BmpExporter(path));
+  EXPECT_TRUE(statistics.HasCostHeatmaps());
+  statistics.Init(2, 1);
+
+  // Costs which are not recorded are dropped.
+  statistics.AddCost(Statistics::NANOSECONDS, 0, 0, 100);
+  statistics.AddCost(Statistics::ELEMENT_TESTS, 1, 0, 30);
+  statistics.AddCost(Statistics::ELEMENT_TESTS, 1, 0, 10);
+  statistics.Export();
+
+  // The free pixel is blue and the expensive one red, stored as BGR.
+  std::ifstream file(path, std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+  unlink(path);
+  ASSERT_GE(contents.size(), 54 + 6);
+  EXPECT_EQ(std::string("\xff\x00\x00\x00\x00\xff", 6),
+            contents.substr(54, 6));
+}
+
+}  // namespace
@@ -0,0 +1,149 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the geometry store.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "renderer/intersection_data.h"
+#include "scene/geometry/geometry_store.h"
+#include "scene/material.h"
+#include "scene/mesh.h"
+#include "test/test_util.h"
+#include "util/arena.h"
+
+namespace {
+
+// A sphere which is not known to the store by its type.
+class OtherSphere : public Sphere {
+ public:
+  OtherSphere(const Point3& center, Scalar radius, const Material& material)
+      : Sphere(center, radius, material) {
+  }
+  virtual Type type() const { return OTHER; }
+};
+
+class GeometryStoreTest : public ::testing::Test {
+ protected:
+  GeometryStoreTest() : material_(NULL, NULL, NULL, NULL, 0, 0, 0, 0) {
+  }
+
+  virtual void SetUp() {
+    elements_.emplace_back(new Triangle(Point3(-1, -1, 5), Point3(2, -1, 5),
+                                        Point3(-1, 2, 5), material_));
+    elements_.emplace_back(new Sphere(Point3(0.5, 0, 3), 1, material_));
+    elements_.emplace_back(new Plane(Point3(0, 0, 8), Vector3(0, 0.2, -1),
+                                     material_));
+    elements_.emplace_back(new CirclePlane(Point3(0, 0.5, 4),
+                                           Vector3(0.1, 0, -1), 1.5,
+                                           material_, material_));
+    elements_.emplace_back(new OtherSphere(Point3(-0.5, 0, 6), 1, material_));
+    elements_.emplace_back(new Triangle(Point3(-2, -2, 7), Point3(1, -2, 7),
+                                        Point3(-2, 1, 7), material_));
+
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      refs_.push_back(store_.Add(elements_[i].get()));
+    }
+  }
+
+  Material material_;
+  std::vector<std::unique_ptr<Element>> elements_;
+  std::vector<GeometryStore::Ref> refs_;
+  GeometryStore store_;
+};
+
+TEST_F(GeometryStoreTest, ReturnsElements) {
+  EXPECT_EQ(elements_.size(), store_.size());
+  std::set<size_t> indices;
+  for (size_t i = 0; i < elements_.size(); ++i) {
+    EXPECT_EQ(elements_[i].get(), store_.Get(refs_[i]));
+    EXPECT_GT(store_.size(), store_.DenseIndex(refs_[i]));
+    indices.insert(store_.DenseIndex(refs_[i]));
+  }
+  EXPECT_EQ(elements_.size(), indices.size());
+
+  store_.Clear();
+  EXPECT_EQ(0, store_.size());
+}
+
+TEST_F(GeometryStoreTest, IntersectsLikeElements) {
+  for (int x = -10; x <= 10; ++x) {
+    for (int y = -10; y <= 10; ++y) {
+      Ray ray(Point3(0.2 * x, 0.2 * y, 0), Vector3(0.01 * y, -0.01 * x, 1));
+      for (size_t i = 0; i < elements_.size(); ++i) {
+        EXPECT_EQ(elements_[i]->Intersect(ray),
+                  store_.Intersect(refs_[i], ray, NULL));
+
+        IntersectionData expected(ray);
+        IntersectionData actual(ray);
+        bool intersected = elements_[i]->Intersect(ray, &expected);
+        EXPECT_EQ(intersected, store_.Intersect(refs_[i], ray, &actual));
+        if (intersected) {
+          EXPECT_EQ(expected.element(), actual.element());
+          EXPECT_EQ(expected.t, actual.t);
+          EXPECT_EQ(expected.normal.x(), actual.normal.x());
+          EXPECT_EQ(expected.normal.y(), actual.normal.y());
+          EXPECT_EQ(expected.normal.z(), actual.normal.z());
+        }
+      }
+    }
+  }
+}
+
+TEST_F(GeometryStoreTest, MeshTrianglesArePacked) {
+  Mesh mesh;
+  mesh.AddPoint(Point3(-1, -1, 5));
+  mesh.AddPoint(Point3(2, -1, 5));
+  mesh.AddPoint(Point3(-1, 2, 5));
+  mesh.AddPoint(Point3(2, 2, 5));
+  mesh.AddNormal(Vector3(0, 0, -1));
+  mesh.AddTriangle(0, 0, 1, 0, 2, 0);
+  mesh.AddTriangle(1, 0, 3, 0, 2, 0);
+  mesh.set_material(&material_);
+
+  Arena arena;
+  std::vector<const Element*> triangles;
+  mesh.CreateElements(&arena, &triangles);
+  ASSERT_EQ(2, triangles.size());
+
+  // The triangles only reference their corners, which are stored in order.
+  const Triangle* first = static_cast<const Triangle*>(triangles[0]);
+  const Triangle* second = static_cast<const Triangle*>(triangles[1]);
+  EXPECT_EQ(&first->geometry() + 1, &second->geometry());
+  EXPECT_EQ(first, first->geometry().triangle);
+  EXPECT_EQ(0, first->AllocatedSize());
+
+  Ray ray(Point3(1.5, 1.5, 0), Vector3(0, 0, 1));
+  IntersectionData data(ray);
+  EXPECT_TRUE(store_.Intersect(store_.Add(second), ray, &data));
+  EXPECT_EQ(second, data.element());
+  EXPECT_SCALAR_EQ(5, data.t);
+  EXPECT_SCALAR_EQ(-1, data.normal.z());
+}
+
+}  // namespace
@@ -29,6 +29,7 @@
 
 #include "scene/geometry/sphere.h"
 #include "scene/material.h"
+#include "test/test_util.h"
 
 namespace {
 
@@ -44,7 +45,7 @@ TEST(Sphere, PointOnSurface) {
   for (int i = 0; i < 20; ++i) {
     Point3 sampled = sphere.Sample(target);
     Scalar distance = Point3::Distance(center, sampled);
-    EXPECT_DOUBLE_EQ(radius, distance);
+    EXPECT_SCALAR_EQ(radius, distance);
     EXPECT_TRUE(center.VectorTo(target).Dot(sampled.VectorTo(target)) >= 0);
   }
 }
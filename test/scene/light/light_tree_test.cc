@@ -0,0 +1,105 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the light tree.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+
+#include "scene/light/light_tree.h"
+#include "scene/light/point_light.h"
+#include "test/test_util.h"
+
+namespace {
+
+TEST(LightTree, EmptyTree) {
+  std::vector<std::unique_ptr<Light>> lights;
+  LightTree tree;
+  tree.Init(lights);
+
+  Scalar pdf;
+  EXPECT_EQ(NULL, tree.Sample(Point3(0, 0, 0), 0.5, &pdf));
+  EXPECT_EQ(0, pdf);
+}
+
+TEST(LightTree, SingleLight) {
+  std::vector<std::unique_ptr<Light>> lights;
+  lights.push_back(std::unique_ptr<Light>(
+      new PointLight(Point3(1, 2, 3), Color3(1, 1, 1))));
+  LightTree tree;
+  tree.Init(lights);
+
+  Scalar pdf;
+  EXPECT_EQ(lights[0].get(), tree.Sample(Point3(0, 0, 0), 0.7, &pdf));
+  EXPECT_SCALAR_EQ(1, pdf);
+}
+
+TEST(LightTree, ProbabilitiesMatchFrequencies) {
+  std::vector<std::unique_ptr<Light>> lights;
+  for (int i = 0; i < 7; ++i) {
+    lights.push_back(std::unique_ptr<Light>(
+        new PointLight(Point3(i, i % 3, -i), Color3(0.1 * i, 1, 0.5))));
+  }
+  LightTree tree;
+  tree.Init(lights);
+  EXPECT_EQ(7, tree.NumLights());
+
+  // Feed evenly spaced values of u and check that every light is picked as
+  // often as its reported probability suggests.
+  const size_t n = 100000;
+  const Point3 point(0.5, 3, 1);
+  std::map<const Light*, size_t> counts;
+  std::map<const Light*, Scalar> pdfs;
+  for (size_t i = 0; i < n; ++i) {
+    Scalar pdf;
+    const Light* light = tree.Sample(point, (i + 0.5) / n, &pdf);
+    ASSERT_TRUE(light != NULL);
+    ++counts[light];
+    pdfs[light] = pdf;
+  }
+
+  Scalar total = 0;
+  for (auto it = pdfs.begin(); it != pdfs.end(); ++it) {
+    EXPECT_NEAR(it->second, Scalar(counts[it->first]) / n, 1e-3);
+    total += it->second;
+  }
+  EXPECT_NEAR(1, total, SCALAR_TOLERANCE);
+}
+
+TEST(LightTree, PrefersCloseLights) {
+  std::vector<std::unique_ptr<Light>> lights;
+  lights.push_back(std::unique_ptr<Light>(
+      new PointLight(Point3(1, 0, 0), Color3(1, 1, 1))));
+  lights.push_back(std::unique_ptr<Light>(
+      new PointLight(Point3(100, 0, 0), Color3(1, 1, 1))));
+  LightTree tree;
+  tree.Init(lights);
+
+  Scalar pdf;
+  EXPECT_EQ(lights[0].get(), tree.Sample(Point3(0, 0, 0), 0.5, &pdf));
+  EXPECT_GT(pdf, 0.99);
+}
+
+}  // namespace
@@ -25,9 +25,12 @@
  * Author: Dino Wernli
  */
 
+#include <cmath>
 #include <gtest/gtest.h>
+#include <limits>
 
 #include "scene/light/sphere_light.h"
+#include "test/test_util.h"
 
 namespace {
 
@@ -46,6 +49,51 @@ TEST(SphereLight, GeneratedRayDoesNotIntersect) {
   }
 }
 
+TEST(SphereLight, GeneratedRayStartsOnSurfaceAndEndsAtTarget) {
+  Point3 center(1, -2, 6);
+  Scalar radius = 5;
+  SphereLight sphere_light(center, radius, Color3(1, 1, 1));
+
+  Point3 targets[] = { Point3(100, 200, 4), Point3(1, -2, 11.5),
+                       Point3(2, -1, 7) /* inside */ };
+  for (const Point3& target : targets) {
+    for (int i = 0; i < 20; ++i) {
+      Ray r = sphere_light.GenerateRay(target);
+      EXPECT_NEAR(radius, Point3::Distance(center, r.origin()),
+                  SCALAR_TOLERANCE);
+      Point3 end = r.PointAt(r.max_t() + EPSILON);
+      EXPECT_NEAR(0, Point3::Distance(target, end), SCALAR_TOLERANCE);
+    }
+  }
+}
+
+TEST(SphereLight, GeneratedRayFacesTarget) {
+  Point3 center(0, 0, 0);
+  SphereLight sphere_light(center, 1, Color3(1, 1, 1));
+
+  // Every sampled point must lie on the cap of the sphere which is visible
+  // from the target.
+  Point3 target(0, 0, 3);
+  for (int i = 0; i < 100; ++i) {
+    Ray r = sphere_light.GenerateRay(target);
+    EXPECT_GE(r.origin().z(), 1.0 / 3 - SCALAR_TOLERANCE) << "Ray: " << r;
+  }
 }
 
+TEST(SphereLight, SampleRayCoversVisibleCap) {
+  SphereLight sphere_light(Point3(0, 0, 0), 1, Color3(1, 1, 1), 4);
+  EXPECT_EQ(4, sphere_light.shadow_samples());
+
+  // The sample u = 0 points at the center of the cap, u = 1 at its rim.
+  Point3 target(0, 0, 3);
+  Ray center = sphere_light.SampleRay(target, 0, 0.3);
+  EXPECT_NEAR(1, center.origin().z(), SCALAR_TOLERANCE);
 
+  // At the rim the ray is tangent to the sphere, so the position is only
+  // determined up to about the square root of the rounding error.
+  Ray rim = sphere_light.SampleRay(target, 1, 0.3);
+  EXPECT_NEAR(1.0 / 3, rim.origin().z(),
+              10 * std::sqrt(std::numeric_limits<Scalar>::epsilon()));
+}
+
+}
@@ -0,0 +1,198 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Unit tests for the RenderServer class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <google/protobuf/text_format.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "proto/config/renderer_config.pb.h"
+#include "proto/config/scene_config.pb.h"
+#include "proto/server/render_job.pb.h"
+#include "server/render_server.h"
+
+namespace {
+
+const char kScene[] =
+    "camera { position { x:0 y:0 z:-4 } view { x:0 y:0 z:1 } "
+    "up { x:0 y:1 z:0 } opening_angle: 30 resolution_x: 4 resolution_y: 3 } "
+    "textures { identifier: \"white\" color { r:1 g:1 b:1 } } "
+    "materials { identifier: \"white\" emission_texture: \"white\" "
+    "ambient_texture: \"white\" diffuse_texture: \"white\" "
+    "specular_texture: \"white\" } "
+    "spheres { center { x:0 y:0 z:0 } radius: 1 material_id: \"white\" }";
+
+class RenderServerTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    scene_path_ = ::testing::TempDir() + "render_server_test.sd";
+    std::ofstream(scene_path_.c_str()) << kScene;
+    scene_config_.mutable_kd_tree_config();
+    renderer_config_.set_threads(2);
+  }
+
+  virtual void TearDown() {
+    std::remove(scene_path_.c_str());
+  }
+
+  // Feeds the lines to a server and parses the results it writes back.
+  void Serve(const std::vector<std::string>& lines,
+             std::vector<raytracer::RenderResult>* results,
+             std::vector<std::string>* images) {
+    FILE* input = tmpfile();
+    FILE* output = tmpfile();
+    ASSERT_TRUE(input != NULL && output != NULL);
+    for (const std::string& line : lines) {
+      fputs((line + "\n").c_str(), input);
+    }
+    rewind(input);
+
+    RenderServer server(scene_config_, renderer_config_, 2);
+    EXPECT_TRUE(server.Serve(input, output));
+    rewind(output);
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, output)) >= 0) {
+      raytracer::RenderResult result;
+      EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(
+          std::string(line, length), &result));
+      std::string image(result.image_size(), '\0');
+      EXPECT_EQ(image.size(), fread(&image[0], 1, image.size(), output));
+      results->push_back(result);
+      images->push_back(image);
+    }
+    free(line);
+    fclose(input);
+    fclose(output);
+  }
+
+  std::string scene_path_;
+  raytracer::SceneConfig scene_config_;
+  raytracer::RendererConfig renderer_config_;
+};
+
+TEST_F(RenderServerTest, StreamsImages) {
+  std::vector<raytracer::RenderResult> results;
+  std::vector<std::string> images;
+  Serve({ "job_id: \"first\" scene_id: \"" + scene_path_ + "\"",
+          "",
+          "job_id: \"second\" scene_id: \"" + scene_path_ + "\" "
+          "camera { resolution_x: 5 resolution_y: 2 } "
+          "renderer_config { sampler_type: SCANLINE }" },
+        &results, &images);
+  ASSERT_EQ(2, results.size());
+
+  EXPECT_EQ("first", results[0].job_id());
+  EXPECT_TRUE(results[0].success());
+  EXPECT_FALSE(results[0].scene_cache_hit());
+
+  EXPECT_EQ("second", results[1].job_id());
+  EXPECT_TRUE(results[1].success());
+  EXPECT_TRUE(results[1].scene_cache_hit());
+
+  // Rows of BMP images are padded to multiples of four bytes.
+  EXPECT_EQ(54 + 3 * 12, images[0].size());
+  EXPECT_EQ(54 + 2 * 16, images[1].size());
+  EXPECT_EQ("BM", images[0].substr(0, 2));
+  EXPECT_EQ("BM", images[1].substr(0, 2));
+}
+
+TEST_F(RenderServerTest, ReportsFailures) {
+  std::vector<raytracer::RenderResult> results;
+  std::vector<std::string> images;
+  Serve({ "job_id: \"missing\" scene_id: \"" + scene_path_ + ".missing\"",
+          "this is not a job",
+          "job_id: \"ok\" scene_id: \"" + scene_path_ + "\"" },
+        &results, &images);
+  ASSERT_EQ(3, results.size());
+
+  EXPECT_EQ("missing", results[0].job_id());
+  EXPECT_FALSE(results[0].success());
+  EXPECT_FALSE(results[0].error().empty());
+  EXPECT_EQ(0, images[0].size());
+
+  EXPECT_FALSE(results[1].success());
+  EXPECT_FALSE(results[1].error().empty());
+
+  EXPECT_TRUE(results[2].success());
+  EXPECT_EQ(54 + 3 * 12, images[2].size());
+}
+
+TEST_F(RenderServerTest, RestrictsRemoteJobs) {
+  RenderServer server(scene_config_, renderer_config_, 2);
+  server.set_scene_dir(::testing::TempDir());
+
+  raytracer::RenderJob job;
+  job.set_scene_id(scene_path_);
+  raytracer::RenderResult result;
+  std::string image;
+  server.Run(job, true /* remote */, &result, &image);
+  EXPECT_TRUE(result.success());
+
+  // Escaping the scene directory is rejected even if the file exists.
+  const std::string dir = ::testing::TempDir() + "render_server_test_dir";
+  mkdir(dir.c_str(), 0700);
+  server.set_scene_dir(dir);
+  job.set_scene_id(dir + "/../render_server_test.sd");
+  result.Clear();
+  server.Run(job, true /* remote */, &result, &image);
+  EXPECT_FALSE(result.success());
+  EXPECT_FALSE(result.error().empty());
+  rmdir(dir.c_str());
+
+  // Remote clients may not write files.
+  server.set_scene_dir(::testing::TempDir());
+  job.set_scene_id(scene_path_);
+  job.set_output_path(scene_path_ + ".bmp");
+  result.Clear();
+  server.Run(job, true /* remote */, &result, &image);
+  EXPECT_FALSE(result.success());
+  EXPECT_NE(0, access((scene_path_ + ".bmp").c_str(), F_OK));
+
+  // This includes the files written by the renderer.
+  job.clear_output_path();
+  job.mutable_renderer_config()->set_kd_tree_heatmap_path(
+      scene_path_ + ".heatmap.bmp");
+  result.Clear();
+  server.Run(job, true /* remote */, &result, &image);
+  EXPECT_FALSE(result.success());
+  EXPECT_NE(0, access((scene_path_ + ".heatmap.bmp").c_str(), F_OK));
+
+  // Requesting more threads than the server has renders with its own.
+  job.mutable_renderer_config()->clear_kd_tree_heatmap_path();
+  job.mutable_renderer_config()->set_threads(1000000000);
+  result.Clear();
+  server.Run(job, true /* remote */, &result, &image);
+  EXPECT_TRUE(result.success());
+}
+
+}  // namespace
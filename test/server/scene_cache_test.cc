@@ -0,0 +1,138 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Unit tests for the SceneCache class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/time.h>
+
+#include "proto/config/scene_config.pb.h"
+#include "proto/scene/camera_data.pb.h"
+#include "scene/scene.h"
+#include "server/scene_cache.h"
+
+namespace {
+
+// A scene with a camera of the given horizontal resolution and a sphere.
+std::string SceneText(int resolution_x) {
+  return "camera { position { x:0 y:0 z:-4 } view { x:0 y:0 z:1 } "
+         "up { x:0 y:1 z:0 } opening_angle: 30 resolution_x: " +
+         std::to_string(resolution_x) + " resolution_y: 2 } "
+         "textures { identifier: \"white\" color { r:1 g:1 b:1 } } "
+         "materials { identifier: \"white\" emission_texture: \"white\" "
+         "ambient_texture: \"white\" diffuse_texture: \"white\" "
+         "specular_texture: \"white\" } "
+         "spheres { center { x:0 y:0 z:0 } radius: 1 material_id: \"white\" }";
+}
+
+class SceneCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    for (int i = 0; i < 3; ++i) {
+      paths_[i] = ::testing::TempDir() + "scene_cache_test_" +
+                  std::to_string(i) + ".sd";
+      std::ofstream(paths_[i].c_str()) << SceneText(i + 1);
+    }
+    config_.mutable_kd_tree_config();
+  }
+
+  virtual void TearDown() {
+    for (int i = 0; i < 3; ++i) {
+      std::remove(paths_[i].c_str());
+    }
+  }
+
+  // Returns whether fetching the scene at path was a hit. Fails the test if
+  // the scene could not be loaded.
+  static bool Hit(SceneCache* cache, const std::string& path) {
+    bool hit = false;
+    EXPECT_TRUE(cache->Get(path, NULL, &hit) != NULL);
+    return hit;
+  }
+
+  std::string paths_[3];
+  raytracer::SceneConfig config_;
+};
+
+TEST_F(SceneCacheTest, KeepsScenesResident) {
+  SceneCache cache(config_, 2);
+  raytracer::CameraData camera;
+  bool hit = true;
+  Scene* scene = cache.Get(paths_[1], &camera, &hit);
+  ASSERT_TRUE(scene != NULL);
+  EXPECT_FALSE(hit);
+  EXPECT_EQ(2, camera.resolution_x());
+
+  camera.Clear();
+  EXPECT_EQ(scene, cache.Get(paths_[1], &camera, &hit));
+  EXPECT_TRUE(hit);
+  EXPECT_EQ(2, camera.resolution_x());
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST_F(SceneCacheTest, EvictsLeastRecentlyUsed) {
+  SceneCache cache(config_, 2);
+  EXPECT_FALSE(Hit(&cache, paths_[0]));
+  EXPECT_FALSE(Hit(&cache, paths_[1]));
+  EXPECT_TRUE(Hit(&cache, paths_[0]));
+
+  // Evicts the second scene, which was used least recently.
+  EXPECT_FALSE(Hit(&cache, paths_[2]));
+  EXPECT_EQ(2, cache.size());
+  EXPECT_TRUE(Hit(&cache, paths_[0]));
+  EXPECT_TRUE(Hit(&cache, paths_[2]));
+  EXPECT_FALSE(Hit(&cache, paths_[1]));
+}
+
+TEST_F(SceneCacheTest, ReloadsChangedScene) {
+  SceneCache cache(config_, 2);
+  EXPECT_FALSE(Hit(&cache, paths_[0]));
+
+  std::ofstream(paths_[0].c_str()) << SceneText(7);
+  struct timeval times[2];
+  gettimeofday(&times[0], NULL);
+  times[0].tv_sec += 10;
+  times[1] = times[0];
+  utimes(paths_[0].c_str(), times);
+
+  raytracer::CameraData camera;
+  bool hit = true;
+  EXPECT_TRUE(cache.Get(paths_[0], &camera, &hit) != NULL);
+  EXPECT_FALSE(hit);
+  EXPECT_EQ(7, camera.resolution_x());
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST_F(SceneCacheTest, MissingScene) {
+  SceneCache cache(config_, 2);
+  bool hit = true;
+  EXPECT_EQ(NULL, cache.Get(paths_[0] + ".missing", NULL, &hit));
+  EXPECT_FALSE(hit);
+  EXPECT_EQ(0, cache.size());
+}
+
+}  // namespace
@@ -0,0 +1,198 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+/*
+ * Unit tests for the TileCoordinator class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "proto/config/renderer_config.pb.h"
+#include "proto/config/scene_config.pb.h"
+#include "proto/server/render_job.pb.h"
+#include "renderer/image.h"
+#include "renderer/renderer.h"
+#include "renderer/sampler/sampler.h"
+#include "renderer/updatable.h"
+#include "scene/scene.h"
+#include "server/render_server.h"
+#include "server/tile_coordinator.h"
+
+namespace {
+
+// Only uses a point light, which makes renderings deterministic.
+const char kScene[] =
+    "camera { position { x:0 y:0 z:-4 } view { x:0 y:0 z:1 } "
+    "up { x:0 y:1 z:0 } opening_angle: 30 resolution_x: 13 resolution_y: 7 } "
+    "point_lights { position { x:2 y:2 z:-2 } color { r:1 g:1 b:1 } } "
+    "textures { identifier: \"red\" color { r:0.8 g:0.1 b:0.1 } } "
+    "materials { identifier: \"red\" emission_texture: \"red\" "
+    "ambient_texture: \"red\" diffuse_texture: \"red\" "
+    "specular_texture: \"red\" shininess: 10 } "
+    "spheres { center { x:0 y:0 z:0 } radius: 1 material_id: \"red\" }";
+
+// Keeps a copy of the last rendered image.
+class ImageCapture : public Updatable {
+ public:
+  // Does not take ownership of "image".
+  explicit ImageCapture(std::unique_ptr<Image>* image) : image_(image) {}
+
+  virtual void Ended(const Sampler& sampler) {
+    image_->reset(new Image(sampler.image()));
+  }
+
+ private:
+  std::unique_ptr<Image>* image_;
+};
+
+class TileCoordinatorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    scene_path_ = ::testing::TempDir() + "tile_coordinator_test.sd";
+    std::ofstream(scene_path_.c_str()) << kScene;
+    scene_config_.mutable_kd_tree_config();
+    renderer_config_.set_threads(1);
+    job_.set_scene_id(scene_path_);
+  }
+
+  virtual void TearDown() {
+    for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+      it->join();
+    }
+    std::remove(scene_path_.c_str());
+  }
+
+  // Adds a worker to coordinator which is served by a render server running
+  // on a thread of this test.
+  void AddServer(TileCoordinator* coordinator) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    ASSERT_TRUE(coordinator->AddWorker(fds[0], "server"));
+    threads_.push_back(std::thread([this, fds]() {
+      FILE* input = fdopen(fds[1], "r");
+      FILE* output = fdopen(dup(fds[1]), "w");
+      RenderServer server(scene_config_, renderer_config_, 1);
+      server.Serve(input, output);
+      fclose(input);
+      fclose(output);
+    }));
+  }
+
+  // Adds a worker to coordinator which dies after receiving its first job.
+  void AddDyingServer(TileCoordinator* coordinator) {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    ASSERT_TRUE(coordinator->AddWorker(fds[0], "dying server"));
+    threads_.push_back(std::thread([fds]() {
+      char c;
+      while (read(fds[1], &c, 1) == 1 && c != '\n') {
+      }
+      close(fds[1]);
+    }));
+  }
+
+  // Renders the job in this process without any tiles.
+  std::unique_ptr<Image> RenderLocally() {
+    raytracer::SceneConfig config(scene_config_);
+    EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(
+        kScene, config.mutable_scene_data()));
+    std::unique_ptr<Scene> scene(Scene::FromConfig(config));
+    std::unique_ptr<Renderer> renderer(Renderer::FromConfig(renderer_config_));
+    std::unique_ptr<Image> image;
+    renderer->AddListener(new ImageCapture(&image));
+    renderer->Render(scene.get());
+    return image;
+  }
+
+  static void ExpectSameImage(const Image& expected, const Image& actual) {
+    ASSERT_EQ(expected.SizeX(), actual.SizeX());
+    ASSERT_EQ(expected.SizeY(), actual.SizeY());
+    for (size_t y = 0; y < expected.SizeY(); ++y) {
+      for (size_t x = 0; x < expected.SizeX(); ++x) {
+        const Color3 a = expected.PixelAt(x, y);
+        const Color3 b = actual.PixelAt(x, y);
+        EXPECT_NEAR(a.r(), b.r(), 1e-6);
+        EXPECT_NEAR(a.g(), b.g(), 1e-6);
+        EXPECT_NEAR(a.b(), b.b(), 1e-6);
+      }
+    }
+  }
+
+  std::string scene_path_;
+  raytracer::SceneConfig scene_config_;
+  raytracer::RendererConfig renderer_config_;
+  raytracer::RenderJob job_;
+  std::vector<std::thread> threads_;
+};
+
+TEST_F(TileCoordinatorTest, MergesTiles) {
+  std::unique_ptr<Image> image;
+  {
+    TileCoordinator coordinator(4);
+    AddServer(&coordinator);
+    AddServer(&coordinator);
+    coordinator.AddListener(new ImageCapture(&image));
+    EXPECT_TRUE(coordinator.Render(job_));
+    EXPECT_EQ(2, coordinator.num_workers());
+  }
+  ASSERT_TRUE(image.get() != NULL);
+  ExpectSameImage(*RenderLocally(), *image);
+}
+
+TEST_F(TileCoordinatorTest, RetriesTilesOfDeadWorkers) {
+  std::unique_ptr<Image> image;
+  {
+    TileCoordinator coordinator(3);
+    AddDyingServer(&coordinator);
+    AddServer(&coordinator);
+    coordinator.AddListener(new ImageCapture(&image));
+    EXPECT_TRUE(coordinator.Render(job_));
+    EXPECT_EQ(1, coordinator.num_workers());
+  }
+  ASSERT_TRUE(image.get() != NULL);
+  ExpectSameImage(*RenderLocally(), *image);
+}
+
+TEST_F(TileCoordinatorTest, FailsWithoutWorkers) {
+  TileCoordinator coordinator(4);
+  AddDyingServer(&coordinator);
+  EXPECT_FALSE(coordinator.Render(job_));
+  EXPECT_EQ(0, coordinator.num_workers());
+}
+
+TEST_F(TileCoordinatorTest, FailsOnMissingScene) {
+  TileCoordinator coordinator(4);
+  AddServer(&coordinator);
+  job_.set_scene_id(scene_path_ + ".missing");
+  EXPECT_FALSE(coordinator.Render(job_));
+}
+
+}  // namespace
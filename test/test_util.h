@@ -29,6 +29,17 @@
 #define TEST_UTIL_H_
 
 #include "util/color3.h"
+#include "util/numeric.h"
+
+// Compares two scalars up to the precision of the current build. The absolute
+// tolerance is meant for results of short computations on scalars.
+#ifdef RAYTRACER_SINGLE_PRECISION
+#define EXPECT_SCALAR_EQ(expected, actual) EXPECT_FLOAT_EQ(expected, actual)
+#define SCALAR_TOLERANCE 1e-4
+#else
+#define EXPECT_SCALAR_EQ(expected, actual) EXPECT_DOUBLE_EQ(expected, actual)
+#define SCALAR_TOLERANCE 1e-9
+#endif
 
 class TestUtil {
  public:
@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the Arena class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdint>
+#include <gtest/gtest.h>
+
+#include "util/arena.h"
+#include "util/point3.h"
+
+namespace {
+
+bool IsAligned(const void* pointer, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+TEST(Arena, AllocatesAlignedMemory) {
+  Arena arena(1024);
+  for (size_t i = 0; i < 100; ++i) {
+    char* c = static_cast<char*>(arena.Allocate(1, 1));
+    *c = 'x';
+    double* d = arena.New<double>(i);
+    EXPECT_TRUE(IsAligned(d, alignof(double)));
+    EXPECT_EQ(i, *d);
+  }
+  EXPECT_EQ(100 * (1 + sizeof(double)), arena.bytes_used());
+  EXPECT_LE(arena.bytes_used(), arena.bytes_reserved());
+}
+
+TEST(Arena, ConstructsAndCopies) {
+  Arena arena;
+  Point3* point = arena.New<Point3>(1, 2, 3);
+  EXPECT_EQ(1, point->x());
+  EXPECT_EQ(3, point->z());
+
+  const int values[] = { 4, 5, 6 };
+  int* copy = arena.Copy(values, 3);
+  EXPECT_EQ(5, copy[1]);
+  EXPECT_EQ(NULL, arena.Copy(values, 0));
+}
+
+TEST(Arena, GivesLargeAllocationsTheirOwnBlock) {
+  Arena arena(1024);
+  arena.Allocate(16, 8);
+  const size_t reserved = arena.bytes_reserved();
+  arena.Allocate(4096, 8);
+  EXPECT_EQ(reserved + 4096 + 8, arena.bytes_reserved());
+
+  // The current block is still used for small allocations.
+  arena.Allocate(16, 8);
+  EXPECT_EQ(reserved + 4096 + 8, arena.bytes_reserved());
+}
+
+}  // namespace
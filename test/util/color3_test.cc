@@ -0,0 +1,54 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the Color3 class.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+
+#include "util/color3.h"
+#include "test/test_util.h"
+
+namespace {
+
+TEST(Color3, Arithmetic) {
+  Color3 c = Color3(0.5, 0.25, 0) + Color3(0.25, 0.25, 1);
+  c += Color3(0, 0.5, 0);
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(0.75, 1, 1), c));
+
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(1.5, 2, 2), c * 2));
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(1.5, 2, 2), 2 * c));
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(0.375, 0.5, 0.5), c / 2));
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(0.25, 0.5, 0),
+                                    c - Color3(0.5, 0.5, 1)));
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(0.375, 0, 1),
+                                    c * Color3(0.5, 0, 1)));
+}
+
+TEST(Color3, Clamped) {
+  Color3 c(-0.5, 0.5, 1.5);
+  EXPECT_TRUE(TestUtil::ColorsEqual(Color3(0, 0.5, 1), c.Clamped()));
+}
+
+}
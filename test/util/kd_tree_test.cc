@@ -0,0 +1,227 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the KdTree class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "proto/config/scene_config.pb.h"
+#include "renderer/intersection_data.h"
+#include "renderer/trace_counters.h"
+#include "scene/element.h"
+#include "scene/geometry/triangle.h"
+#include "scene/material.h"
+#include "test/test_util.h"
+#include "util/kd_tree.h"
+#include "util/memory_report.h"
+#include "util/random.h"
+#include "util/ray.h"
+
+namespace {
+
+class KdTreeTest : public ::testing::Test {
+ protected:
+  KdTreeTest() : material_(NULL, NULL, NULL, NULL, 0, 0, 0, 0) {}
+
+  virtual void SetUp() {
+    std::string pattern = ::testing::TempDir() + "kd_tree_test.XXXXXX";
+    cache_directory_ = mkdtemp(&pattern[0]);
+
+    Random random;
+    for (size_t i = 0; i < 300; ++i) {
+      Point3 corner(random.Get(10), random.Get(10), random.Get(10));
+      Vector3 u(random.Get(1), random.Get(1), random.Get(1));
+      Vector3 v(random.Get(1), random.Get(1), random.Get(1));
+      elements_.push_back(std::unique_ptr<Element>(
+          new Triangle(corner, corner + u, corner + v, material_)));
+    }
+    for (size_t i = 0; i < 100; ++i) {
+      Point3 origin(random.Get(12), random.Get(12), random.Get(12));
+      Vector3 direction(random.Get(1), random.Get(1), random.Get(1));
+      rays_.push_back(Ray(origin, direction));
+    }
+  }
+
+  virtual void TearDown() {
+    const std::vector<std::string> files = CacheFiles();
+    for (size_t i = 0; i < files.size(); ++i) {
+      std::remove((cache_directory_ + "/" + files[i]).c_str());
+    }
+    rmdir(cache_directory_.c_str());
+  }
+
+  // Returns the names of all files in the cache directory.
+  std::vector<std::string> CacheFiles() const {
+    std::vector<std::string> result;
+    DIR* directory = opendir(cache_directory_.c_str());
+    while (dirent* entry = readdir(directory)) {
+      if (entry->d_name[0] != '.') {
+        result.push_back(entry->d_name);
+      }
+    }
+    closedir(directory);
+    return result;
+  }
+
+  // Returns the intersection parameter of the closest intersection of ray
+  // with any element, or -1 if there is none.
+  Scalar LinearIntersect(const Ray& ray) const {
+    IntersectionData data(ray);
+    bool intersected = false;
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      intersected = elements_[i]->Intersect(ray, &data) || intersected;
+    }
+    return intersected ? data.t : -1;
+  }
+
+  // Returns the elements to build trees for.
+  std::vector<const Element*> Elements() const {
+    std::vector<const Element*> result;
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      result.push_back(elements_[i].get());
+    }
+    return result;
+  }
+
+  static Scalar TreeIntersect(const KdTree& tree, const Ray& ray) {
+    IntersectionData data(ray);
+    return tree.Intersect(ray, &data) ? data.t : -1;
+  }
+
+  std::string cache_directory_;
+  Material material_;
+  std::vector<std::unique_ptr<Element>> elements_;
+  std::vector<Ray> rays_;
+};
+
+TEST_F(KdTreeTest, MatchesLinearSearch) {
+  std::unique_ptr<KdTree> tree(KdTree::FromConfig(raytracer::KdTreeConfig()));
+  tree->Init(Elements());
+  for (size_t i = 0; i < rays_.size(); ++i) {
+    EXPECT_EQ(LinearIntersect(rays_[i]), TreeIntersect(*tree, rays_[i]));
+    EXPECT_EQ(LinearIntersect(rays_[i]) >= 0, tree->Intersect(rays_[i]));
+  }
+}
+
+TEST_F(KdTreeTest, CountsTraversal) {
+  std::unique_ptr<KdTree> tree(KdTree::FromConfig(raytracer::KdTreeConfig()));
+  tree->Init(Elements());
+  TraceCounters& counters = TraceCounters::ForThisThread();
+  counters = TraceCounters();
+
+  // A ray missing the bounding box does not enter the tree.
+  tree->Intersect(Ray(Point3(100, 100, 100), Vector3(1, 0, 0)));
+  EXPECT_EQ(0, counters.kd_tree_nodes_visited);
+
+  for (size_t i = 0; i < rays_.size(); ++i) {
+    TreeIntersect(*tree, rays_[i]);
+  }
+  EXPECT_GT(counters.kd_tree_nodes_visited, 0);
+  EXPECT_GT(counters.leaf_element_tests, 0);
+
+  // The tree needs fewer tests than testing every element with every ray.
+  EXPECT_LT(counters.leaf_element_tests, elements_.size() * rays_.size());
+}
+
+TEST_F(KdTreeTest, ReportsMemory) {
+  std::unique_ptr<KdTree> tree(KdTree::FromConfig(raytracer::KdTreeConfig()));
+  tree->Init(Elements());
+  MemoryReport report;
+  tree->AddMemoryUsage(&report);
+
+  EXPECT_LT(0, report.count("kd_tree_nodes"));
+  EXPECT_LT(0, report.bytes("kd_tree_nodes"));
+
+  // Every element ends up in at least one leaf.
+  EXPECT_EQ(elements_.size(), report.count("kd_tree_leaf_references"));
+  EXPECT_EQ(elements_.size() * sizeof(uint32_t),
+            report.bytes("kd_tree_leaf_references"));
+  EXPECT_EQ(report.count("kd_tree_duplicated_references") * sizeof(uint32_t),
+            report.bytes("kd_tree_duplicated_references"));
+  EXPECT_EQ(elements_.size(), report.count("kd_tree_element_lists"));
+}
+
+TEST_F(KdTreeTest, CachedTreeMatchesBuiltTree) {
+  raytracer::KdTreeConfig config;
+  config.set_cache_directory(cache_directory_);
+
+  std::unique_ptr<KdTree> built(KdTree::FromConfig(config));
+  built->Init(Elements());
+  std::unique_ptr<KdTree> cached(KdTree::FromConfig(config));
+  cached->Init(Elements());
+  EXPECT_EQ(1, CacheFiles().size());
+
+  for (size_t i = 0; i < rays_.size(); ++i) {
+    const Scalar expected = TreeIntersect(*built, rays_[i]);
+    EXPECT_EQ(expected, TreeIntersect(*cached, rays_[i]));
+    EXPECT_EQ(LinearIntersect(rays_[i]), expected);
+  }
+
+  // Moving an element must not pick up the stale tree.
+  elements_[0].reset(new Triangle(Point3(99, 99, 100), Point3(102, 99, 100),
+                                  Point3(99, 102, 100), material_));
+  std::unique_ptr<KdTree> changed(KdTree::FromConfig(config));
+  changed->Init(Elements());
+  Ray ray(Point3(100, 100, 90), Vector3(0, 0, 1));
+  EXPECT_SCALAR_EQ(10, TreeIntersect(*changed, ray));
+  EXPECT_EQ(2, CacheFiles().size());
+}
+
+TEST_F(KdTreeTest, RebuildsInvalidCachedTree) {
+  raytracer::KdTreeConfig config;
+  config.set_cache_directory(cache_directory_);
+  std::unique_ptr<KdTree> built(KdTree::FromConfig(config));
+  built->Init(Elements());
+  ASSERT_EQ(1, CacheFiles().size());
+  const std::string path = cache_directory_ + "/" + CacheFiles()[0];
+
+  // Overwrite the last element reference and then the root node with values
+  // which do not describe any element or node.
+  const long offsets[] = { -4, 64 };
+  for (size_t i = 0; i < 2; ++i) {
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(file != NULL);
+    fseek(file, offsets[i], offsets[i] < 0 ? SEEK_END : SEEK_SET);
+    const uint32_t garbage[4] = { 0xffffffff, 0xffffffff, 0xffffffff,
+                                  0xffffffff };
+    fwrite(garbage, sizeof(uint32_t), offsets[i] < 0 ? 1 : 4, file);
+    fclose(file);
+
+    std::unique_ptr<KdTree> rebuilt(KdTree::FromConfig(config));
+    rebuilt->Init(Elements());
+    for (size_t j = 0; j < rays_.size(); ++j) {
+      EXPECT_EQ(LinearIntersect(rays_[j]), TreeIntersect(*rebuilt, rays_[j]));
+    }
+  }
+}
+
+}  // namespace
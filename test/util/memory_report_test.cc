@@ -0,0 +1,56 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the MemoryReport class.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "util/memory_report.h"
+
+TEST(MemoryReport, SumsCategories) {
+  MemoryReport report;
+  report.Add("nodes", 100, 10);
+  report.Add("leaves", 40, 4);
+  report.Add("nodes", 20, 2);
+
+  EXPECT_EQ(120, report.bytes("nodes"));
+  EXPECT_EQ(12, report.count("nodes"));
+  EXPECT_EQ(40, report.bytes("leaves"));
+  EXPECT_EQ(0, report.bytes("missing"));
+  EXPECT_EQ(160, report.total_bytes());
+}
+
+TEST(MemoryReport, ToJsonKeepsOrder) {
+  MemoryReport report;
+  report.Add("nodes", 100, 10);
+  report.Add("leaves", 40, 4);
+
+  const std::string json = report.ToJson();
+  EXPECT_NE(std::string::npos,
+            json.find("\"nodes\": { \"bytes\": 100, \"count\": 10 }"));
+  EXPECT_LT(json.find("\"nodes\""), json.find("\"leaves\""));
+  EXPECT_NE(std::string::npos, json.find("\"total_bytes\": 140"));
+}
@@ -0,0 +1,67 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the PerfCounters class.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+
+#include "util/perf_counters.h"
+
+TEST(PerfCounters, AddsValues) {
+  PerfCounters::Values a;
+  PerfCounters::Values b;
+  b.counts[PerfCounters::CYCLES] = 10;
+  b.valid[PerfCounters::CYCLES] = true;
+  a += b;
+  a += b;
+
+  EXPECT_EQ(20, a.counts[PerfCounters::CYCLES]);
+  EXPECT_TRUE(a.valid[PerfCounters::CYCLES]);
+  EXPECT_EQ(0, a.counts[PerfCounters::INSTRUCTIONS]);
+  EXPECT_FALSE(a.valid[PerfCounters::INSTRUCTIONS]);
+}
+
+TEST(PerfCounters, CountsOrDegrades) {
+  PerfCounters counters;
+  counters.Start();
+  volatile uint64_t sum = 0;
+  for (uint64_t i = 0; i < 1000000; ++i) {
+    sum += i;
+  }
+  counters.Stop();
+  PerfCounters::Values values = counters.Read();
+
+  if (!counters.IsAvailable()) {
+    // Without counters, nothing may be reported as valid.
+    for (size_t i = 0; i < PerfCounters::kNumEvents; ++i) {
+      EXPECT_FALSE(values.valid[i]);
+      EXPECT_EQ(0, values.counts[i]);
+    }
+    return;
+  }
+  if (values.valid[PerfCounters::INSTRUCTIONS]) {
+    EXPECT_LT(1000000, values.counts[PerfCounters::INSTRUCTIONS]);
+  }
+}
@@ -47,4 +47,20 @@ TEST(Random, Boundary) {
   EXPECT_TRUE(r >= -3 && r <= 3);
 }
 
+TEST(Random, FixedSeed) {
+  Random::SetSeed(17);
+  Random first;
+  Random second;
+  Random::SetSeed(17);
+  Random first_again;
+  Random second_again;
+
+  Scalar a = first.Get(1);
+  Scalar b = second.Get(1);
+  EXPECT_EQ(a, first_again.Get(1));
+  EXPECT_EQ(b, second_again.Get(1));
+  EXPECT_NE(a, b);
+  Random::ClearSeed();
+}
+
 }  // namespace
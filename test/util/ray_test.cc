@@ -28,13 +28,14 @@
 #include <gtest/gtest.h>
 
 #include "util/ray.h"
+#include "test/test_util.h"
 
 namespace {
 
 TEST(Ray, DirectionNormalized) {
   Vector3 direction(3, 4, 5);
   Ray ray(Point3(0, 0, 0), direction);
-  EXPECT_DOUBLE_EQ(1, ray.direction().Length());
+  EXPECT_SCALAR_EQ(1, ray.direction().Length());
 }
 
 TEST(Ray, PointAt) {
@@ -46,9 +47,9 @@ TEST(Ray, PointAt) {
   Point3 location = ray.PointAt(t);
   Point3 expected = origin + t * direction.Normalized();
 
-  EXPECT_DOUBLE_EQ(expected.x(), location.x());
-  EXPECT_DOUBLE_EQ(expected.y(), location.y());
-  EXPECT_DOUBLE_EQ(expected.z(), location.z());
+  EXPECT_SCALAR_EQ(expected.x(), location.x());
+  EXPECT_SCALAR_EQ(expected.y(), location.y());
+  EXPECT_SCALAR_EQ(expected.z(), location.z());
 }
 
 TEST(Ray, Range) {
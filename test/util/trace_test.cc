@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the Trace class.
+ * Author: Dino Wernli
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "util/trace.h"
+
+namespace {
+
+// Returns the number of times needle occurs in haystack.
+size_t Count(const std::string& haystack, const std::string& needle) {
+  size_t count = 0;
+  for (size_t pos = haystack.find(needle); pos != std::string::npos;
+       pos = haystack.find(needle, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(Trace, WritesSpansOfAllThreads) {
+  Trace::Enable();
+  EXPECT_TRUE(Trace::IsEnabled());
+  {
+    ScopedSpan span("TraceTest::Outer");
+    std::thread thread([]() {
+      Trace::SetThreadName("Trace \"test\" thread");
+      ScopedSpan first("TraceTest::Inner");
+      ScopedSpan second("TraceTest::Inner");
+    });
+    thread.join();
+  }
+
+  char path[] = "/tmp/trace_testXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  EXPECT_TRUE(Trace::WriteFile(path));
+
+  std::ifstream file(path);
+  std::string contents((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+  unlink(path);
+
+  // The spans of the terminated thread are still there.
+  EXPECT_EQ(0, contents.find("{\"displayTimeUnit\": \"ms\""));
+  const std::string complete = "\", \"ph\": \"X\"";
+  EXPECT_EQ(1, Count(contents, "\"name\": \"TraceTest::Outer" + complete));
+  EXPECT_EQ(2, Count(contents, "\"name\": \"TraceTest::Inner" + complete));
+  EXPECT_EQ(1, Count(contents, "\"ph\": \"M\""));
+  EXPECT_EQ(1, Count(contents, "\"name\": \"Trace \\\"test\\\" thread\""));
+  EXPECT_EQ("\n]}\n", contents.substr(contents.size() - 4));
+}
+
+}  // namespace
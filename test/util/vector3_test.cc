@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Unit tests for the Vector3 class.
+ * Author: Dino Wernli
+ */
+
+#include <gtest/gtest.h>
+
+#include "util/vector3.h"
+#include "test/test_util.h"
+
+namespace {
+
+TEST(Vector3, Indexing) {
+  Vector3 v(1, 2, 3);
+  EXPECT_SCALAR_EQ(1, v[Axis::x()]);
+  EXPECT_SCALAR_EQ(2, v[Axis::y()]);
+  EXPECT_SCALAR_EQ(3, v[Axis::z()]);
+
+  v[Axis::y()] = 5;
+  EXPECT_SCALAR_EQ(1, v.x());
+  EXPECT_SCALAR_EQ(5, v.y());
+  EXPECT_SCALAR_EQ(3, v.z());
+}
+
+TEST(Vector3, Arithmetic) {
+  Vector3 v = 2 * (Vector3(1, 2, 3) + Vector3(1, 1, 1)) - Vector3(0, 1, 2);
+  EXPECT_SCALAR_EQ(4, v.x());
+  EXPECT_SCALAR_EQ(5, v.y());
+  EXPECT_SCALAR_EQ(6, v.z());
+
+  v /= 2;
+  EXPECT_SCALAR_EQ(2, v.x());
+  EXPECT_SCALAR_EQ(2.5, v.y());
+  EXPECT_SCALAR_EQ(3, v.z());
+
+  Vector3 w = -(v * Vector3(1, 2, 0));
+  EXPECT_SCALAR_EQ(-2, w.x());
+  EXPECT_SCALAR_EQ(-5, w.y());
+  EXPECT_SCALAR_EQ(0, w.z());
+}
+
+TEST(Vector3, DotAndCross) {
+  Vector3 a(1, 2, 3);
+  Vector3 b(-2, 0, 4);
+  EXPECT_SCALAR_EQ(10, a.Dot(b));
+
+  Vector3 c = a.Cross(b);
+  EXPECT_SCALAR_EQ(8, c.x());
+  EXPECT_SCALAR_EQ(-10, c.y());
+  EXPECT_SCALAR_EQ(4, c.z());
+  EXPECT_SCALAR_EQ(0, c.Dot(a));
+  EXPECT_SCALAR_EQ(0, c.Dot(b));
+
+  Vector3 z = Vector3(1, 0, 0).Cross(Vector3(0, 1, 0));
+  EXPECT_SCALAR_EQ(0, z.x());
+  EXPECT_SCALAR_EQ(0, z.y());
+  EXPECT_SCALAR_EQ(1, z.z());
+}
+
+TEST(Vector3, Normalized) {
+  Vector3 v(3, 0, 4);
+  EXPECT_SCALAR_EQ(25, v.SquaredLength());
+  EXPECT_SCALAR_EQ(5, v.Length());
+
+  Vector3 n = v.Normalized();
+  EXPECT_SCALAR_EQ(1, n.Length());
+  EXPECT_SCALAR_EQ(0.6, n.x());
+  EXPECT_SCALAR_EQ(0, n.y());
+  EXPECT_SCALAR_EQ(0.8, n.z());
+
+  // Normalizing must work across many orders of magnitude.
+  for (Scalar scale = 1e-3; scale < 1e4; scale *= 7) {
+    Vector3 v(scale, 2 * scale, -scale);
+    EXPECT_SCALAR_EQ(1, v.Normalized().Length());
+  }
+}
+
+TEST(Vector3, ReflectedOnPlane) {
+  Vector3 r = Vector3(1, -1, 0).ReflectedOnPlane(Vector3(0, 1, 0));
+  EXPECT_NEAR(1 / std::sqrt(2), r.x(), SCALAR_TOLERANCE);
+  EXPECT_NEAR(1 / std::sqrt(2), r.y(), SCALAR_TOLERANCE);
+  EXPECT_SCALAR_EQ(0, r.z());
+}
+
+}
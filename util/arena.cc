@@ -0,0 +1,72 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "util/arena.h"
+
+#include <cstdint>
+#include <glog/logging.h>
+
+Arena::Arena(size_t block_size)
+    : current_(NULL), remaining_(0), block_size_(block_size), bytes_used_(0),
+      bytes_reserved_(0) {
+}
+
+Arena::~Arena() {
+}
+
+void* Arena::Allocate(size_t bytes, size_t alignment) {
+  DCHECK((alignment & (alignment - 1)) == 0) << "Alignment not a power of 2";
+  bytes_used_ += bytes;
+
+  // Large allocations do not waste the rest of the current block.
+  if (bytes > block_size_ / 4) {
+    char* block = AddBlock(bytes + alignment);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(block);
+    return block + ((alignment - address % alignment) % alignment);
+  }
+
+  uintptr_t address = reinterpret_cast<uintptr_t>(current_);
+  size_t padding = (alignment - address % alignment) % alignment;
+  if (current_ == NULL || padding + bytes > remaining_) {
+    current_ = AddBlock(block_size_);
+    remaining_ = block_size_;
+    address = reinterpret_cast<uintptr_t>(current_);
+    padding = (alignment - address % alignment) % alignment;
+  }
+  char* result = current_ + padding;
+  current_ += padding + bytes;
+  remaining_ -= padding + bytes;
+  return result;
+}
+
+char* Arena::AddBlock(size_t bytes) {
+  blocks_.push_back(std::unique_ptr<char[]>(new char[bytes]));
+  bytes_reserved_ += bytes;
+  return blocks_.back().get();
+}
+
+// static
+const size_t Arena::kDefaultBlockSize;
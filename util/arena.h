@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * A monotonic allocator which hands out memory from large blocks and releases
+ * all of it at once when it is destroyed. This replaces millions of small
+ * allocations, e.g., one per triangle, by a few large ones, and makes freeing
+ * them a matter of releasing the blocks. Destructors of objects in the arena
+ * are never run, so these objects must not own anything outside the arena.
+ * Author: Dino Wernli
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "util/no_copy_assign.h"
+
+class Arena {
+ public:
+  // Allocations larger than a quarter of block_size get a block of their own.
+  explicit Arena(size_t block_size = kDefaultBlockSize);
+  virtual ~Arena();
+  NO_COPY_ASSIGN(Arena);
+
+  // Returns uninitialized memory of the passed size and alignment, which must
+  // be a power of 2. The memory stays valid until the arena is destroyed.
+  void* Allocate(size_t bytes, size_t alignment);
+
+  // Constructs a T in the arena. Its destructor is never run.
+  template<typename T, typename... Args>
+  T* New(Args&&... args) {
+    return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Copies the n objects starting at source into the arena. Returns NULL if n
+  // is 0.
+  template<typename T>
+  T* Copy(const T* source, size_t n) {
+    if (n == 0) {
+      return NULL;
+    }
+    T* target = static_cast<T*>(Allocate(n * sizeof(T), alignof(T)));
+    std::uninitialized_copy(source, source + n, target);
+    return target;
+  }
+
+  // Returns the bytes handed out and the bytes of all blocks.
+  size_t bytes_used() const { return bytes_used_; }
+  size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  // Allocates a new block of at least the passed size and returns its start.
+  char* AddBlock(size_t bytes);
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+
+  // The unused part of the current block.
+  char* current_;
+  size_t remaining_;
+
+  size_t block_size_;
+  size_t bytes_used_;
+  size_t bytes_reserved_;
+
+  static const size_t kDefaultBlockSize = 1 << 20;
+};
+
+#endif  /* ARENA_H_ */
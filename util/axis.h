@@ -44,6 +44,10 @@ class Axis {
   Axis Next() const { return Axis(id_ + 1); }
   bool operator==(const Axis& other) const { return other.id_ == id_; }
 
+  // Returns 0, 1 or 2 for x, y and z respectively. Allows branchless indexing
+  // into the coordinates of vectors and points.
+  size_t index() const { return id_; }
+
  private:
   size_t id_;
 };
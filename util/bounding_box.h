@@ -45,7 +45,7 @@ class BoundingBox {
   // Creates a minimal box which contains both points.
   BoundingBox(const Point3& p1, const Point3& p2);
 
-  virtual ~BoundingBox();
+  ~BoundingBox();
 
   // Changes the bounding box to include point.
   BoundingBox& Include(const Point3& point);
@@ -29,71 +29,68 @@
 #define COLOR3_H_
 
 #include "proto/util/color_data.pb.h"
+#include "util/lanes.h"
 #include "util/numeric.h"
 
 using raytracer::ColorData;
 
 class Color3 {
  public:
-  Color3() : r_(0), g_(0), b_(0) {}
+  Color3() {}
   Color3(const Intensity& r, const Intensity& g, const Intensity& b)
-      : r_(r), g_(g), b_(b) {}
+      : lanes_(r, g, b) {}
+  explicit Color3(const Lanes<Intensity>& lanes) : lanes_(lanes) {}
 
   Color3 operator*(const Scalar& rhs) const {
-    return Color3(r_ * rhs, g_ * rhs, b_ * rhs);
+    return Color3(lanes_ * Lanes<Intensity>::Splat(rhs));
   }
 
   Color3 operator/(const Scalar& rhs) const {
-    return Color3(r_ / rhs, g_ / rhs, b_ / rhs);
+    return Color3(lanes_ / Lanes<Intensity>::Splat(rhs));
   }
 
   Color3& operator+=(const Color3& rhs) {
-    r_ += rhs.r_;
-    g_ += rhs.g_;
-    b_ += rhs.b_;
+    lanes_ += rhs.lanes_;
     return *this;
   }
 
   // Returns a new color which contains the values of this clamped to [0, 1].
   Color3 Clamped() const {
-    Scalar r = r_ < 0 ? 0 : r_;
-    r = r > 1 ? 1 : r;
-
-    Scalar g = g_ < 0 ? 0 : g_;
-    g = g > 1 ? 1 : g;
-
-    Scalar b = b_ < 0 ? 0 : b_;
-    b = b > 1 ? 1 : b;
-
-    return Color3(r, g, b);
+    const Lanes<Intensity> zero = Lanes<Intensity>::Splat(0);
+    const Lanes<Intensity> one = Lanes<Intensity>::Splat(1);
+    return Color3(Lanes<Intensity>::Min(Lanes<Intensity>::Max(lanes_, zero),
+                                        one));
   }
 
-  const Intensity& r() const { return r_; }
-  const Intensity& g() const { return g_; }
-  const Intensity& b() const { return b_; }
+  const Intensity& r() const { return lanes_[0]; }
+  const Intensity& g() const { return lanes_[1]; }
+  const Intensity& b() const { return lanes_[2]; }
+
+  // Exposes the channels for element-wise operations.
+  const Lanes<Intensity>& lanes() const { return lanes_; }
 
  private:
-  Intensity r_, g_, b_;
+  Lanes<Intensity> lanes_;
 };
 
 inline Color3 operator-(const Color3& lhs, const Color3& rhs)
 {
-  return Color3(lhs.r() - rhs.r(), lhs.g() - rhs.g(), lhs.b() - rhs.b());
+  return Color3(lhs.lanes() - rhs.lanes());
 }
 
 inline Color3 operator+(const Color3& lhs, const Color3& rhs)
 {
-  return Color3(lhs.r() + rhs.r(), lhs.g() + rhs.g(), lhs.b() + rhs.b());
+  return Color3(lhs.lanes() + rhs.lanes());
 }
 
 inline Color3 operator*(const Color3& lhs, const Color3& rhs)
 {
-  return Color3(lhs.r() * rhs.r(), lhs.g() * rhs.g(), lhs.b() * rhs.b());
+  return Color3(lhs.lanes() * rhs.lanes());
 }
 
 inline Color3 operator*(const Scalar& lhs, const Color3& rhs)
 {
-  return Color3(lhs * rhs.r(), lhs * rhs.g(), lhs * rhs.b());
+  return Color3(Lanes<Intensity>::Splat(lhs) * rhs.lanes());
 }
 
 template<class OStream>
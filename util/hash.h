@@ -21,55 +21,46 @@
 // SOFTWARE.
 
 /*
- * Consists of a point and a normal in 3D space. Used as a building block of
- * triangles.
- *
+ * A 64 bit FNV-1a hash which can be fed incrementally. Used to derive keys for
+ * on-disk caches. Not suitable for cryptographic purposes.
  * Author: Dino Wernli
  */
 
-#ifndef VERTEX_H_
-#define VERTEX_H_
+#ifndef HASH_H_
+#define HASH_H_
 
-#include "util/point3.h"
-#include "util/vector3.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
 
-class Vertex {
+class Hash {
  public:
-  // Copies the passed point and normal and allocated copies.
-  Vertex(const Point3& point, const Vector3& normal)
-      : point_(new Point3(point)), normal_(new Vector3(normal)),
-        owns_data_(true) {
-  }
+  Hash() : value_(kOffsetBasis) {}
 
-  // Takes no ownership of the passed pointers and copies them. The underlying
-  // data is referenced (if it changes, so will this vertex).
-  Vertex(const Point3* point, const Vector3* normal)
-      : point_(point), normal_(normal), owns_data_(false) {
+  // Adds "size" raw bytes starting at data to the hash.
+  Hash& Add(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      value_ = (value_ ^ bytes[i]) * kPrime;
+    }
+    return *this;
   }
 
-  ~Vertex() {
-    if (owns_data_) {
-      delete point_;
-      delete normal_;
-    }
+  // Adds the bytes of a value of a type without padding or pointers.
+  template<typename T>
+  Hash& Add(const T& value) { return Add(&value, sizeof(value)); }
+
+  Hash& Add(const std::string& value) {
+    return Add(value.size()).Add(value.data(), value.size());
   }
 
-  const Point3& point() const { return *point_; }
-  const Vector3& normal() const { return *normal_; }
+  uint64_t value() const { return value_; }
 
  private:
-  const Point3* point_;
-  const Vector3* normal_;
+  static const uint64_t kOffsetBasis = 14695981039346656037ULL;
+  static const uint64_t kPrime = 1099511628211ULL;
 
-  // This flag is false iff the data was allocated in a mesh and the vertex is
-  // not expected to clean it up.
-  bool owns_data_;
+  uint64_t value_;
 };
 
-template<class OStream>
-OStream& operator<<(OStream& os, const Vertex& v)
-{
-  return os << "(vertex: " << v.point() << ", " << v.normal() << ")";
-}
-
-#endif  /* VERTEX_H_ */
+#endif  /* HASH_H_ */
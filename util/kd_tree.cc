@@ -26,23 +26,34 @@
 
 #include "kd_tree.h"
 
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <glog/logging.h>
+#include <unistd.h>
 
 #include "parser/scene_parser.h"
 #include "proto/config/scene_config.pb.h"
 #include "renderer/intersection_data.h"
+#include "renderer/trace_counters.h"
 #include "scene/element.h"
 #include "scene/geometry/triangle.h"
 #include "scene/material.h"
+#include "util/arena.h"
+#include "util/hash.h"
+#include "util/memory_report.h"
 #include "util/ray.h"
+#include "util/trace.h"
 
 // Convenience method which takes care of linearly testing all elements for
 // intersection.
-static bool LinearIntersect(const std::vector<const Element*>& elements,
+static bool LinearIntersect(const GeometryStore& store,
+                            const std::vector<GeometryStore::Ref>& refs,
                             const Ray& ray, IntersectionData* data) {
   bool intersected = false;
-  for (size_t i = 0; i < elements.size(); ++i) {
-    intersected = elements[i]->Intersect(ray, data) || intersected;
+  for (size_t i = 0; i < refs.size(); ++i) {
+    intersected = store.Intersect(refs[i], ray, data) || intersected;
     if (intersected && data == NULL) {
       return true;
     }
@@ -50,68 +61,89 @@ static bool LinearIntersect(const std::vector<const Element*>& elements,
   return intersected;
 }
 
+// The memory used while building a tree. Elements are referred to by their
+// index into "bounds", which holds the boxes of all elements contiguously, so
+// distributing them to the children does not touch the elements themselves.
+// Nodes and the element lists of the leaves are allocated in the arena and
+// released together after flattening. The element list of an inner node is
+// only needed until its children are built, so it lives in a list per depth
+// which is reused by the next node at that depth.
+struct KdTree::BuildBuffers {
+  // Returns the emptied list for nodes at the passed depth.
+  std::vector<uint32_t>* ListAt(size_t depth) {
+    // Unlike a vector, the deque keeps the lists of lower depths in place.
+    while (lists.size() <= depth) {
+      lists.push_back(std::vector<uint32_t>());
+    }
+    lists[depth].clear();
+    return &lists[depth];
+  }
+
+  std::vector<BoundingBox> bounds;
+  Arena arena;
+  std::deque<std::vector<uint32_t>> lists;
+
+  // The sizes of the flattened tree, so that it is allocated only once.
+  size_t num_nodes = 1;
+  size_t num_leaf_elements = 0;
+};
+
 struct KdTree::Node {
   // Creates an empty leaf. Sets axis to X.
   Node();
 
   // Only to be called on leaves. Expects depth to be the current depth of the
-  // leaf before splitting.
+  // leaf before splitting and elements to be the list of the leaf, which is
+  // copied to the arena of buffers if the node remains a leaf. Visualization
+  // triangles are appended to the bounds of buffers as well.
   void Split(size_t depth, const BoundingBox& box,
+             std::vector<uint32_t>* elements,
              const SplittingStrategy& strategy, int visualization_depth,
              const Material* visualization_material,
-             std::vector<Triangle*>* visualization_elements);
-
-  // It is theoretically possible for leaves to have empty element vectors.
-  bool IsLeaf() const { return left.get() == NULL && right.get() == NULL; }
+             std::vector<Triangle*>* visualization_elements,
+             BuildBuffers* buffers);
 
-  size_t NumElements() const {
-    return IsLeaf() ? elements->size() :
-        left->NumElements() + right->NumElements();
-  }
+  // It is theoretically possible for leaves to have no elements.
+  bool IsLeaf() const { return left == NULL && right == NULL; }
 
-  // Returns whether or not the ray intersects any of the elements. If data is
-  // not NULL, data about the first intersection is stored.
-  bool Intersect(const Ray& ray, Scalar t_near, Scalar t_far,
-                 IntersectionData* data = NULL) const;
+  // The element indices of a leaf, allocated in the arena.
+  const uint32_t* elements;
+  size_t num_elements;
 
-  std::unique_ptr<std::vector<const Element*>> elements;
-  std::unique_ptr<Node> left;
-  std::unique_ptr<Node> right;
+  Node* left;
+  Node* right;
   Scalar split_position;
   Axis split_axis;
 };
 
-KdTree::Node::Node() : split_axis(Axis::x()) {
-  this->elements.reset(new std::vector<const Element*>());
+KdTree::Node::Node()
+    : elements(NULL), num_elements(0), left(NULL), right(NULL),
+      split_position(0), split_axis(Axis::x()) {
 }
 
 void KdTree::Node::Split(size_t depth, const BoundingBox& box,
+                         std::vector<uint32_t>* elements,
                          const SplittingStrategy& strategy, int v_depth,
                          const Material* v_material,
-                         std::vector<Triangle*>* v_elements) {
+                         std::vector<Triangle*>* v_elements,
+                         BuildBuffers* buffers) {
   CHECK(IsLeaf()) << "Split() can only be called on leaf nodes";
-  SplitInformation info = strategy.ComputeSplit(depth, box, *elements);
+  const std::vector<BoundingBox>& bounds = buffers->bounds;
+  SplitInformation info = strategy.ComputeSplit(depth, box, *elements, bounds);
 
   if (!info.should_split) {
+    this->elements = buffers->arena.Copy(elements->data(), elements->size());
+    num_elements = elements->size();
+    buffers->num_leaf_elements += num_elements;
     return;
   }
 
   split_position = info.split_position;
   split_axis = info.split_axis;
-  left.reset(new Node());
-  right.reset(new Node());
+  left = buffers->arena.New<Node>();
+  right = buffers->arena.New<Node>();
+  buffers->num_nodes += 2;
 
-  // Move elements to either 1 or 2 relevant children.
-  for (size_t i = 0; i < elements->size(); ++i) {
-    if (elements->at(i)->bounding_box()->min()[split_axis] <= split_position) {
-      left->elements->push_back(elements->at(i));
-    }
-    if (elements->at(i)->bounding_box()->max()[split_axis] >= split_position) {
-      right->elements->push_back(elements->at(i));
-    }
-  }
-
-  // Recursively split children.
   Point3 left_max = box.max();
   left_max[split_axis] = split_position;
   BoundingBox left_box(box.min(), left_max);
@@ -121,7 +153,9 @@ void KdTree::Node::Split(size_t depth, const BoundingBox& box,
   BoundingBox right_box(right_min, box.max());
 
   // Add some visualization planes to children.
-  if ((int)depth <= v_depth) {
+  const size_t num_visualization = (int)depth <= v_depth ? 2 : 0;
+  const uint32_t first_visualization = buffers->bounds.size();
+  if (num_visualization > 0) {
     Point3 p1(left_max);
     Point3 p2(right_min);
 
@@ -136,124 +170,441 @@ void KdTree::Node::Split(size_t depth, const BoundingBox& box,
     Triangle* t1 = new Triangle(p1, p2, p3, *v_material);
     Triangle* t2 = new Triangle(p1, p2, p4, *v_material);
     v_elements->push_back(t1);
-    right->elements->push_back(t1);
-    left->elements->push_back(t1);
-
     v_elements->push_back(t2);
-    right->elements->push_back(t2);
-    left->elements->push_back(t2);
+    buffers->bounds.push_back(*t1->bounding_box());
+    buffers->bounds.push_back(*t2->bounding_box());
   }
 
-  // Split children an clean up.
-  left->Split(depth + 1, left_box, strategy, v_depth, v_material, v_elements);
-  right->Split(depth + 1, right_box, strategy, v_depth, v_material, v_elements);
-  elements.reset();
+  // Move elements to either 1 or 2 relevant children and split them. The
+  // children share the list of the next depth, so the left subtree is built
+  // completely before the list of the right child is filled.
+  std::vector<uint32_t>* child_elements = buffers->ListAt(depth + 1);
+  for (size_t i = 0; i < elements->size(); ++i) {
+    const uint32_t element = (*elements)[i];
+    if (bounds[element].min()[split_axis] <= split_position) {
+      child_elements->push_back(element);
+    }
+  }
+  for (size_t i = 0; i < num_visualization; ++i) {
+    child_elements->push_back(first_visualization + i);
+  }
+  left->Split(depth + 1, left_box, child_elements, strategy, v_depth,
+              v_material, v_elements, buffers);
+
+  child_elements = buffers->ListAt(depth + 1);
+  for (size_t i = 0; i < elements->size(); ++i) {
+    const uint32_t element = (*elements)[i];
+    if (bounds[element].max()[split_axis] >= split_position) {
+      child_elements->push_back(element);
+    }
+  }
+  for (size_t i = 0; i < num_visualization; ++i) {
+    child_elements->push_back(first_visualization + i);
+  }
+  right->Split(depth + 1, right_box, child_elements, strategy, v_depth,
+               v_material, v_elements, buffers);
   CHECK(!IsLeaf()) << "KdTree node still leaf after split";
 }
 
-bool KdTree::Node::Intersect(const Ray& ray, Scalar t_near,
-    Scalar t_far, IntersectionData* data) const {
-  if (IsLeaf()) {
-    return LinearIntersect(*elements, ray, data);
+KdTree::KdTree(SplittingStrategy* strategy, int visualization_depth,
+                 Material* vistualization_material)
+    : nodes_(NULL), num_nodes_(0), refs_(NULL), strategy_(strategy),
+      visualization_depth_(visualization_depth),
+      visualization_material_(vistualization_material), config_hash_(0) {
+}
+
+KdTree::~KdTree() {
+}
+
+size_t KdTree::NumElementsInLeaves() const {
+  size_t result = 0;
+  for (size_t i = 0; i < num_nodes_; ++i) {
+    if (nodes_[i].IsLeaf()) {
+      result += nodes_[i].num_elements;
+    }
+  }
+  return result;
+}
+
+void KdTree::AddMemoryUsage(MemoryReport* report) const {
+  report->Add("kd_tree_nodes", num_nodes_ * sizeof(FlatNode), num_nodes_);
+
+  std::vector<bool> referenced(store_.size(), false);
+  size_t num_references = 0;
+  size_t num_duplicates = 0;
+  for (size_t i = 0; i < num_nodes_; ++i) {
+    if (!nodes_[i].IsLeaf()) {
+      continue;
+    }
+    const GeometryStore::Ref* first = refs_ + nodes_[i].child_or_first;
+    for (size_t j = 0; j < nodes_[i].num_elements; ++j) {
+      const size_t index = store_.DenseIndex(first[j]);
+      if (referenced[index]) {
+        ++num_duplicates;
+      }
+      referenced[index] = true;
+      ++num_references;
+    }
+  }
+  const size_t num_unique = num_references - num_duplicates;
+  report->Add("kd_tree_leaf_references",
+              num_unique * sizeof(GeometryStore::Ref), num_unique);
+  report->Add("kd_tree_duplicated_references",
+              num_duplicates * sizeof(GeometryStore::Ref), num_duplicates);
+
+  const size_t num_lists = bounded_elements_.size() + unbounded_refs_.size();
+  report->Add("kd_tree_element_lists",
+              bounded_elements_.capacity() * sizeof(const Element*) +
+                  unbounded_refs_.capacity() * sizeof(GeometryStore::Ref),
+              num_lists);
+  report->Add("kd_tree_geometry_store", store_.ByteSize(), store_.size());
+}
+
+void KdTree::Init(const std::vector<const Element*>& elements) {
+  ScopedSpan span("KdTree::Init");
+  nodes_ = NULL;
+  num_nodes_ = 0;
+  refs_ = NULL;
+  node_storage_.clear();
+  ref_storage_.clear();
+  cache_file_.reset();
+  store_.Clear();
+  bounded_elements_.clear();
+  bounding_box_.reset(new BoundingBox());
+  unbounded_refs_.clear();
+  visualization_elements_.clear();
+
+  std::vector<const Element*> unbounded_elements;
+  for (auto it = elements.begin(); it != elements.end(); ++it) {
+    const Element* element = *it;
+    if (element->IsBounded()) {
+      bounding_box_->Include(*element->bounding_box());
+      bounded_elements_.push_back(element);
+    } else {
+      unbounded_elements.push_back(element);
+    }
+  }
+  const size_t n_bounded_elements = bounded_elements_.size();
+
+  // The references of the bounded elements are the ones stored in the leaves.
+  std::vector<GeometryStore::Ref> bounded_refs;
+  bounded_refs.reserve(n_bounded_elements);
+  for (size_t i = 0; i < n_bounded_elements; ++i) {
+    bounded_refs.push_back(store_.Add(bounded_elements_[i]));
+  }
+  for (size_t i = 0; i < unbounded_elements.size(); ++i) {
+    unbounded_refs_.push_back(store_.Add(unbounded_elements[i]));
+  }
+
+  const bool use_cache = !cache_directory_.empty() && visualization_depth_ < 0;
+  const uint64_t key = use_cache ? ComputeCacheKey() : 0;
+  if (use_cache && LoadCache(key)) {
+    LOG(INFO) << "Loaded KdTree for " << n_bounded_elements
+              << " bounded elements from: " << CachePath(key);
+    return;
+  }
+
+  CHECK(n_bounded_elements < UINT32_MAX) << "Too many elements";
+  BuildBuffers buffers;
+  buffers.bounds.reserve(n_bounded_elements);
+  std::vector<uint32_t>* root_elements = buffers.ListAt(0);
+  root_elements->reserve(n_bounded_elements);
+  for (size_t i = 0; i < n_bounded_elements; ++i) {
+    buffers.bounds.push_back(*bounded_elements_[i]->bounding_box());
+    root_elements->push_back(i);
+  }
+  Node* root = buffers.arena.New<Node>();
+  std::vector<Triangle*> visualization_elements;
+  root->Split(0, *bounding_box_, root_elements, *strategy_,
+              visualization_depth_, visualization_material_.get(),
+              &visualization_elements, &buffers);
+  // Visualization elements are referenced by the leaves as well, with the
+  // indices following those of the other elements in order of creation.
+  for (size_t i = 0; i < visualization_elements.size(); ++i) {
+    visualization_elements_.push_back(
+        std::unique_ptr<Element>(visualization_elements[i]));
+    bounded_elements_.push_back(visualization_elements[i]);
+    bounded_refs.push_back(store_.Add(visualization_elements[i]));
+  }
+  CHECK(bounded_elements_.size() < UINT32_MAX) << "Too many elements";
+
+  node_storage_.reserve(buffers.num_nodes);
+  ref_storage_.reserve(buffers.num_leaf_elements);
+  Flatten(*root, bounded_refs, &node_storage_, &ref_storage_);
+  nodes_ = node_storage_.data();
+  num_nodes_ = node_storage_.size();
+  refs_ = ref_storage_.data();
+
+  LOG(INFO) << "Built KdTree for " << n_bounded_elements
+            << " bounded elements and " << unbounded_refs_.size()
+            << " unbounded elements";
+  LOG(INFO) << "Number of (bounded) elements in KdTree leaves is "
+            << NumElementsInLeaves();
+
+  if (use_cache && !StoreCache(key)) {
+    LOG(WARNING) << "Unable to write KdTree cache: " << CachePath(key);
+  }
+}
+
+// static
+void KdTree::Flatten(const Node& node,
+                     const std::vector<GeometryStore::Ref>& element_refs,
+                     std::vector<FlatNode>* nodes,
+                     std::vector<GeometryStore::Ref>* refs) {
+  // Value initialization also zeroes the padding, which keeps cache files
+  // deterministic.
+  const size_t index = nodes->size();
+  nodes->push_back(FlatNode());
+
+  if (node.IsLeaf()) {
+    FlatNode& flat = (*nodes)[index];
+    flat.axis = kLeaf;
+    flat.child_or_first = refs->size();
+    flat.num_elements = node.num_elements;
+    for (size_t i = 0; i < node.num_elements; ++i) {
+      refs->push_back(element_refs[node.elements[i]]);
+    }
+    return;
   }
 
+  Flatten(*node.left, element_refs, nodes, refs);
+  const size_t right = nodes->size();
+  Flatten(*node.right, element_refs, nodes, refs);
+
+  // The recursive calls may have moved the node.
+  FlatNode& flat = (*nodes)[index];
+  flat.split_position = node.split_position;
+  flat.axis = node.split_axis.index();
+  flat.child_or_first = right;
+}
+
+bool KdTree::Intersect(const Ray& ray, IntersectionData* data) const {
+  if (nodes_ == NULL) {
+    LOG(WARNING) << "Called intersect on uninitialized KdTree. Returning false";
+    return false;
+  }
+
+  bool intersected = LinearIntersect(store_, unbounded_refs_, ray, data);
+  Scalar t_near, t_far;
+  if (bounding_box_->Intersect(ray, &t_near, &t_far)) {
+    TraceCounters* counters = &TraceCounters::ForThisThread();
+    intersected = IntersectNode(0, ray, t_near, t_far, data, counters)
+                  | intersected;
+  }
+  return intersected;
+}
+
+bool KdTree::IntersectNode(size_t index, const Ray& ray, Scalar t_near,
+                           Scalar t_far, IntersectionData* data,
+                           TraceCounters* counters) const {
+  ++counters->kd_tree_nodes_visited;
+  const FlatNode& node = nodes_[index];
+  if (node.IsLeaf()) {
+    bool intersected = false;
+    const GeometryStore::Ref* ref = refs_ + node.child_or_first;
+    const GeometryStore::Ref* end = ref + node.num_elements;
+    for (; ref != end; ++ref) {
+      ++counters->leaf_element_tests;
+      intersected = store_.Intersect(*ref, ray, data) || intersected;
+      if (intersected && data == NULL) {
+        return true;
+      }
+    }
+    return intersected;
+  }
+
+  const Axis split_axis(node.axis);
   Scalar ray_direction_axis = ray.direction()[split_axis];
   Scalar ray_origin_axis = ray.origin()[split_axis];
+  size_t left = index + 1;
+  size_t right = node.child_or_first;
 
   // Ray not moving in direction of the split, so only intersections with one
   // side are possible.
   if (ray_direction_axis == 0) {
-    if (ray_origin_axis <= split_position) {
-      return left->Intersect(ray, t_near, t_far, data);
+    if (ray_origin_axis <= node.split_position) {
+      return IntersectNode(left, ray, t_near, t_far, data, counters);
     } else {
-      return right->Intersect(ray, t_near, t_far, data);
+      return IntersectNode(right, ray, t_near, t_far, data, counters);
     }
   }
 
   // Determine where on the ray the split happens.
-  Scalar t_split = (split_position - ray_origin_axis) / ray_direction_axis;
+  Scalar t_split = (node.split_position - ray_origin_axis) / ray_direction_axis;
   bool intersected = false;
 
   // Determine which is the first child traversed by the ray.
-  const Node* first = left.get();
-  const Node* second = right.get();
+  size_t first = left;
+  size_t second = right;
   if (ray_direction_axis < 0) std::swap(first, second);
 
   // Call recursively.
   if (t_split > t_far) {
-    return first->Intersect(ray, t_near, t_far, data);
+    return IntersectNode(first, ray, t_near, t_far, data, counters);
   } else if (t_split < t_near) {
-    return second->Intersect(ray, t_near, t_far, data);
-  } else if ((intersected = first->Intersect(ray, t_near, t_split, data))
+    return IntersectNode(second, ray, t_near, t_far, data, counters);
+  } else if ((intersected = IntersectNode(first, ray, t_near, t_split, data,
+                                          counters))
              && (data == NULL || data->t < t_split)) {
       return true;
   } else {
-    return second->Intersect(ray, t_split, t_far, data) || intersected;
+    return IntersectNode(second, ray, t_split, t_far, data, counters)
+           || intersected;
   }
 }
 
-KdTree::KdTree(SplittingStrategy* strategy, int visualization_depth,
-                 Material* vistualization_material)
-    : strategy_(strategy), visualization_depth_(visualization_depth),
-      visualization_material_(vistualization_material) {
+// Identifies KdTree cache files. Must change whenever the layout changes.
+static const char kCacheMagic[8] = { 'R', 'T', 'K', 'D', 'T', 'R', '0', '2' };
+
+// The arrays in a cache file start at multiples of this many bytes.
+static const uint64_t kCacheAlignment = 64;
+
+// The start of every cache file. The nodes and element references follow at
+// the stored offsets.
+struct CacheHeader {
+  char magic[8];
+  uint32_t scalar_size;
+  uint32_t node_size;
+  uint64_t key;
+  uint64_t num_elements;
+  uint64_t num_nodes;
+  uint64_t nodes_offset;
+  uint64_t num_refs;
+  uint64_t refs_offset;
+};
+
+static uint64_t AlignCacheOffset(uint64_t offset) {
+  return (offset + kCacheAlignment - 1) / kCacheAlignment * kCacheAlignment;
 }
 
-KdTree::~KdTree() {
+static void InitCacheHeader(uint64_t key, uint64_t num_elements,
+                            uint64_t num_nodes, uint64_t node_size,
+                            uint64_t num_refs, CacheHeader* header) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, kCacheMagic, sizeof(kCacheMagic));
+  header->scalar_size = sizeof(Scalar);
+  header->node_size = node_size;
+  header->key = key;
+  header->num_elements = num_elements;
+  header->num_nodes = num_nodes;
+  header->nodes_offset = AlignCacheOffset(sizeof(CacheHeader));
+  header->num_refs = num_refs;
+  header->refs_offset =
+      AlignCacheOffset(header->nodes_offset + num_nodes * node_size);
 }
 
-size_t KdTree::NumElementsInLeaves() const {
-  if (root_.get() == NULL) {
-    return 0;
-  } else {
-    return root_->NumElements();
+uint64_t KdTree::ComputeCacheKey() const {
+  // The built tree only depends on the configuration and on the bounding boxes
+  // of the bounded elements in their order. The references stored in the
+  // leaves additionally depend on the types of the elements.
+  Hash hash;
+  hash.Add(config_hash_).Add(bounded_elements_.size());
+  for (auto it = bounded_elements_.begin(); it != bounded_elements_.end();
+       ++it) {
+    hash.Add(static_cast<uint32_t>((*it)->type()));
+    const BoundingBox& box = *(*it)->bounding_box();
+    hash.Add(box.min().x()).Add(box.min().y()).Add(box.min().z());
+    hash.Add(box.max().x()).Add(box.max().y()).Add(box.max().z());
   }
+  return hash.value();
 }
 
-void KdTree::Init(std::vector<std::unique_ptr<Element>>* elements) {
-  root_.reset(new Node());
-  bounding_box_.reset(new BoundingBox());
-  unbounded_elements_.clear();
+std::string KdTree::CachePath(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.kdtree",
+           static_cast<unsigned long long>(key));
+  return cache_directory_ + name;
+}
 
-  for (auto it = elements->begin(); it != elements->end(); ++it) {
-    const Element* element = it->get();
-    if (element->IsBounded()) {
-      bounding_box_->Include(*element->bounding_box());
-      root_->elements->push_back(element);
-    } else {
-      unbounded_elements_.push_back(element);
-    }
+bool KdTree::LoadCache(uint64_t key) {
+  std::unique_ptr<MappedFile> file(MappedFile::Open(CachePath(key)));
+  if (file.get() == NULL || file->size() < sizeof(CacheHeader)) {
+    return false;
   }
 
-  std::vector<Triangle*> visualization_elements;
-  const size_t n_bounded_elements = root_->elements->size();
-  root_->Split(0, *bounding_box_, *strategy_, visualization_depth_,
-               visualization_material_.get(), &visualization_elements);
-  LOG(INFO) << "Built KdTree for " << n_bounded_elements
-            << " bounded elements and " << unbounded_elements_.size()
-            << " unbounded elements";
-  LOG(INFO) << "Number of (bounded) elements in KdTree leaves is "
-            << NumElementsInLeaves();
+  CacheHeader header;
+  memcpy(&header, file->data(), sizeof(header));
+  if (header.num_nodes == 0 || header.num_nodes > file->size() ||
+      header.num_refs > file->size()) {
+    return false;
+  }
 
-  // Add visualization elements to scene in order for them to get cleaned up
-  // eventually.
-  for (size_t i = 0; i < visualization_elements.size(); ++i) {
-    std::unique_ptr<Element> element(visualization_elements[i]);
-    elements->push_back(std::move(element));
+  CacheHeader expected;
+  InitCacheHeader(key, bounded_elements_.size(), header.num_nodes,
+                  sizeof(FlatNode), header.num_refs, &expected);
+  const uint64_t end =
+      expected.refs_offset + expected.num_refs * sizeof(GeometryStore::Ref);
+  if (memcmp(&header, &expected, sizeof(header)) != 0 || end > file->size()) {
+    return false;
   }
-}
 
-bool KdTree::Intersect(const Ray& ray, IntersectionData* data) const {
-  if (root_.get() == NULL) {
-    LOG(WARNING) << "Called intersect on uninitialized KdTree. Returning false";
+  const FlatNode* nodes =
+      reinterpret_cast<const FlatNode*>(file->data() + header.nodes_offset);
+  const GeometryStore::Ref* refs = reinterpret_cast<const GeometryStore::Ref*>(
+      file->data() + header.refs_offset);
+  if (!ValidateCache(nodes, header.num_nodes, refs, header.num_refs)) {
+    LOG(WARNING) << "Ignoring invalid KdTree cache: " << CachePath(key);
     return false;
   }
 
-  bool intersected = LinearIntersect(unbounded_elements_, ray, data);
-  Scalar t_near, t_far;
-  if (bounding_box_->Intersect(ray, &t_near, &t_far)) {
-    intersected = root_->Intersect(ray, t_near, t_far, data) | intersected;
+  nodes_ = nodes;
+  num_nodes_ = header.num_nodes;
+  refs_ = refs;
+  cache_file_ = std::move(file);
+  return true;
+}
+
+bool KdTree::ValidateCache(const FlatNode* nodes, uint64_t num_nodes,
+                           const GeometryStore::Ref* refs,
+                           uint64_t num_refs) const {
+  // Children always follow their parent, so traversal cannot loop.
+  for (uint64_t i = 0; i < num_nodes; ++i) {
+    const FlatNode& node = nodes[i];
+    if (node.IsLeaf()) {
+      if (static_cast<uint64_t>(node.child_or_first) + node.num_elements >
+          num_refs) {
+        return false;
+      }
+    } else if (node.axis >= 3 || i + 1 >= node.child_or_first ||
+               node.child_or_first >= num_nodes) {
+      return false;
+    }
   }
-  return intersected;
+  for (uint64_t i = 0; i < num_refs; ++i) {
+    if (!store_.Contains(refs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool KdTree::StoreCache(uint64_t key) const {
+  CacheHeader header;
+  InitCacheHeader(key, bounded_elements_.size(), num_nodes_, sizeof(FlatNode),
+                  ref_storage_.size(), &header);
+
+  // Write to a temporary file first so that other processes never see a
+  // partially written cache file.
+  const std::string path = CachePath(key);
+  const std::string temporary_path = path + "." + std::to_string(getpid());
+  std::ofstream stream(temporary_path.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  static const char kZeros[kCacheAlignment] = {};
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.write(kZeros, header.nodes_offset - sizeof(header));
+  stream.write(reinterpret_cast<const char*>(nodes_),
+               num_nodes_ * sizeof(FlatNode));
+  stream.write(kZeros, header.refs_offset - header.nodes_offset -
+                       num_nodes_ * sizeof(FlatNode));
+  stream.write(reinterpret_cast<const char*>(refs_),
+               ref_storage_.size() * sizeof(GeometryStore::Ref));
+  stream.close();
+
+  if (!stream || rename(temporary_path.c_str(), path.c_str()) != 0) {
+    remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
 }
 
 // static
@@ -279,6 +630,13 @@ KdTree* KdTree::FromConfig(const raytracer::KdTreeConfig& config) {
   } else {
     LOG(WARNING) << "Unknown KdTree splitting strategy, skipping KdTree";
   }
+
+  if (tree != NULL && config.has_cache_directory()) {
+    raytracer::KdTreeConfig key_config(config);
+    key_config.clear_cache_directory();
+    tree->set_cache(config.cache_directory(),
+                    Hash().Add(key_config.SerializeAsString()).value());
+  }
   return tree;
 }
 
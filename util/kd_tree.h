@@ -26,22 +26,36 @@
  * separate structure and are considered during intersection. Elements are only
  * contained in leaves of the tree.
  *
+ * Once built, the tree is stored as a flat array of nodes in depth-first order
+ * plus an array of element references into a GeometryStore, which lets the
+ * leaves intersect their elements without virtual calls. If a cache directory
+ * is configured, these arrays are written to a file named after a hash of the
+ * element types, the element bounding boxes and the tree configuration. Later
+ * builds for the same input map that file instead of building the tree again.
+ *
  * Author: Dino Wernli
  */
 
 #ifndef KD_TREE_H_
 #define KD_TREE_H_
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "scene/geometry/geometry_store.h"
 #include "util/axis.h"
 #include "util/bounding_box.h"
+#include "util/mapped_file.h"
 #include "util/splitting_strategy.h"
 
 class Element;
 class IntersectionData;
+class Material;
+class MemoryReport;
 class Ray;
+struct TraceCounters;
 
 namespace raytracer {
 class KdTreeConfig;
@@ -58,35 +72,121 @@ class KdTree {
 
   // Builds a tree which contains pointers to the passed elements. No ownership
   // is taken for any of the elements, none of the elements will be changed.
-  // Any visualization triangles created are added to elements.
-  void Init(std::vector<std::unique_ptr<Element>>* elements);
+  // Any visualization triangles created are owned by the tree.
+  void Init(const std::vector<const Element*>& elements);
 
   // Returns whether or not the ray intersects any of the elements. If data is
   // not NULL, data about the first intersection is stored. If init has not
   // been called, this returns false.
   bool Intersect(const Ray& ray, IntersectionData* data = NULL) const;
 
+  // Adds the nodes, the element references of the leaves, the lists of
+  // elements and the geometry store to report. References to elements which
+  // are already referenced by another leaf are reported separately as
+  // duplicates.
+  void AddMemoryUsage(MemoryReport* report) const;
+
+  // Stores built trees in "directory" and reuses them in later calls to Init.
+  // The key "config_hash" must identify the splitting strategy. An empty
+  // directory disables caching. Trees with visualization are never cached.
+  void set_cache(const std::string& directory, uint64_t config_hash) {
+    cache_directory_ = directory;
+    config_hash_ = config_hash;
+  }
+
   static KdTree* FromConfig(const raytracer::KdTreeConfig& config);
 
  private:
+  // A node used while building the tree.
   struct Node;
-  std::unique_ptr<Node> root_;
+
+  // The memory of a single build of the tree.
+  struct BuildBuffers;
+
+  // A node of the flattened tree. The left child of an inner node directly
+  // follows its parent.
+  struct FlatNode {
+    // Returns true if this is a leaf, in which case "child_or_first" and
+    // "num_elements" describe a range of the element references.
+    bool IsLeaf() const { return axis == kLeaf; }
+
+    Scalar split_position;
+    uint32_t axis;
+    uint32_t child_or_first;
+    uint32_t num_elements;
+  };
+
+  // Appends the subtree at node in depth-first order. The element indices of
+  // the leaves are replaced by the references at those indices.
+  static void Flatten(const Node& node,
+                      const std::vector<GeometryStore::Ref>& element_refs,
+                      std::vector<FlatNode>* nodes,
+                      std::vector<GeometryStore::Ref>* refs);
+
+  // Returns whether or not the ray intersects any element below the node with
+  // the passed index, considering only the segment [t_near, t_far]. The
+  // traversal is counted in counters, which belong to the calling thread.
+  bool IntersectNode(size_t index, const Ray& ray, Scalar t_near,
+                     Scalar t_far, IntersectionData* data,
+                     TraceCounters* counters) const;
+
+  // Returns the hash of the elements and configuration used as cache key.
+  uint64_t ComputeCacheKey() const;
+
+  // Returns the path of the cache file for the passed key.
+  std::string CachePath(uint64_t key) const;
+
+  // Attempts to map a previously stored tree. Returns false if there is none.
+  bool LoadCache(uint64_t key);
+
+  // Returns whether the nodes and references of a cached tree only point to
+  // nodes, references and elements of store_ which exist.
+  bool ValidateCache(const FlatNode* nodes, uint64_t num_nodes,
+                     const GeometryStore::Ref* refs, uint64_t num_refs) const;
+
+  // Writes the flattened tree to the cache. Returns false on failure.
+  bool StoreCache(uint64_t key) const;
 
   // Returns the total number of elements stored in all leaves of the tree.
   // Note that this potentially elements multiple times if they were added to
   // the left and to the right.
   size_t NumElementsInLeaves() const;
 
+  // The flattened tree, pointing either into the vectors below or into a
+  // mapped cache file. The leaves hold references into store_.
+  const FlatNode* nodes_;
+  size_t num_nodes_;
+  const GeometryStore::Ref* refs_;
+  std::vector<FlatNode> node_storage_;
+  std::vector<GeometryStore::Ref> ref_storage_;
+  std::unique_ptr<MappedFile> cache_file_;
+
+  // All elements of the tree. The bounded elements are added first, so their
+  // references only depend on the bounded elements and can be cached.
+  GeometryStore store_;
+
+  // All bounded elements in the order in which they were added to store_.
+  std::vector<const Element*> bounded_elements_;
+
   // A bounding box which contains all bounded elements of the tree.
   std::unique_ptr<BoundingBox> bounding_box_;
 
   // A separate container for all elements which are not bounded.
-  std::vector<const Element*> unbounded_elements_;
+  std::vector<GeometryStore::Ref> unbounded_refs_;
+
+  // The planes created to visualize the splits, referenced by the leaves.
+  std::vector<std::unique_ptr<Element>> visualization_elements_;
 
   std::unique_ptr<SplittingStrategy> strategy_;
 
   int visualization_depth_;
   std::unique_ptr<Material> visualization_material_;
+
+  std::string cache_directory_;
+  uint64_t config_hash_;
+
+  // The value of FlatNode::axis which marks leaves.
+  static const uint32_t kLeaf = 3;
 };
 
 #endif  /* KD_TREE_H_ */
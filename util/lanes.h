@@ -0,0 +1,239 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * A group of three numbers supporting element-wise arithmetic. Used as the
+ * storage of Vector3, Point3 and Color3. Defined entirely in this header for
+ * performance reasons.
+ *
+ * If RAYTRACER_SIMD is defined, the elements live in a single SSE/AVX register
+ * (using the GCC vector extensions) padded to four lanes. The padding lane is
+ * never read, so its value is irrelevant. Otherwise, the elements are stored in
+ * a plain array.
+ * Author: Dino Wernli
+ */
+
+#ifndef LANES_H_
+#define LANES_H_
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(RAYTRACER_SIMD) && defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "util/numeric.h"
+
+#ifdef RAYTRACER_SIMD
+
+// Maps an element type to the corresponding four lane vector type. The
+// alignment of the vector types is lowered to the one of the element type so
+// that classes containing lanes can still be allocated with new and stored in
+// standard containers.
+template<typename T> struct LaneTraits;
+
+template<> struct LaneTraits<float> {
+  typedef float Vector __attribute__((vector_size(16), aligned(4)));
+  typedef int Mask __attribute__((vector_size(16)));
+};
+
+template<> struct LaneTraits<double> {
+  typedef double Vector __attribute__((vector_size(32), aligned(8)));
+  typedef long long Mask __attribute__((vector_size(32)));
+};
+
+template<typename T>
+class Lanes {
+ public:
+  Lanes() : vector_(Splat(0).vector_) {}
+  Lanes(const T& x, const T& y, const T& z) {
+    Vector vector = { x, y, z, 0 };
+    vector_ = vector;
+  }
+
+  // Returns lanes which hold "value" in every element.
+  static Lanes Splat(const T& value) {
+    Vector vector = { value, value, value, value };
+    return Lanes(vector);
+  }
+
+  static Lanes Min(const Lanes& a, const Lanes& b) {
+    return Lanes(a.vector_ < b.vector_ ? a.vector_ : b.vector_);
+  }
+
+  static Lanes Max(const Lanes& a, const Lanes& b) {
+    return Lanes(a.vector_ > b.vector_ ? a.vector_ : b.vector_);
+  }
+
+  const T& operator[](size_t index) const { return elements_[index]; }
+  T& operator[](size_t index) { return elements_[index]; }
+
+  // Returns the sum of the three elements.
+  T Sum() const { return elements_[0] + elements_[1] + elements_[2]; }
+
+  // Returns the elements rotated by one position, i.e., (y, z, x).
+  Lanes Rotated() const {
+#ifdef __clang__
+    return Lanes(__builtin_shufflevector(vector_, vector_, 1, 2, 0, 3));
+#else
+    Mask mask = { 1, 2, 0, 3 };
+    return Lanes(__builtin_shuffle(vector_, mask));
+#endif
+  }
+
+  Lanes operator-() const { return Lanes(-vector_); }
+
+  Lanes& operator+=(const Lanes& rhs) {
+    vector_ += rhs.vector_;
+    return *this;
+  }
+
+  Lanes& operator-=(const Lanes& rhs) {
+    vector_ -= rhs.vector_;
+    return *this;
+  }
+
+  Lanes& operator*=(const Lanes& rhs) {
+    vector_ *= rhs.vector_;
+    return *this;
+  }
+
+  Lanes& operator/=(const Lanes& rhs) {
+    vector_ /= rhs.vector_;
+    return *this;
+  }
+
+ private:
+  typedef typename LaneTraits<T>::Vector Vector;
+  typedef typename LaneTraits<T>::Mask Mask;
+
+  explicit Lanes(const Vector& vector) : vector_(vector) {}
+
+  union {
+    Vector vector_;
+    T elements_[4];
+  };
+};
+
+#else
+
+template<typename T>
+class Lanes {
+ public:
+  Lanes() { elements_[0] = elements_[1] = elements_[2] = 0; }
+  Lanes(const T& x, const T& y, const T& z) {
+    elements_[0] = x;
+    elements_[1] = y;
+    elements_[2] = z;
+  }
+
+  // Returns lanes which hold "value" in every element.
+  static Lanes Splat(const T& value) { return Lanes(value, value, value); }
+
+  static Lanes Min(const Lanes& a, const Lanes& b) {
+    return Lanes(a[0] < b[0] ? a[0] : b[0],
+                 a[1] < b[1] ? a[1] : b[1],
+                 a[2] < b[2] ? a[2] : b[2]);
+  }
+
+  static Lanes Max(const Lanes& a, const Lanes& b) {
+    return Lanes(a[0] > b[0] ? a[0] : b[0],
+                 a[1] > b[1] ? a[1] : b[1],
+                 a[2] > b[2] ? a[2] : b[2]);
+  }
+
+  const T& operator[](size_t index) const { return elements_[index]; }
+  T& operator[](size_t index) { return elements_[index]; }
+
+  // Returns the sum of the three elements.
+  T Sum() const { return elements_[0] + elements_[1] + elements_[2]; }
+
+  // Returns the elements rotated by one position, i.e., (y, z, x).
+  Lanes Rotated() const {
+    return Lanes(elements_[1], elements_[2], elements_[0]);
+  }
+
+  Lanes operator-() const {
+    return Lanes(-elements_[0], -elements_[1], -elements_[2]);
+  }
+
+  Lanes& operator+=(const Lanes& rhs) {
+    for (size_t i = 0; i < 3; ++i) elements_[i] += rhs.elements_[i];
+    return *this;
+  }
+
+  Lanes& operator-=(const Lanes& rhs) {
+    for (size_t i = 0; i < 3; ++i) elements_[i] -= rhs.elements_[i];
+    return *this;
+  }
+
+  Lanes& operator*=(const Lanes& rhs) {
+    for (size_t i = 0; i < 3; ++i) elements_[i] *= rhs.elements_[i];
+    return *this;
+  }
+
+  Lanes& operator/=(const Lanes& rhs) {
+    for (size_t i = 0; i < 3; ++i) elements_[i] /= rhs.elements_[i];
+    return *this;
+  }
+
+ private:
+  T elements_[3];
+};
+
+#endif  /* RAYTRACER_SIMD */
+
+template<typename T>
+inline Lanes<T> operator+(Lanes<T> lhs, const Lanes<T>& rhs) {
+  return lhs += rhs;
+}
+
+template<typename T>
+inline Lanes<T> operator-(Lanes<T> lhs, const Lanes<T>& rhs) {
+  return lhs -= rhs;
+}
+
+template<typename T>
+inline Lanes<T> operator*(Lanes<T> lhs, const Lanes<T>& rhs) {
+  return lhs *= rhs;
+}
+
+template<typename T>
+inline Lanes<T> operator/(Lanes<T> lhs, const Lanes<T>& rhs) {
+  return lhs /= rhs;
+}
+
+// Returns 1 / sqrt(value). Single precision SIMD builds use the approximate
+// reciprocal square root instruction refined by one Newton-Raphson step, which
+// is accurate to a few ulps.
+inline Scalar ReciprocalSqrt(const Scalar& value) {
+#if defined(RAYTRACER_SIMD) && defined(RAYTRACER_SINGLE_PRECISION) && \
+    defined(__SSE__)
+  const float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(value)));
+  return estimate * (1.5f - 0.5f * value * estimate * estimate);
+#else
+  return 1 / std::sqrt(value);
+#endif
+}
+
+#endif  /* LANES_H_ */
@@ -0,0 +1,123 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "util/memory_report.h"
+
+#include <fstream>
+#include <glog/logging.h>
+#include <iomanip>
+#include <sstream>
+
+// Returns bytes in a human readable unit.
+static std::string FormatBytes(size_t bytes) {
+  static const char* kUnits[] = { "B", "KiB", "MiB", "GiB" };
+  static const size_t kNumUnits = sizeof(kUnits) / sizeof(kUnits[0]);
+
+  double value = bytes;
+  size_t unit = 0;
+  while (value >= 1024 && unit + 1 < kNumUnits) {
+    value /= 1024;
+    ++unit;
+  }
+  std::stringstream stream;
+  stream << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << " "
+         << kUnits[unit];
+  return stream.str();
+}
+
+MemoryReport::MemoryReport() {
+}
+
+MemoryReport::~MemoryReport() {
+}
+
+void MemoryReport::Add(const std::string& name, size_t bytes, size_t count) {
+  Category* category = const_cast<Category*>(Find(name));
+  if (category == NULL) {
+    categories_.push_back(Category(name));
+    category = &categories_.back();
+  }
+  category->bytes += bytes;
+  category->count += count;
+}
+
+size_t MemoryReport::bytes(const std::string& name) const {
+  const Category* category = Find(name);
+  return category == NULL ? 0 : category->bytes;
+}
+
+size_t MemoryReport::count(const std::string& name) const {
+  const Category* category = Find(name);
+  return category == NULL ? 0 : category->count;
+}
+
+size_t MemoryReport::total_bytes() const {
+  size_t total = 0;
+  for (auto it = categories_.begin(); it != categories_.end(); ++it) {
+    total += it->bytes;
+  }
+  return total;
+}
+
+void MemoryReport::Log() const {
+  LOG(INFO) << "Memory used: " << FormatBytes(total_bytes());
+  for (auto it = categories_.begin(); it != categories_.end(); ++it) {
+    LOG(INFO) << "  " << it->name << ": " << FormatBytes(it->bytes) << " in "
+              << it->count << " objects";
+  }
+}
+
+std::string MemoryReport::ToJson() const {
+  std::stringstream stream;
+  stream << "{\n";
+  for (auto it = categories_.begin(); it != categories_.end(); ++it) {
+    stream << "  \"" << it->name << "\": { \"bytes\": " << it->bytes
+           << ", \"count\": " << it->count << " },\n";
+  }
+  stream << "  \"total_bytes\": " << total_bytes() << "\n"
+         << "}\n";
+  return stream.str();
+}
+
+bool MemoryReport::WriteJson(const std::string& path) const {
+  std::ofstream file(path.c_str());
+  file << ToJson();
+  if (!file) {
+    LOG(ERROR) << "Failed to write memory report to: " << path;
+    return false;
+  }
+  return true;
+}
+
+const MemoryReport::Category* MemoryReport::Find(
+    const std::string& name) const {
+  for (auto it = categories_.begin(); it != categories_.end(); ++it) {
+    if (it->name == name) {
+      return &*it;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Collects how many bytes the data structures of a rendering occupy, grouped
+ * into named categories. Only the payload is counted, not the bookkeeping of
+ * the heap allocator. Categories keep the order in which they were first
+ * added, so reports of the same scene can be compared line by line.
+ * Author: Dino Wernli
+ */
+
+#ifndef MEMORY_REPORT_H_
+#define MEMORY_REPORT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class MemoryReport {
+ public:
+  MemoryReport();
+  virtual ~MemoryReport();
+
+  // Adds "bytes" which hold "count" objects to the category "name".
+  void Add(const std::string& name, size_t bytes, size_t count);
+
+  // Returns the bytes and the objects added to "name" so far.
+  size_t bytes(const std::string& name) const;
+  size_t count(const std::string& name) const;
+
+  // Returns the bytes of all categories.
+  size_t total_bytes() const;
+
+  // Logs the bytes of every category and the total.
+  void Log() const;
+
+  // Returns a JSON object with the bytes and the count of every category and
+  // the total bytes.
+  std::string ToJson() const;
+
+  // Writes ToJson() to the file at path. Returns false on failure.
+  bool WriteJson(const std::string& path) const;
+
+ private:
+  struct Category {
+    Category(const std::string& name_) : name(name_), bytes(0), count(0) {}
+    std::string name;
+    size_t bytes;
+    size_t count;
+  };
+
+  // Returns the category called name or NULL if there is none.
+  const Category* Find(const std::string& name) const;
+
+  std::vector<Category> categories_;
+};
+
+#endif  /* MEMORY_REPORT_H_ */
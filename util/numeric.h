@@ -29,12 +29,26 @@
 #ifndef NUMERIC_H_
 #define NUMERIC_H_
 
-#define EPSILON 0.000001
 #define PI 3.1415926535897932384626433
 #define MILLI_TO_MICRO 1000
 
-// Represents the type of a scalar value such as a coefficient of a vector.
+// Represents the type of a scalar value such as a coefficient of a vector. The
+// precision is selected at build time, double precision is the default.
+#ifdef RAYTRACER_SINGLE_PRECISION
+typedef float Scalar;
+
+// Rounding errors of computed positions are much larger in single precision,
+// so offsets along rays need to be larger to avoid self-intersection.
+#define EPSILON 0.0001
+#else
 typedef double Scalar;
+#define EPSILON 0.000001
+#endif
+
+// Determinants with absolute value below this are treated as 0, e.g., for rays
+// which are parallel to a triangle. Independent of EPSILON because the scale
+// of a determinant depends on the size of the geometry.
+#define DETERMINANT_EPSILON 0.000001
 
 // Represents the value which can be taken by a red, green or blue channel.
 typedef float Intensity;
@@ -0,0 +1,168 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "util/perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <glog/logging.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Sets the type and config describing event to perf_event_open.
+static void EventConfig(PerfCounters::Event event,
+                        struct perf_event_attr* attr) {
+  const uint64_t cache_read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  switch (event) {
+    case PerfCounters::CYCLES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PerfCounters::INSTRUCTIONS:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PerfCounters::L1D_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_L1D | cache_read_miss;
+      break;
+    case PerfCounters::LLC_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_LL | cache_read_miss;
+      break;
+    case PerfCounters::BRANCH_MISSES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+  }
+}
+
+PerfCounters::Values::Values() {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    counts[i] = 0;
+    valid[i] = false;
+  }
+}
+
+PerfCounters::Values& PerfCounters::Values::operator+=(const Values& other) {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    counts[i] += other.counts[i];
+    valid[i] = valid[i] || other.valid[i];
+  }
+  return *this;
+}
+
+PerfCounters::PerfCounters() {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    EventConfig(static_cast<Event>(i), &attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Counts the calling thread on any CPU.
+    fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds_[i] < 0) {
+      DVLOG(1) << "Performance counter " << Name(static_cast<Event>(i))
+               << " unavailable: " << strerror(errno);
+    }
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+    }
+  }
+}
+
+bool PerfCounters::IsAvailable() const {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (fds_[i] >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfCounters::Start() {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (fds_[i] >= 0) {
+      ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+void PerfCounters::Stop() {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (fds_[i] >= 0) {
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+}
+
+PerfCounters::Values PerfCounters::Read() const {
+  Values values;
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    // The value followed by the times the counter was enabled and running.
+    uint64_t data[3];
+    if (fds_[i] < 0 || read(fds_[i], data, sizeof(data)) != sizeof(data)) {
+      continue;
+    }
+    values.valid[i] = true;
+    if (data[2] == 0) {
+      continue;
+    }
+    values.counts[i] = data[2] < data[1]
+        ? static_cast<uint64_t>(double(data[0]) * data[1] / data[2])
+        : data[0];
+  }
+  return values;
+}
+
+// static
+const char* PerfCounters::Name(Event event) {
+  switch (event) {
+    case CYCLES: return "cycles";
+    case INSTRUCTIONS: return "instructions";
+    case L1D_MISSES: return "L1D misses";
+    case LLC_MISSES: return "LLC misses";
+    case BRANCH_MISSES: return "branch misses";
+  }
+  return "unknown";
+}
+
+// static
+const size_t PerfCounters::kNumEvents;
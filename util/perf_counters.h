@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Hardware performance counters of the calling thread, read through
+ * perf_event_open(2). Each event is opened on its own, so events which the CPU
+ * or the kernel do not provide are simply missing. In containers, usually none
+ * of them are available.
+ * Author: Dino Wernli
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "util/no_copy_assign.h"
+
+class PerfCounters {
+ public:
+  enum Event {
+    CYCLES = 0,
+    INSTRUCTIONS = 1,
+    L1D_MISSES = 2,
+    LLC_MISSES = 3,
+    BRANCH_MISSES = 4,
+  };
+  static const size_t kNumEvents = 5;
+
+  // The counts of all events. Counts of unavailable events are 0 and marked
+  // as invalid.
+  struct Values {
+    Values();
+    Values& operator+=(const Values& other);
+
+    uint64_t counts[kNumEvents];
+    bool valid[kNumEvents];
+  };
+
+  // Opens the counters for the calling thread. They only count while started.
+  PerfCounters();
+  virtual ~PerfCounters();
+  NO_COPY_ASSIGN(PerfCounters);
+
+  // Returns whether any of the events could be opened.
+  bool IsAvailable() const;
+
+  // Resets and starts all counters.
+  void Start();
+
+  // Stops all counters.
+  void Stop();
+
+  // Returns the counts since the last start. If the kernel had to multiplex
+  // the counters, the counts are extrapolated to the full time.
+  Values Read() const;
+
+  // Returns a short human readable name of the event.
+  static const char* Name(Event event);
+
+ private:
+  int fds_[kNumEvents];
+};
+
+#endif  /* PERF_COUNTERS_H_ */
@@ -33,6 +33,7 @@
 
 #include "proto/util/point_data.pb.h"
 #include "util/axis.h"
+#include "util/lanes.h"
 #include "util/numeric.h"
 #include "util/vector3.h"
 
@@ -40,77 +41,62 @@ using raytracer::PointData;
 
 class Point3 {
  public:
-  Point3() : x_(0), y_(0), z_(0) {}
+  Point3() {}
 
   Point3(const Scalar& x, const Scalar& y, const Scalar& z)
-      : x_(x), y_(y), z_(z) {}
+      : lanes_(x, y, z) {}
+  explicit Point3(const Lanes<Scalar>& lanes) : lanes_(lanes) {}
 
   // Returns a vector from *this to target.
   Vector3 VectorTo(const Point3& target) const {
-    return Vector3(target.x_ - x_, target.y_ - y_, target.z_ - z_);
+    return Vector3(target.lanes_ - lanes_);
   }
 
   // Returns a vector from the origin to this point.
   Vector3 VectorFromOrigin() const {
-    return Vector3(x_, y_, z_);
+    return Vector3(lanes_);
   }
 
   // Replaces the data of this point with the data from other.
   void ReplaceWith(const Point3& other) {
-    x_ = other.x_;
-    y_ = other.y_;
-    z_ = other.z_;
+    lanes_ = other.lanes_;
   }
 
-  const Scalar& x() const { return x_; }
-  const Scalar& y() const { return y_; }
-  const Scalar& z() const { return z_; }
-
-  const Scalar& operator[](Axis axis) const {
-    if (axis == Axis::x()) {
-      return x_;
-    } else if (axis == Axis::y()) {
-      return y_;
-    } else {
-      return z_;
-    }
-  }
+  const Scalar& x() const { return lanes_[0]; }
+  const Scalar& y() const { return lanes_[1]; }
+  const Scalar& z() const { return lanes_[2]; }
 
-  Scalar& operator[](Axis axis) {
-    if (axis == Axis::x()) {
-      return x_;
-    } else if (axis == Axis::y()) {
-      return y_;
-    } else {
-      return z_;
-    }
-  }
+  // Exposes the coordinates for element-wise operations with other types.
+  const Lanes<Scalar>& lanes() const { return lanes_; }
+
+  const Scalar& operator[](Axis axis) const { return lanes_[axis.index()]; }
+  Scalar& operator[](Axis axis) { return lanes_[axis.index()]; }
 
   static Scalar SquaredDistance(const Point3& first, const Point3& second) {
     return first.VectorTo(second).SquaredLength();
   }
 
   static Scalar Distance(const Point3& first, const Point3& second) {
-    return sqrt(SquaredDistance(first, second));
+    return std::sqrt(SquaredDistance(first, second));
   }
 
  private:
-  Scalar x_, y_, z_;
+  Lanes<Scalar> lanes_;
 };
 
 inline Point3 operator*(const Scalar& lhs, const Point3& rhs)
 {
-  return Point3(lhs * rhs.x(), lhs * rhs.y(), lhs * rhs.z());
+  return Point3(Lanes<Scalar>::Splat(lhs) * rhs.lanes());
 }
 
 inline Point3 operator+(const Point3& lhs, const Vector3& rhs)
 {
-  return Point3(lhs.x() + rhs.x(), lhs.y() + rhs.y(), lhs.z() + rhs.z());
+  return Point3(lhs.lanes() + rhs.lanes());
 }
 
 inline Point3 operator-(const Point3& lhs, const Vector3& rhs)
 {
-  return Point3(lhs.x() - rhs.x(), lhs.y() - rhs.y(), lhs.z() - rhs.z());
+  return Point3(lhs.lanes() - rhs.lanes());
 }
 
 template<class OStream>
@@ -28,6 +28,7 @@
 #ifndef RANDOM_H_
 #define RANDOM_H_
 
+#include <atomic>
 #include <random>
 
 #include "util/numeric.h"
@@ -35,11 +36,30 @@
 class Random {
  public:
   Random() {
-    std::random_device device;
-    random_engine_.seed(device());
+    if (fixed_seed()) {
+      // Give every generator its own sequence, numbered in order of creation.
+      random_engine_.seed(seed() + instances()++);
+    } else {
+      std::random_device device;
+      random_engine_.seed(device());
+    }
     distribution_ = std::uniform_real_distribution<Scalar>(0, 1);
   }
 
+  // Makes all generators created afterwards deterministic. With more than one
+  // rendering thread, the order in which the per-thread generators are created
+  // still varies between runs.
+  static void SetSeed(unsigned int value) {
+    seed() = value;
+    instances() = 0;
+    fixed_seed() = true;
+  }
+
+  // Makes generators created afterwards seed from std::random_device again.
+  static void ClearSeed() {
+    fixed_seed() = false;
+  }
+
   // Returns a uniform random number in [-boundary, boundary].
   Scalar Get(Scalar boundary) {
     return Get(-boundary, boundary);
@@ -51,6 +71,19 @@ class Random {
   }
 
  private:
+  static std::atomic<bool>& fixed_seed() {
+    static std::atomic<bool> fixed_seed(false);
+    return fixed_seed;
+  }
+  static std::atomic<unsigned int>& seed() {
+    static std::atomic<unsigned int> seed(0);
+    return seed;
+  }
+  static std::atomic<unsigned int>& instances() {
+    static std::atomic<unsigned int> instances(0);
+    return instances;
+  }
+
   std::mt19937 random_engine_;
   std::uniform_real_distribution<Scalar> distribution_;
 };
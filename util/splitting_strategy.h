@@ -29,9 +29,9 @@
 #ifndef SPLITTING_STRATEGY_H_
 #define SPLITTING_STRATEGY_H_
 
+#include <cstdint>
 #include <vector>
 
-#include "scene/element.h"
 #include "util/axis.h"
 #include "util/bounding_box.h"
 #include "util/no_copy_assign.h"
@@ -47,16 +47,20 @@ struct SplitInformation {
 
 class SplittingStrategy {
  protected:
-  typedef std::vector<const Element*>& Elements;
+  // The elements of a node, as indices into the bounds of all elements.
+  typedef std::vector<uint32_t> Elements;
+  typedef std::vector<BoundingBox> Bounds;
 
  public:
   virtual ~SplittingStrategy() {}
 
   // Computes whether or not to split, a split axis and a split position based
-  // on the passed information. If the conclusion is to not split, then the
-  // rest of the data in the returned object is meaningless.
+  // on the passed information. The box of element i is bounds[i]. If the
+  // conclusion is to not split, then the rest of the data in the returned
+  // object is meaningless.
   virtual SplitInformation ComputeSplit(size_t depth, const BoundingBox& box,
-                                        const Elements& elements) const = 0;
+                                        const Elements& elements,
+                                        const Bounds& bounds) const = 0;
 };
 
 // This strategy just splits in the middle of the bounding box and cycles
@@ -68,7 +72,8 @@ class MidpointSplit : public SplittingStrategy {
   NO_COPY_ASSIGN(MidpointSplit);
 
   virtual SplitInformation ComputeSplit(size_t depth, const BoundingBox& box,
-                                        const Elements& elements) const {
+                                        const Elements& elements,
+                                        const Bounds& bounds) const {
     Axis axis(depth);
     Scalar min = box.min()[axis];
     Scalar max = box.max()[axis];
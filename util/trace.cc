@@ -0,0 +1,199 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Author: Dino Wernli
+ */
+
+#include "util/trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <glog/logging.h>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Span {
+  const char* name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// The spans of a single thread. The mutex is only ever contended while the
+// trace is being written.
+struct ThreadBuffer {
+  std::mutex mutex;
+  size_t id;
+  std::string name;
+  std::vector<Span> spans;
+};
+
+// Owns the buffers of all threads, so that the spans of threads which have
+// already terminated are still written.
+struct Registry {
+  Registry() : enabled(false) {}
+
+  std::atomic<bool> enabled;
+  std::chrono::steady_clock::time_point origin;
+  std::string exit_path;
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+ThreadBuffer& LocalBuffer() {
+  static thread_local ThreadBuffer* buffer = NULL;
+  if (buffer == NULL) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer));
+    buffer = registry.buffers.back().get();
+    buffer->id = registry.buffers.size();
+  }
+  return *buffer;
+}
+
+// Escapes the characters which may not appear in a JSON string.
+std::string Escape(const std::string& text) {
+  std::string result;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+  }
+  return result;
+}
+
+// Writes all recorded spans to path and stores their number in num_spans.
+bool WriteSpans(const std::string& path, size_t* num_spans) {
+  std::ofstream file(path.c_str());
+  const pid_t pid = getpid();
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  // Chrome expects timestamps in microseconds.
+  file << std::fixed << std::setprecision(3);
+  bool first = true;
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> registry_lock(registry.mutex);
+  for (const auto& buffer : registry.buffers) {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (!buffer->name.empty()) {
+      file << (first ? "\n" : ",\n")
+           << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+           << ", \"tid\": " << buffer->id << ", \"args\": {\"name\": \""
+           << Escape(buffer->name) << "\"}}";
+      first = false;
+    }
+    for (const Span& span : buffer->spans) {
+      file << (first ? "\n" : ",\n")
+           << "{\"name\": \"" << Escape(span.name)
+           << "\", \"ph\": \"X\", \"pid\": " << pid << ", \"tid\": "
+           << buffer->id << ", \"ts\": " << span.begin / 1000.0
+           << ", \"dur\": " << (span.end - span.begin) / 1000.0 << "}";
+      first = false;
+    }
+    *num_spans += buffer->spans.size();
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+// Logging may already be shut down when this runs.
+void WriteAtExit() {
+  const std::string& path = GetRegistry().exit_path;
+  size_t num_spans = 0;
+  if (!WriteSpans(path, &num_spans)) {
+    fprintf(stderr, "Failed to write trace to: %s\n", path.c_str());
+  }
+}
+
+}  // namespace
+
+// static
+void Trace::Enable() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (!registry.enabled) {
+    registry.origin = std::chrono::steady_clock::now();
+    registry.enabled = true;
+  }
+}
+
+// static
+bool Trace::IsEnabled() {
+  return GetRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+// static
+void Trace::WriteFileAtExit(const std::string& path) {
+  Enable();
+  GetRegistry().exit_path = path;
+  std::atexit(&WriteAtExit);
+}
+
+// static
+void Trace::SetThreadName(const std::string& name) {
+  if (!IsEnabled()) {
+    return;
+  }
+  ThreadBuffer& buffer = LocalBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+// static
+void Trace::AddSpan(const char* name, uint64_t begin, uint64_t end) {
+  ThreadBuffer& buffer = LocalBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.spans.push_back(Span{name, begin, end});
+}
+
+// static
+uint64_t Trace::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - GetRegistry().origin).count();
+}
+
+// static
+bool Trace::WriteFile(const std::string& path) {
+  size_t num_spans = 0;
+  if (!WriteSpans(path, &num_spans)) {
+    LOG(ERROR) << "Failed to write trace to: " << path;
+    return false;
+  }
+  LOG(INFO) << "Wrote " << num_spans << " trace spans to: " << path;
+  return true;
+}
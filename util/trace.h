@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 dinowernli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Records spans of time in which the threads of the process do something
+ * interesting, and writes them as a Chrome trace event file which can be
+ * inspected with chrome://tracing or Perfetto. Every thread appends to its own
+ * buffer. Recording a span while tracing is disabled costs a single check.
+ * Author: Dino Wernli
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "util/no_copy_assign.h"
+
+class Trace {
+ public:
+  // Starts recording spans on all threads.
+  static void Enable();
+  static bool IsEnabled();
+
+  // Enables tracing and writes the trace to path when the process exits.
+  static void WriteFileAtExit(const std::string& path);
+
+  // Writes all spans recorded so far to path. Returns false on failure.
+  static bool WriteFile(const std::string& path);
+
+  // Sets the name under which the spans of the calling thread are shown.
+  static void SetThreadName(const std::string& name);
+
+  // Records a span on the calling thread. The times are nanoseconds since
+  // tracing was enabled. The name must outlive the trace.
+  static void AddSpan(const char* name, uint64_t begin, uint64_t end);
+
+  // Returns the current time in nanoseconds since tracing was enabled.
+  static uint64_t Now();
+};
+
+// Records a span from its construction until its destruction, if tracing was
+// enabled at construction. The name must outlive the trace, e.g., a literal.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char* name)
+      : name_(name), enabled_(Trace::IsEnabled()),
+        begin_(enabled_ ? Trace::Now() : 0) {
+  }
+
+  ~ScopedSpan() {
+    if (enabled_) {
+      Trace::AddSpan(name_, begin_, Trace::Now());
+    }
+  }
+
+  NO_COPY_ASSIGN(ScopedSpan);
+
+ private:
+  const char* name_;
+  const bool enabled_;
+  const uint64_t begin_;
+};
+
+#endif  /* TRACE_H_ */
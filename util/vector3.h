@@ -22,7 +22,9 @@
 
 /*
  * A 3-dimensional vector. Defined entirely in this header for performance
- * reasons. Differs from Point3 in which operations are supported.
+ * reasons. Differs from Point3 in which operations are supported. The
+ * coordinates are stored in Lanes, which makes use of SIMD instructions if
+ * RAYTRACER_SIMD is defined.
  * Author: Dino Wernli
  */
 
@@ -34,6 +36,7 @@
 
 #include "proto/util/vector_data.pb.h"
 #include "util/axis.h"
+#include "util/lanes.h"
 #include "util/numeric.h"
 
 using raytracer::VectorData;
@@ -46,70 +49,54 @@ Vector3 operator-(const Vector3& lhs, const Vector3& rhs);
 
 class Vector3 {
  public:
-  Vector3() : x_(0), y_(0), z_(0) {}
+  Vector3() {}
   Vector3(const Scalar& x, const Scalar& y, const Scalar& z)
-      : x_(x), y_(y), z_(z) {}
+      : lanes_(x, y, z) {}
+  explicit Vector3(const Lanes<Scalar>& lanes) : lanes_(lanes) {}
 
   // Replaces the data of this vector with the data from other.
   void ReplaceWith(const Vector3& other) {
-    x_ = other.x_;
-    y_ = other.y_;
-    z_ = other.z_;
+    lanes_ = other.lanes_;
   }
 
-  const Scalar& x() const { return x_; }
-  const Scalar& y() const { return y_; }
-  const Scalar& z() const { return z_; }
-
-  const Scalar& operator[](Axis axis) const {
-    if (axis == Axis::x()) {
-      return x_;
-    } else if (axis == Axis::y()) {
-      return y_;
-    } else {
-      return z_;
-    }
-  }
+  const Scalar& x() const { return lanes_[0]; }
+  const Scalar& y() const { return lanes_[1]; }
+  const Scalar& z() const { return lanes_[2]; }
 
-  Scalar& operator[](Axis axis) {
-    if (axis == Axis::x()) {
-      return x_;
-    } else if (axis == Axis::y()) {
-      return y_;
-    } else {
-      return z_;
-    }
-  }
+  // Exposes the coordinates for element-wise operations with other types.
+  const Lanes<Scalar>& lanes() const { return lanes_; }
+
+  const Scalar& operator[](Axis axis) const { return lanes_[axis.index()]; }
+  Scalar& operator[](Axis axis) { return lanes_[axis.index()]; }
 
   Scalar SquaredLength() const {
-    return x_ * x_ + y_ * y_ + z_ * z_;
+    return (lanes_ * lanes_).Sum();
   }
 
   Scalar Length() const {
-    return sqrt(SquaredLength());
+    return std::sqrt(SquaredLength());
   }
 
   // Returns a new vector representing the normalized version of *this.
   Vector3 Normalized() const {
-    return Vector3(*this) /= Length();
+    return Vector3(*this).Normalize();
   }
 
   // Normalize the vector in place.
   Vector3& Normalize() {
-    return ((*this) /= Length());
+    lanes_ *= Lanes<Scalar>::Splat(ReciprocalSqrt(SquaredLength()));
+    return *this;
   }
 
   // Returns the cross product of *this times other.
   Vector3 Cross(const Vector3& other) const {
-    return Vector3(
-      y_ * other.z_ - z_ * other.y_,
-      z_ * other.x_ - x_ * other.z_,
-      x_ * other.y_ - y_ * other.x_
-    );
+    const Lanes<Scalar>& a = lanes_;
+    const Lanes<Scalar>& b = other.lanes_;
+    return Vector3((a * b.Rotated() - a.Rotated() * b).Rotated());
   }
 
   Scalar Dot(const Vector3& other) const {
-    return x_ * other.x_ + y_ * other.y_ + z_ * other.z_;
+    return (lanes_ * other.lanes_).Sum();
   }
 
   // Returns this vector reflected on the plane given by "normal".
@@ -118,46 +105,44 @@ class Vector3 {
   }
 
   Vector3& operator/=(const Scalar& rhs) {
-    x_ /= rhs;
-    y_ /= rhs;
-    z_ /= rhs;
+    lanes_ /= Lanes<Scalar>::Splat(rhs);
     return *this;
   }
 
  private:
-  Scalar x_, y_, z_;
+  Lanes<Scalar> lanes_;
 };
 
 // Unary operators.
 inline Vector3 operator-(const Vector3& other) {
-  return Vector3(-other.x(), -other.y(), -other.z());
+  return Vector3(-other.lanes());
 }
 
 // Addition operators.
 inline Vector3 operator+(const Vector3& lhs, const Vector3& rhs)
 {
-  return Vector3(lhs.x() + rhs.x(), lhs.y() + rhs.y(), lhs.z() + rhs.z());
+  return Vector3(lhs.lanes() + rhs.lanes());
 }
 
 inline Vector3 operator-(const Vector3& lhs, const Vector3& rhs)
 {
-  return Vector3(lhs.x() - rhs.x(), lhs.y() - rhs.y(), lhs.z() - rhs.z());
+  return Vector3(lhs.lanes() - rhs.lanes());
 }
 
 // Multiplication operators.
 inline Vector3 operator*(const Scalar& lhs, const Vector3& rhs)
 {
-  return Vector3(lhs * rhs.x(), lhs * rhs.y(), lhs * rhs.z());
+  return Vector3(Lanes<Scalar>::Splat(lhs) * rhs.lanes());
 }
 
 inline Vector3 operator*(const Vector3& lhs, const Scalar& rhs)
 {
-  return Vector3(rhs * lhs.x(), rhs * lhs.y(), rhs * lhs.z());
+  return Vector3(lhs.lanes() * Lanes<Scalar>::Splat(rhs));
 }
 
 inline Vector3 operator*(const Vector3& lhs, const Vector3& rhs)
 {
-  return Vector3(lhs.x() * rhs.x(), lhs.y() * rhs.y(), lhs.z() * rhs.z());
+  return Vector3(lhs.lanes() * rhs.lanes());
 }
 
 template<class OStream>